@@ -98,7 +98,29 @@ include $(CLEAR_VARS)
 LOCAL_MODULE    := FrcSim
 LOCAL_SRC_FILES := ../../GamePlay/gameplay/src/gameplay-main-android.cpp \
 		Robot.cpp \
-		FrcSim.cpp
+		FrcSim.cpp \
+		SimulationWorld.cpp \
+		ThreadPool.cpp \
+		TextureMap.cpp \
+		MaterialCache.cpp \
+		SceneBVH.cpp \
+		RenderQueue.cpp \
+		StaticBatcher.cpp \
+		CookedCache.cpp \
+		AssetLoader.cpp \
+		NodeRegistry.cpp \
+		Profiler.cpp \
+		RobotFleet.cpp \
+		Mechanism.cpp \
+		MatchLog.cpp \
+		Telemetry.cpp \
+		ControlMailbox.cpp \
+		CollisionProxies.cpp \
+		FixedTimestep.cpp \
+		BallPool.cpp \
+		JobSystem.cpp \
+		DrawList.cpp \
+		FrameCapture.cpp
 LOCAL_CPP_FEATURES += rtti exceptions
 LOCAL_LDLIBS    := -llog -landroid -lEGL -lGLESv2 -lOpenSLES 
 LOCAL_CFLAGS    := -D__ANDROID__ -Wno-psabi 
@@ -0,0 +1,115 @@
+//
+//  AssetLoader.h
+//  FrcSim
+//
+//
+
+#ifndef _ASSET_LOADER
+#define _ASSET_LOADER
+
+#include <atomic>
+
+#include "JobSystem.h"
+
+/**
+ * Runs the CPU side of asset loading as jobs of the shared JobSystem.
+ *
+ * Jobs parse JSON (through run()), decode PNGs into gameplay::Image and
+ * read bundle files ahead of time so the main thread finds them in the OS
+ * file cache.  GamePlay creates GL objects while it loads bundles and
+ * textures, so bundle loading and texture uploads stay on the main thread
+ * (see uploadTextures()).  Every task counts towards getProgress().
+ */
+class AssetLoader
+{
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    AssetLoader();
+
+    /**
+     * Destructor, waits for the jobs and releases decoded images that were
+     * never uploaded.
+     */
+    ~AssetLoader();
+
+    /**
+     * Runs a task as a job, tasks may queue more work.
+     *
+     * @param task function to run
+     */
+    void run(const JobSystem::Task &task);
+
+    /**
+     * Reads a file in a job so it is cached when the main thread loads it.
+     *
+     * @param path file to read
+     */
+    void prefetch(const string &path);
+
+    /**
+     * Decodes an image in a job, ignored if the image was already queued.
+     *
+     * @param path image file
+     */
+    void decodeImage(const string &path);
+
+    /**
+     * Returns true once every queued task has finished.
+     *
+     * @return true if nothing is left for the jobs
+     */
+    bool isDecoded() const { return _jobs.isDone(); }
+
+    /**
+     * Uploads decoded images as textures and adds them to a material cache,
+     * must be called on the main thread after isDecoded().
+     *
+     * @param cache cache receiving the textures
+     * @param maxCount most textures to upload in this call
+     * @return true when every image has been uploaded
+     */
+    bool uploadTextures(MaterialCache &cache, unsigned int maxCount);
+
+    /**
+     * Returns the fraction of tasks and uploads completed.
+     *
+     * @return progress between 0 and 1
+     */
+    float getProgress() const;
+
+    /**
+     * Returns the number of worker threads.
+     *
+     * @return number of worker threads
+     */
+    unsigned int getThreadCount() const { return JobSystem::getInstance().getWorkerCount(); }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    AssetLoader(const AssetLoader &loader);
+
+    /**
+     * Hidden assignment operator.
+     */
+    AssetLoader &operator=(const AssetLoader &loader);
+
+    JobSystem::Counter _jobs;      /**< Tasks queued and not finished                 */
+
+    std::mutex _mutex;             /**< Guards _images                                */
+
+    map<string, Image*> _images;   /**< Decoded images by path, NULL until decoded    */
+
+    std::atomic<unsigned int> _queued;     /**< Tasks and uploads queued              */
+
+    std::atomic<unsigned int> _completed;  /**< Tasks and uploads done                */
+
+};
+
+#endif // _ASSET_LOADER
@@ -0,0 +1,162 @@
+//
+//  BallPool.h
+//  FrcSim
+//
+//
+
+#ifndef _BALL_POOL
+#define _BALL_POOL
+
+/**
+ * Game balls built once and reused.
+ *
+ * create() clones a ball node and gives every copy its rigid body from one
+ * parse of the physics file, all disabled and parked far below the field
+ * where no camera sees them.  spawn() and despawn() only move a ball and
+ * enable or disable its body, so putting balls in play allocates nothing
+ * and reads no files.  Balls that fall off the field go back to the pool.
+ */
+class BallPool
+{
+
+public:
+
+    static const unsigned int kDefaultSize = 32;
+
+    static const float kDespawnHeight;     /**< Balls below this height (inches) are despawned */
+
+    /**
+     * Default constructor.
+     */
+    BallPool();
+
+    /**
+     * Destructor, releases the clones.
+     */
+    ~BallPool();
+
+    /**
+     * Builds the pool, the prototype is its first ball.  Clones are named
+     * "<prototype>_<n>" and added to the scene.
+     *
+     * @param scene scene the balls are in
+     * @param prototype ball node, already given its material
+     * @param physicsUrl collision object of the balls
+     * @param size number of balls
+     * @return number of balls with a rigid body
+     */
+    unsigned int create(Scene *scene, Node *prototype, const char *physicsUrl, unsigned int size = kDefaultSize);
+
+    /**
+     * Removes the clones from the scene and empties the pool.
+     */
+    void clear();
+
+    /**
+     * Puts a ball in play.
+     *
+     * @param position where the ball appears
+     * @param velocity initial linear velocity
+     * @return ball index, -1 if every ball is in play
+     */
+    int spawn(const Vector3 &position, const Vector3 &velocity = Vector3::zero());
+
+    /**
+     * Takes a ball out of play.
+     *
+     * @param index ball index
+     */
+    void despawn(unsigned int index);
+
+    /**
+     * Takes every ball out of play.
+     */
+    void despawnAll();
+
+    /**
+     * Despawns the balls that fell off the field.
+     *
+     * @return number of balls in play
+     */
+    unsigned int update();
+
+    /**
+     * Returns the number of balls.
+     *
+     * @return pool size
+     */
+    unsigned int size() const { return (unsigned int)_balls.size(); }
+
+    /**
+     * Returns the number of balls in play.
+     *
+     * @return balls in play
+     */
+    unsigned int getActiveCount() const { return _active; }
+
+    /**
+     * Returns true if a ball is in play.
+     *
+     * @param index ball index
+     * @return true if in play
+     */
+    bool isActive(unsigned int index) const { return _balls[index].active; }
+
+    /**
+     * Returns a ball's node.
+     *
+     * @param index ball index
+     * @return node
+     */
+    Node *getNode(unsigned int index) const { return _balls[index].node; }
+
+    /**
+     * Returns a ball's rigid body.
+     *
+     * @param index ball index
+     * @return rigid body, NULL if the physics file had no ball
+     */
+    PhysicsRigidBody *getBody(unsigned int index) const { return _balls[index].body; }
+
+    /**
+     * Returns the lowest ball index in play.
+     *
+     * @return ball index, -1 if no ball is in play
+     */
+    int getFirstActive() const;
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    BallPool(const BallPool &pool);
+
+    /**
+     * Hidden assignment operator.
+     */
+    BallPool &operator=(const BallPool &pool);
+
+    /**
+     * Pooled ball.
+     */
+    struct Ball
+    {
+        Node *node;
+
+        PhysicsRigidBody *body;
+
+        bool active;
+    };
+
+    Scene *_scene;
+
+    vector<Ball> _balls;           /**< First entry is the prototype                  */
+
+    vector<unsigned int> _free;    /**< Indices out of play, lowest last              */
+
+    unsigned int _active;
+
+};
+
+#endif // _BALL_POOL
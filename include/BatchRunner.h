@@ -0,0 +1,147 @@
+//
+//  BatchRunner.h
+//  FrcSim
+//
+//
+
+#ifndef _BATCH_RUNNER
+#define _BATCH_RUNNER
+
+/**
+ * Runs many independent headless matches across a thread pool to sweep
+ * robot configuration values.
+ *
+ * A sweep file names the base robot configuration, the match settings and
+ * the values to sweep, every combination of the swept values is one run:
+ *
+ *     {
+ *         "config" : "/res/data/AerialAssist2028.json",
+ *         "duration" : 15.0,
+ *         "timestep" : 0.005,
+ *         "throttle" : 1.0,
+ *         "yaw" : 0.0,
+ *         "launch" : -1.0,
+ *         "sweep" :
+ *         {
+ *             "maxAcceleration" : { "min" : 4.0, "max" : 12.0, "steps" : 5 },
+ *             "maxVelocity" : [ 30.0, 40.0, 50.0 ],
+ *             "positionZ" : 0.0
+ *         }
+ *     }
+ *
+ * Only keys the headless world reads can be swept: maxAcceleration,
+ * maxVelocity, velocity and positionX/Y/Z.  The robot body is kinematic, so
+ * a key such as "mass" is rejected instead of repeating identical runs.
+ */
+class BatchRunner
+{
+
+public:
+
+    /**
+     * Outcome of a single run.
+     */
+    struct Result
+    {
+        Result() : ticks(0), simulatedTime(0.0), velocity(0.0), ballInPlay(false), wallTime(0.0) {}
+
+        unsigned long ticks;       /**< Number of fixed steps taken                   */
+
+        double simulatedTime;      /**< Simulated time in seconds                     */
+
+        Vector3 position;          /**< Final robot position (inches)                 */
+
+        double velocity;           /**< Final robot velocity (inches/sec)             */
+
+        bool ballInPlay;           /**< Ball was put in play                          */
+
+        Vector3 ball;              /**< Final ball position (inches)                  */
+
+        double wallTime;           /**< Wall clock time for the run in seconds        */
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param parameters physical constants shared by every world
+     */
+    explicit BatchRunner(const SimulationWorld::Parameters &parameters);
+
+    /**
+     * Reads a sweep file and expands it into runs.
+     *
+     * @param filename sweep file (absolute or relative to the working directory)
+     * @return true if the sweep file and its robot configuration were read
+     */
+    bool loadSweep(const string &filename);
+
+    /**
+     * Returns the number of runs in the sweep.
+     *
+     * @return number of runs
+     */
+    size_t getRunCount() const { return _runs.size(); }
+
+    /**
+     * Runs every match of the sweep and writes one CSV line per run.
+     *
+     * @param threadCount number of worker threads, 0 for one per core
+     * @param resultsFile CSV file to write
+     * @return true if the results file was written
+     */
+    bool run(unsigned int threadCount, const string &resultsFile);
+
+    /**
+     * Runs every match of the sweep.
+     *
+     * @param threadCount number of worker threads, 0 for one per core
+     * @param results receives one result per run, in run order
+     */
+    void run(unsigned int threadCount, vector<Result> &results);
+
+    /**
+     * Returns the swept values of a run.
+     *
+     * @param index run index
+     * @return values in the order of the sweep file's keys
+     */
+    const vector<double> &getRunValues(size_t index) const { return _runs[index]; }
+
+private:
+
+    typedef vector<double> RunValues;
+
+    /**
+     * Runs a single match.
+     *
+     * @param values swept values for this run (in _keys order)
+     * @param result receives the outcome
+     */
+    void runMatch(const RunValues &values, Result &result) const;
+
+    /**
+     * Writes the results as CSV.
+     */
+    bool writeResults(const string &resultsFile, const vector<Result> &results) const;
+
+    SimulationWorld::Parameters _parameters;
+
+    Json::Value _config;           /**< Base robot configuration                      */
+
+    vector<string> _keys;          /**< Configuration keys being swept                */
+
+    vector<RunValues> _runs;       /**< Values of _keys for every run                 */
+
+    double _duration;
+
+    float _timestep;
+
+    float _throttle;
+
+    float _yaw;
+
+    double _launch;
+
+};
+
+#endif // _BATCH_RUNNER
@@ -0,0 +1,150 @@
+//
+//  CollisionProxies.h
+//  FrcSim
+//
+//
+
+#ifndef _COLLISION_PROXIES
+#define _COLLISION_PROXIES
+
+#include "CookedCache.h"
+
+/**
+ * Simplified collision shapes for the field's static nodes.
+ *
+ * The "collisionProxies" namespace of frcsim.physics picks, per field node,
+ * the render mesh ("mesh", the staticMesh object) or a proxy fitted to the
+ * node's vertices: one "box", "sphere" or "capsule" (along the node's Y
+ * axis), or "boxes", an approximate convex decomposition that splits the
+ * triangles at the median of the longest axis of the largest box for as
+ * long as each split removes at least a quarter of the volume, up to
+ * maxBoxes boxes.  Proxies are fitted in the node's space so they follow
+ * its transform and scale; the boxes of a decomposition go on child nodes.
+ *
+ *     collisionProxies
+ *     {
+ *         collisionObject = staticBox   rigid body parameters of the proxies
+ *         maxBoxes = 8
+ *         nodes
+ *         {
+ *             GE_14063_1 = boxes
+ *         }
+ *     }
+ *
+ * Fitting reads the vertices back from GL, so the proxies are cooked next
+ * to the field bundle ("<bundle>.cooked") and re-fitted only when the
+ * bundle or the rules change.  Fit before StaticBatcher takes the models.
+ */
+class CollisionProxies
+{
+
+public:
+
+    static const unsigned int kDefaultMaxBoxes = 8;
+
+    /**
+     * Collision geometry of a node.
+     */
+    enum Shape
+    {
+        MESH,
+        BOX,
+        SPHERE,
+        CAPSULE,
+        BOXES
+    };
+
+    /**
+     * Fitted shape, in the space of its node.
+     */
+    struct Proxy
+    {
+        string node;               /**< Node ID                                       */
+
+        unsigned int shape;        /**< Shape, BOXES proxies are the single boxes     */
+
+        Vector3 center;
+
+        Vector3 size;              /**< Box extents; sphere radius in x; capsule radius in x, height in y */
+    };
+
+    /**
+     * Default constructor.
+     */
+    CollisionProxies();
+
+    /**
+     * Reads the rules.
+     *
+     * @param physicsFile physics file containing "collisionProxies"
+     * @return true if the file has rules
+     */
+    bool load(const char *physicsFile);
+
+    /**
+     * Gives the nodes with a rule their collision objects, from the cooked
+     * proxies of the bundle or freshly fitted ones.
+     *
+     * @param scene field scene, nodes still have their models
+     * @param bundle full path of the field bundle
+     * @return number of collision objects created
+     */
+    unsigned int apply(Scene *scene, const string &bundle);
+
+    /**
+     * Returns the proxies of the last apply().
+     *
+     * @return fitted proxies
+     */
+    const vector<Proxy> &getProxies() const { return _proxies; }
+
+private:
+
+    /**
+     * Node ID and the geometry it uses.
+     */
+    struct Rule
+    {
+        string node;
+
+        Shape shape;
+    };
+
+    /**
+     * Fits the proxies of every rule's node.
+     */
+    void fit(Scene *scene);
+
+    /**
+     * Fits the proxies of one node.
+     */
+    void fit(const Rule &rule, const vector<Vector3> &triangles);
+
+    /**
+     * Reads the cooked proxies, false if they are out of date.
+     */
+    bool readCooked(const CookedCache &cache);
+
+    /**
+     * Hash of the rules, stored with the cooked proxies.
+     */
+    uint64_t getRulesHash() const;
+
+    /**
+     * Reads the triangle corners of a node's mesh, in the node's space.
+     */
+    static bool readTriangles(Node *node, vector<Vector3> &triangles);
+
+    string _physics_file;
+
+    string _collision_object;      /**< Rigid body parameters of the proxies          */
+
+    unsigned int _max_boxes;
+
+    vector<Rule> _rules;
+
+    vector<Proxy> _proxies;
+
+};
+
+#endif // _COLLISION_PROXIES
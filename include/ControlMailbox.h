@@ -0,0 +1,205 @@
+//
+//  ControlMailbox.h
+//  FrcSim
+//
+//
+
+#ifndef _CONTROL_MAILBOX
+#define _CONTROL_MAILBOX
+
+#include <stdint.h>
+
+#include <atomic>
+
+/**
+ * Shared memory mailbox between the simulator and an external controller,
+ * typically robot code built for the desktop.
+ *
+ * The two sides run in lockstep: the simulator posts the sensors of tick n
+ * and waits, the controller reads them, posts its command and waits, and
+ * the simulator applies the command for one control period before posting
+ * the next sensors.  Each direction is a sequence number the writer bumps
+ * after the payload; the other side spins briefly and then sleeps on the
+ * sequence with a futex (Linux), so a round trip costs a few microseconds
+ * and never goes through a socket.  Other platforms poll the sequence.
+ * POSIX shared memory is not available on Android, where create() and
+ * open() fail.
+ */
+class ControlMailbox
+{
+
+public:
+
+    static const uint32_t kMagic = 0x4d435246;     /**< 'FRCM' little endian         */
+
+    static const uint32_t kVersion = 1;
+
+    static const char *kDefaultName;               /**< Shared memory object name    */
+
+    static const int kDefaultTimeout = 10000;      /**< Milliseconds to wait for the other side */
+
+    /**
+     * Buttons of a Command.
+     */
+    enum Button
+    {
+        BUTTON_LAUNCH_BALL = 1,
+        BUTTON_FIRE_CATAPULT = 2
+    };
+
+    /**
+     * Controller outputs for one period.
+     */
+    struct Command
+    {
+        Command() : velocity(0.0f), yaw(0.0f), buttons(0), detach(0) {}
+
+        /**
+         * Converts the command to driver inputs, velocity drives the
+         * triggers the way --throttle does.
+         *
+         * @param input receives the inputs
+         */
+        void getInput(MatchInput &input) const;
+
+        float velocity;            /**< Velocity setpoint, -1.0 to 1.0 of maximum     */
+
+        float yaw;                 /**< Heading in degrees                            */
+
+        uint32_t buttons;          /**< Button bits held during the period            */
+
+        uint32_t detach;           /**< Nonzero when the controller is done           */
+    };
+
+    /**
+     * Segment layout, each sequence has its own cache line.
+     */
+    struct Segment
+    {
+        uint32_t magic;
+
+        uint32_t version;
+
+        double period;             /**< Seconds simulated per command                 */
+
+        std::atomic<uint32_t> stopped;     /**< Set when the simulator closes         */
+
+        alignas(64) std::atomic<uint32_t> sensorSequence;   /**< Sensor posts        */
+
+        TelemetrySample sensors;
+
+        alignas(64) std::atomic<uint32_t> commandSequence;  /**< Command posts       */
+
+        Command command;
+    };
+
+    /**
+     * Default constructor.
+     */
+    ControlMailbox();
+
+    /**
+     * Destructor, unmaps the segment and removes it if this is the simulator.
+     */
+    ~ControlMailbox();
+
+    /**
+     * Creates the mailbox, simulator side, replacing a stale one.
+     *
+     * @param name shared memory object name, starting with '/'
+     * @param period seconds simulated per command
+     * @return true if the mailbox was created
+     */
+    bool create(const char *name, double period);
+
+    /**
+     * Maps an existing mailbox, controller side.
+     *
+     * @param name shared memory object name
+     * @return true if the mailbox was mapped and has a known layout
+     */
+    bool open(const char *name = kDefaultName);
+
+    /**
+     * Unmaps the mailbox, the simulator side releases a waiting controller.
+     */
+    void close();
+
+    /**
+     * Returns true while a mailbox is mapped.
+     *
+     * @return true if mapped
+     */
+    bool isOpen() const { return _segment != NULL; }
+
+    /**
+     * Returns the control period.
+     *
+     * @return seconds simulated per command
+     */
+    double getPeriod() const { return _segment ? _segment->period : 0.0; }
+
+    /**
+     * Posts the sensors of a tick, simulator side.
+     *
+     * @param sensors robot and ball state
+     */
+    void postSensors(const TelemetrySample &sensors);
+
+    /**
+     * Waits for the command answering the last postSensors(), simulator
+     * side.
+     *
+     * @param command receives the command
+     * @param timeout milliseconds to wait, negative to wait forever
+     * @return false on timeout or when the controller detached
+     */
+    bool waitCommand(Command &command, int timeout = kDefaultTimeout);
+
+    /**
+     * Waits for sensors not seen yet, controller side.
+     *
+     * @param sensors receives the sensors
+     * @param timeout milliseconds to wait, negative to wait forever
+     * @return false on timeout or when the simulator stopped
+     */
+    bool waitSensors(TelemetrySample &sensors, int timeout = kDefaultTimeout);
+
+    /**
+     * Posts the command for the sensors last read, controller side.
+     *
+     * @param command controller outputs
+     */
+    void postCommand(const Command &command);
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    ControlMailbox(const ControlMailbox &mailbox);
+
+    /**
+     * Hidden assignment operator.
+     */
+    ControlMailbox &operator=(const ControlMailbox &mailbox);
+
+    /**
+     * Waits until a sequence differs from a value.
+     */
+    static bool wait(std::atomic<uint32_t> &sequence, uint32_t value, int timeout);
+
+    /**
+     * Wakes the other side sleeping on a sequence.
+     */
+    static void wake(std::atomic<uint32_t> &sequence);
+
+    Segment *_segment;
+
+    uint32_t _sequence;            /**< Last sequence posted or read by this side     */
+
+    string _name;                  /**< Set when this process created the mailbox     */
+
+};
+
+#endif // _CONTROL_MAILBOX
@@ -0,0 +1,264 @@
+//
+//  CookedCache.h
+//  FrcSim
+//
+//
+
+#ifndef _COOKED_CACHE
+#define _COOKED_CACHE
+
+#include <stdint.h>
+
+/**
+ * Binary cooked copy of a JSON source file (robot configuration, texture
+ * map) or of data derived from a bundle (collision proxies), stored next to
+ * the source as "<source>.cooked".
+ *
+ * The source is memory mapped and hashed (64 bit FNV-1a), the cooked file is
+ * memory mapped and used only if its header names the same kind, format
+ * version, source size and hash.  Otherwise the caller parses the mapped
+ * JSON as before and saves a new cooked file with save().  Cooked files are
+ * written to a temporary file and renamed, so parallel batch runs never see
+ * a partial file.  A read-only resource directory only costs the write.
+ *
+ * Cooked payloads are a flat sequence of little endian values written with
+ * Writer and read back in the same order with Reader.  Strings are stored
+ * with their terminating NUL so Reader returns pointers into the mapping.
+ */
+class CookedCache
+{
+
+public:
+
+    static const uint32_t kMagic = 0x43435246;     /**< "FRCC"                        */
+
+    static const uint32_t kVersion = 2;            /**< Bumped when a payload changes */
+
+    /**
+     * Payload kinds.
+     */
+    enum Kind
+    {
+        ROBOT_CONFIG = 1,
+        TEXTURE_MAP,
+        COLLISION_PROXIES
+    };
+
+    /**
+     * Builds a cooked payload.
+     */
+    class Writer
+    {
+    public:
+
+        void putUInt(uint32_t value) { put(&value, sizeof(value)); }
+
+        void putDouble(double value) { put(&value, sizeof(value)); }
+
+        void putFloat(float value) { put(&value, sizeof(value)); }
+
+        void putBool(bool value) { putUInt(value ? 1 : 0); }
+
+        void putString(const char *value)
+        {
+            uint32_t length = (uint32_t)strlen(value);
+            putUInt(length);
+            put(value, length + 1);
+        }
+
+        const vector<unsigned char> &getData() const { return _data; }
+
+    private:
+
+        void put(const void *data, size_t size)
+        {
+            const unsigned char *bytes = (const unsigned char*)data;
+            _data.insert(_data.end(), bytes, bytes + size);
+        }
+
+        vector<unsigned char> _data;
+    };
+
+    /**
+     * Reads a cooked payload, every read past the end fails and leaves
+     * isValid() false.
+     */
+    class Reader
+    {
+    public:
+
+        Reader(const unsigned char *data, size_t size) : _data(data), _size(size), _offset(0), _valid(data != NULL) {}
+
+        uint32_t getUInt() { uint32_t value = 0; get(&value, sizeof(value)); return value; }
+
+        double getDouble() { double value = 0.0; get(&value, sizeof(value)); return value; }
+
+        float getFloat() { float value = 0.0f; get(&value, sizeof(value)); return value; }
+
+        bool getBool() { return getUInt() != 0; }
+
+        const char *getString()
+        {
+            uint32_t length = getUInt();
+            if (!_valid || length >= _size - _offset || _data[_offset + length] != 0)
+            {
+                _valid = false;
+                return "";
+            }
+            const char *value = (const char*)(_data + _offset);
+            _offset += length + 1;
+            return value;
+        }
+
+        bool isValid() const { return _valid; }
+
+        bool isAtEnd() const { return _offset == _size; }
+
+    private:
+
+        void get(void *value, size_t size)
+        {
+            if (!_valid || size > _size - _offset)
+            {
+                _valid = false;
+                return;
+            }
+            memcpy(value, _data + _offset, size);
+            _offset += size;
+        }
+
+        const unsigned char *_data;
+
+        size_t _size;
+
+        size_t _offset;
+
+        bool _valid;
+    };
+
+    /**
+     * Maps a source file and its cooked copy.
+     *
+     * @param source full path of the JSON source
+     * @param kind payload kind expected in the cooked file
+     */
+    CookedCache(const string &source, Kind kind);
+
+    /**
+     * Destructor, unmaps both files.
+     */
+    ~CookedCache();
+
+    /**
+     * Returns true if the source file was mapped.
+     *
+     * @return true if the source exists
+     */
+    bool hasSource() const { return _source != NULL; }
+
+    /**
+     * Returns the mapped source, to parse when there is no cooked copy.
+     *
+     * @return first byte of the source
+     */
+    const char *getSource() const { return (const char*)_source; }
+
+    /**
+     * Returns the source size.
+     *
+     * @return size of the source in bytes
+     */
+    size_t getSourceSize() const { return _source_size; }
+
+    /**
+     * Returns true if an up to date cooked copy was mapped.
+     *
+     * @return true if getReader() can be used
+     */
+    bool isCooked() const { return _cooked != NULL; }
+
+    /**
+     * Returns a reader over the cooked payload.
+     *
+     * @return payload reader
+     */
+    Reader getReader() const;
+
+    /**
+     * Writes the cooked copy of the source.
+     *
+     * @param writer payload
+     * @return true if the file was written
+     */
+    bool save(const Writer &writer) const;
+
+    /**
+     * 64 bit FNV-1a hash.
+     *
+     * @param data bytes to hash
+     * @param size number of bytes
+     * @return hash
+     */
+    static uint64_t hash(const void *data, size_t size);
+
+private:
+
+    /**
+     * Cooked file header.
+     */
+    struct Header
+    {
+        uint32_t magic;
+
+        uint32_t version;
+
+        uint32_t kind;
+
+        uint32_t payloadSize;
+
+        uint64_t sourceSize;
+
+        uint64_t sourceHash;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    CookedCache(const CookedCache &cache);
+
+    /**
+     * Hidden assignment operator.
+     */
+    CookedCache &operator=(const CookedCache &cache);
+
+    /**
+     * Maps a whole file read-only.
+     *
+     * @return first byte, NULL if the file could not be mapped
+     */
+    static const unsigned char *map(const string &path, size_t &size);
+
+    /**
+     * Unmaps a file mapped by map().
+     */
+    static void unmap(const unsigned char *data, size_t size);
+
+    string _source_path;
+
+    string _cooked_path;
+
+    Kind _kind;
+
+    const unsigned char *_source;  /**< Mapped source                                 */
+
+    size_t _source_size;
+
+    uint64_t _source_hash;
+
+    const unsigned char *_cooked;  /**< Mapped cooked file, NULL if out of date       */
+
+    size_t _cooked_size;
+
+};
+
+#endif // _COOKED_CACHE
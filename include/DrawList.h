@@ -0,0 +1,163 @@
+//
+//  DrawList.h
+//  FrcSim
+//
+//
+
+#ifndef _DRAW_LIST
+#define _DRAW_LIST
+
+/**
+ * Sorted render queue turned into draw commands for one camera.
+ *
+ * GamePlay's auto-bindings compute the world-view, world-view-projection
+ * and normal matrices of every node, and the bound spotlight getters its
+ * view-space position and direction, inside Model::draw() on the GL
+ * thread.  build() does that work up front, can run as a job (one per
+ * queue, chunks of kCommandsPerJob nodes in parallel) and only reads state
+ * the main thread brought up to date: the nodes' world matrices and bounds
+ * (culling reads them) and the camera matrices in View.  draw() then just
+ * copies each command's matrices into the node's material parameters and
+ * calls Model::draw().
+ *
+ * The parameters are looked up once per node by bind().  Setting a value
+ * replaces a parameter's auto-binding, so a bound node must be drawn
+ * through a draw list from then on; draws without a binding keep their
+ * auto-bindings and are drawn by Model::draw() alone.
+ */
+class DrawList
+{
+
+public:
+
+    static const unsigned int kCommandsPerJob = 128;
+
+    /**
+     * Material parameters of a node set by draw().
+     */
+    struct Binding
+    {
+        Binding() : worldView(NULL), worldViewProjection(NULL), inverseTransposeWorldView(NULL), spotLightPosition(NULL), spotLightDirection(NULL) {}
+
+        MaterialParameter *worldView;
+
+        MaterialParameter *worldViewProjection;
+
+        MaterialParameter *inverseTransposeWorldView;
+
+        MaterialParameter *spotLightPosition;
+
+        MaterialParameter *spotLightDirection;
+    };
+
+    /**
+     * Camera state a list is built for, read on the main thread.
+     */
+    struct View
+    {
+        /**
+         * Reads a camera and the spotlight it sees.
+         *
+         * @param camera camera the list is drawn from
+         * @param spotLight node of the scene's spotlight, NULL for none
+         */
+        void set(const Camera *camera, const Node *spotLight);
+
+        Matrix view;
+
+        Matrix viewProjection;
+
+        Vector3 eye;               /**< Camera position in world space                */
+
+        Vector3 forward;           /**< Camera forward vector in world space          */
+
+        Vector3 spotLightPosition; /**< In view space                                 */
+
+        Vector3 spotLightDirection;/**< In view space                                 */
+    };
+
+    /**
+     * Looks up the parameters draw() sets for a node, on the main thread
+     * once its material is final.
+     *
+     * @param node node with a model
+     * @param binding receives the parameters
+     * @return false if the node has no model or material
+     */
+    static bool bind(Node *node, Binding &binding);
+
+    /**
+     * Default constructor.
+     */
+    DrawList();
+
+    /**
+     * Removes all commands.
+     */
+    void clear() { _commands.clear(); }
+
+    /**
+     * Turns a sorted queue into commands for a view, safe to run as a job
+     * as long as no other job writes the queue, the list or the nodes.
+     *
+     * @param queue sorted queue
+     * @param bindings bindings the queue's draws index
+     * @param view camera the queue was sorted for
+     */
+    void build(const RenderQueue &queue, const vector<Binding> &bindings, const View &view);
+
+    /**
+     * Draws every command in order, on the GL thread.
+     *
+     * @param wireframe true to draw in wireframe
+     * @param state draw state of the previous draw, updated to the last one
+     * @return number of program and material changes
+     */
+    unsigned int draw(bool wireframe, unsigned int &state) const;
+
+    /**
+     * Returns the number of commands.
+     *
+     * @return number of commands
+     */
+    size_t size() const { return _commands.size(); }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    DrawList(const DrawList &list);
+
+    /**
+     * Hidden assignment operator.
+     */
+    DrawList &operator=(const DrawList &list);
+
+    /**
+     * Node to draw with its matrices for the view.
+     */
+    struct Command
+    {
+        Matrix worldView;
+
+        Matrix worldViewProjection;
+
+        Matrix inverseTransposeWorldView;
+
+        Model *model;
+
+        const Binding *binding;    /**< NULL to draw with the node's own bindings     */
+
+        unsigned int state;        /**< See RenderQueue::makeState()                  */
+    };
+
+    vector<Command> _commands;
+
+    Vector3 _spot_light_position;
+
+    Vector3 _spot_light_direction;
+
+};
+
+#endif // _DRAW_LIST
@@ -0,0 +1,88 @@
+//
+//  FixedTimestep.h
+//  FrcSim
+//
+//
+
+#ifndef _FIXED_TIMESTEP
+#define _FIXED_TIMESTEP
+
+/**
+ * Turns variable frame times into a whole number of fixed steps.
+ *
+ * Frame time goes into an accumulator and advance() returns how many steps
+ * of exactly getStep() seconds are due, at most the max substeps budget;
+ * time beyond the budget is dropped (and counted) so a slow frame does not
+ * make the next frame slower still.  What is left in the accumulator is
+ * the fraction of a step the drawn frame lies past the last step, so
+ * rendering interpolates between the last two steps with getAlpha().
+ *
+ * The default step and budget are the same as GamePlay's Bullet substeps
+ * (1/60 sec, at most 10 per frame), but the two are not lock-stepped:
+ * Bullet keeps its own accumulator inside the frame, so a frame can run a
+ * different number of robot steps than physics steps.
+ */
+class FixedTimestep
+{
+
+public:
+
+    static const float kDefaultStep;                   /**< Seconds, 60 Hz           */
+
+    static const unsigned int kDefaultMaxSubsteps = 10;
+
+    /**
+     * Constructor.
+     *
+     * @param step step length in seconds
+     * @param maxSubsteps most steps run for a single frame
+     */
+    FixedTimestep(float step = kDefaultStep, unsigned int maxSubsteps = kDefaultMaxSubsteps);
+
+    /**
+     * Adds a frame's time and returns the steps now due.
+     *
+     * @param elapsedTime frame time in seconds
+     * @return number of steps to run
+     */
+    unsigned int advance(double elapsedTime);
+
+    /**
+     * Empties the accumulator, after loading or a replay.
+     */
+    void reset();
+
+    /**
+     * Returns how far the frame lies between the last two steps.
+     *
+     * @return 0.0 at the last step, up to 1.0 at the next
+     */
+    float getAlpha() const { return (float)(_accumulator / _step); }
+
+    /**
+     * Returns the step length.
+     *
+     * @return step length in seconds
+     */
+    float getStep() const { return _step; }
+
+    /**
+     * Returns the frame time dropped because of the substep budget.
+     *
+     * @return seconds dropped since the last reset()
+     */
+    double getDroppedTime() const { return _dropped; }
+
+private:
+
+    float _step;
+
+    unsigned int _max_substeps;
+
+    double _accumulator;           /**< Time not yet stepped, below one step          */
+
+    double _dropped;
+
+};
+
+#endif // _FIXED_TIMESTEP
@@ -0,0 +1,254 @@
+//
+//  FrameCapture.h
+//  FrcSim
+//
+//
+
+#ifndef _FRAME_CAPTURE
+#define _FRAME_CAPTURE
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <string>
+
+#include "JobSystem.h"
+
+/**
+ * Renders a view into an offscreen framebuffer and streams the frames to
+ * disk without making the frame wait for the GPU or the disk.
+ *
+ * Drawing between begin() and end() goes into the capture's framebuffer.
+ * end() reads it into the next of kReadbackDepth pixel buffer objects and
+ * fences the read, then copies out the frames whose fence has signaled, so
+ * the CPU only waits for a frame that is kReadbackDepth frames old.  The
+ * copies go to a pool of kFrameCount preallocated frames: RAW frames are
+ * appended to one file by a writer thread, PNG frames are encoded as
+ * JobSystem jobs, one file each.  When every pooled frame is still waiting
+ * to be written the new frame is dropped and counted instead.
+ *
+ * RAW files are top-down RGBA with no header, e.g. for
+ * "ffmpeg -f rawvideo -pix_fmt rgba -s <width>x<height> -r <fps> -i <file>".
+ * OpenGL ES 2 has no pixel buffer objects, there end() reads synchronously.
+ */
+class FrameCapture
+{
+
+public:
+
+    static const unsigned int kReadbackDepth = 3;  /**< Frames between draw and copy      */
+
+    static const unsigned int kFrameCount = 8;     /**< Frames waiting for the disk      */
+
+    /**
+     * File format of the frames.
+     */
+    enum Format
+    {
+        RAW = 0,                   /**< All frames appended to one file               */
+        PNG                        /**< One file per frame                            */
+    };
+
+    /**
+     * Default constructor.
+     */
+    FrameCapture();
+
+    /**
+     * Destructor, closes the capture.
+     */
+    ~FrameCapture();
+
+    /**
+     * Creates the framebuffer and readback buffers and starts the writer,
+     * on the GL thread.
+     *
+     * @param width frame width
+     * @param height frame height
+     * @param path RAW file, or printf pattern of the PNG files with one
+     *        unsigned conversion for the frame number ("frame-%06u.png")
+     * @param format file format
+     * @return false if the path or the framebuffer is unusable
+     */
+    bool open(unsigned int width, unsigned int height, const string &path, Format format);
+
+    /**
+     * Writes the frames in flight and releases everything, on the GL thread.
+     */
+    void close();
+
+    /**
+     * Returns true between open() and close().
+     *
+     * @return true if capturing
+     */
+    bool isOpen() const { return _framebuffer != NULL; }
+
+    /**
+     * Binds the capture framebuffer, the caller sets the viewport.
+     */
+    void begin();
+
+    /**
+     * Queues the readback of the frame drawn since begin() and binds the
+     * framebuffer bound before it.
+     */
+    void end();
+
+    /**
+     * Returns the frame width.
+     *
+     * @return width in pixels
+     */
+    unsigned int getWidth() const { return _width; }
+
+    /**
+     * Returns the frame height.
+     *
+     * @return height in pixels
+     */
+    unsigned int getHeight() const { return _height; }
+
+    /**
+     * Returns the number of frames drawn since open().
+     *
+     * @return frames passed to end()
+     */
+    unsigned int getFrameCount() const { return _frame; }
+
+    /**
+     * Returns the number of frames written since open().
+     *
+     * @return frames on disk
+     */
+    unsigned int getWrittenCount() const { return _written; }
+
+    /**
+     * Returns the number of frames dropped because the disk fell behind.
+     *
+     * @return dropped frames
+     */
+    unsigned int getDroppedCount() const { return _dropped; }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    FrameCapture(const FrameCapture &capture);
+
+    /**
+     * Hidden assignment operator.
+     */
+    FrameCapture &operator=(const FrameCapture &capture);
+
+    /**
+     * Pixel buffer object a frame is read into.
+     */
+    struct Readback
+    {
+        GLuint buffer;
+
+        GLsync fence;              /**< NULL when the buffer is free                  */
+
+        unsigned int frame;
+    };
+
+    /**
+     * Pooled frame, bottom-up rows as read from GL.
+     */
+    struct Frame
+    {
+        vector<unsigned char> pixels;
+
+        unsigned int index;
+    };
+
+    /**
+     * Copies out finished readbacks, oldest first.
+     *
+     * @param wait true to wait for every readback in flight
+     */
+    void collect(bool wait);
+
+    /**
+     * Copies a readback into a pooled frame and hands it to the writer.
+     */
+    void finish(Readback &readback);
+
+    /**
+     * Takes a free frame, NULL if all are waiting for the disk.
+     */
+    Frame *acquire();
+
+    /**
+     * Hands a frame to the writer thread (RAW) or an encoding job (PNG).
+     */
+    void submit(Frame *frame);
+
+    /**
+     * Returns a written frame to the pool.
+     */
+    void release(Frame *frame);
+
+    /**
+     * Appends a frame to the RAW file, on the writer thread.
+     */
+    bool writeRaw(const Frame &frame);
+
+    /**
+     * Writes a frame to its PNG file.
+     */
+    bool writePng(const Frame &frame) const;
+
+    /**
+     * Writer thread body.
+     */
+    void writerLoop();
+
+    FrameBuffer *_framebuffer;
+
+    FrameBuffer *_previous;        /**< Bound before begin()                          */
+
+    unsigned int _width;
+
+    unsigned int _height;
+
+    string _path;
+
+    Format _format;
+
+    FILE *_raw;
+
+    Readback _readbacks[kReadbackDepth];
+
+    unsigned int _next_readback;   /**< Oldest readback, the next one reused          */
+
+    unsigned int _frame;
+
+    Frame _frames[kFrameCount];
+
+    vector<Frame*> _free;          /**< Frames not waiting for the disk               */
+
+    std::deque<Frame*> _queue;     /**< RAW frames for the writer, in order           */
+
+    std::mutex _mutex;             /**< Guards _free, _queue and _stopping            */
+
+    std::condition_variable _frame_ready;
+
+    std::thread _writer;
+
+    bool _stopping;
+
+    JobSystem::Counter _jobs;      /**< PNG frames being encoded                      */
+
+    std::atomic<unsigned int> _written;
+
+    std::atomic<unsigned int> _dropped;
+
+};
+
+#endif // _FRAME_CAPTURE
@@ -5,6 +5,25 @@
 
 using namespace gameplay;
 
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "MatchInput.h"
+#include "MatchLog.h"
+#include "FixedTimestep.h"
+#include "Telemetry.h"
+#include "TextureMap.h"
+#include "MaterialCache.h"
+#include "RenderQueue.h"
+#include "DrawList.h"
+#include "FrameCapture.h"
+#include "StaticBatcher.h"
+#include "CollisionProxies.h"
+#include "SceneBVH.h"
+#include "AssetLoader.h"
+#include "NodeRegistry.h"
+#include "RobotFleet.h"
+#include "BallPool.h"
+
 #define VERT_SHADER "res/shaders/textured.vert"
 #define FRAG_SHADER "res/shaders/textured.frag"
 #define DEF_SHADER "SPOT_LIGHT_COUNT 1; TEXTURE_DISCARD_ALPHA"
@@ -59,6 +78,77 @@ public:
      */
     void gamepadEvent(Gamepad::GamepadEvent evt, Gamepad* gamepad);
     
+    /**
+     * Returns true once the scene is loaded and update() runs the match.
+     *
+     * @return true if loading is done
+     */
+    bool isLoaded() const { return _loading_stage == LOAD_DONE; }
+    
+    /**
+     * Returns true while a match log is replayed.
+     *
+     * @return true if replaying
+     */
+    bool isReplaying() const { return _replaying; }
+    
+    /**
+     * Opens a match log and starts replaying it, stops recording.
+     *
+     * @param path match log, F5 and F6 use kMatchLogFile
+     */
+    void startReplay(const char* path = kMatchLogFile);
+    
+    /**
+     * Poses the recorded ticks that end by a match time, without stepping
+     * the physics, so a paused game draws the match at exactly that time.
+     * Stops replaying at the end of the log.
+     *
+     * @param time match time in seconds
+     * @return false if the log ended before the time
+     */
+    bool replayTo(double time);
+    
+    /**
+     * Returns the match time of the last tick run or posed.
+     *
+     * @return seconds since the match started
+     */
+    double getMatchTime() const { return _match_time; }
+    
+    /**
+     * Returns the match time at the end of the next recorded tick.
+     *
+     * @return seconds since the match started
+     */
+    double getReplayTime() const { return _replay_frame.time; }
+    
+    /**
+     * Draws a camera into an offscreen framebuffer every frame and streams
+     * the frames to disk, see FrameCapture.
+     *
+     * @param camera camera to capture
+     * @param width frame width
+     * @param height frame height
+     * @param path RAW file or PNG file pattern
+     * @param format file format
+     * @param offscreenOnly true to draw nothing else (no window)
+     * @return false if the capture could not be opened
+     */
+    bool startCapture(CameraPosition camera, unsigned int width, unsigned int height, const char* path, FrameCapture::Format format, bool offscreenOnly = false);
+    
+    /**
+     * Writes the frames in flight and stops capturing.
+     */
+    void stopCapture();
+    
+    /**
+     * Returns the capture started by startCapture().
+     *
+     * @return frame capture
+     */
+    const FrameCapture& getCapture() const { return _capture; }
+    
 protected:
 
     /**
@@ -82,10 +172,60 @@ protected:
     virtual void render(float elapsedTime);
     
     /**
-     * Draws the screen by visitin each node in the model.
+     * Runs the next main thread loading step, called by update() until the
+     * scene is ready.
+     */
+    void continueLoading();
+    
+    /**
+     * Loads the field bundle and scene.
+     */
+    void loadScene();
+    
+    /**
+     * Adds the robot, cameras, light, materials and floor to the scene.
+     */
+    void createSceneNodes();
+    
+    /**
+     * Draws the loading progress instead of the scene.
+     */
+    void drawLoadingProgress();
+    
+    /**
+     * Draws the time spent in each profiler zone during the last frame.
+     */
+    void drawProfiler();
+    
+    /**
+     * Builds the render queues of several cameras in one pass over the
+     * scene, must be called before drawScreen() for each of them.
+     *
+     * @param cameras cameras drawn this frame (duplicates are ignored)
+     * @param count number of cameras
+     */
+    void cullScene(const CameraPosition *cameras, unsigned int count);
+    
+    /**
+     * Sorts the render queues of several cameras and turns them into draw
+     * lists, as jobs, after cullScene().
+     *
+     * @param cameras cameras drawn this frame (duplicates are ignored)
+     * @param count number of cameras
+     */
+    void buildDrawLists(const CameraPosition *cameras, unsigned int count);
+    
+    /**
+     * Draws the draw lists built by buildDrawLists() for a camera.
      */
     void drawScreen(CameraPosition camera);
     
+    /**
+     * Culls and draws the captured camera into the capture's framebuffer
+     * at the capture's aspect ratio.
+     */
+    void drawCapture();
+    
     /**
      * Creates a camera and a hierarchy of nodes to allow easy rotation
      * relative to the X, Y and Z axis.
@@ -100,13 +240,53 @@ protected:
     /**
      *
      */
-    static void drawFrameRate(Font* font, const Vector4& color, unsigned int x, unsigned int y, unsigned int fps);
+    static void drawFrameRate(Font* font, const Vector4& color, unsigned int x, unsigned int y, unsigned int fps, unsigned int stateChanges);
     
     /**
      *
      */
     bool isInDeadband(float value) const;
     
+    /**
+     * Samples the gamepad's triggers, joysticks and buttons.
+     *
+     * @param input receives the current driver inputs
+     */
+    void readGamepad(MatchInput &input) const;
+    
+    /**
+     * Advances the match by one tick: ball launch, mechanism and robot, and
+     * appends the tick to the match log while recording.
+     *
+     * @param input driver inputs of the tick
+     * @param timestep tick length in seconds
+     */
+    void updateMatch(const MatchInput &input, float timestep);
+    
+    /**
+     * Feeds recorded ticks to updateMatch() at the replay speed.
+     *
+     * @param elapsedTime seconds since the last frame
+     */
+    void replayMatch(double elapsedTime);
+    
+    /**
+     * Sets the robot, mechanism and ball to a recorded tick.
+     *
+     * @param frame recorded tick
+     */
+    void poseTick(const MatchFrame &frame);
+    
+    /**
+     * Centers the overhead camera above the robot.
+     */
+    void followRobot();
+    
+    /**
+     * Stops replaying, the gamepad drives again.
+     */
+    void stopReplay();
+    
     // render variables & methods
     Node* _spotlight_node;
     
@@ -116,6 +296,8 @@ protected:
     
     Robot *_robot;
     
+    RobotFleet _fleet;             /**< Drives _robot (index 0) once its model is loaded */
+    
     double _elapsedTime;
     
     CameraPosition _active_camera;
@@ -127,15 +309,65 @@ private:
     /**
      * Adds a node to the appropriate render queue (opaque or transparent)
      * based on the "transparent" tag set in the node.  The "transparent"
-     * tag is set by loadTextureMap() based on the "transparent" boolean
+     * tag is set by setSceneMaterial() based on the "transparent" boolean
      * in the JSON file.
      */
     bool buildRenderQueues(Node* node);
     
+    /**
+     * Adds a node with a model to the static or dynamic culling items, used
+     * by buildSceneBVH().
+     */
+    bool collectCullingItems(Node* node);
+    
+    /**
+     * Returns true if a node can move: part of the robot, a game ball or
+     * driven by a non-static collision object (checked up the hierarchy).
+     */
+    bool isDynamicNode(Node* node) const;
+    
+    /**
+     * Returns the draw state (shader program and material cache entry) of
+     * a node, set by setMaterial().
+     */
+    unsigned int getDrawState(Node* node) const;
+    
+    /**
+     * Adds a static opaque node with a material to the static batcher, used
+     * by batchStaticNodes().
+     */
+    bool collectBatchCandidates(Node* node);
+    
+    /**
+     * Merges static nodes sharing a material into batch nodes, must run
+     * after the materials are set and before buildSceneBVH().
+     */
+    void batchStaticNodes(void);
+    
+    /**
+     * Builds the bounding volume hierarchy used by drawScreen() once the
+     * scene is complete.
+     */
+    void buildSceneBVH(void);
+    
+    /**
+     * Sets the material of every node with a model, on the main thread
+     * since materials create GL objects.
+     */
+    void setSceneMaterials(void);
+    
+    /**
+     * Adds a node with a model to the nodes setSceneMaterials() sets.
+     */
+    bool collectMaterialNodes(Node* node);
+    
     /**
      * Sets the material for a node and binds it to the scene's light sources.
+     *
+     * @param node node with a model
+     * @param entry texture map rule matching the node, NULL for none
      */
-    bool setSceneMaterial(Node* node);
+    void setSceneMaterial(Node* node, const TextureMap::Entry* entry);
     
     /**
      *
@@ -155,20 +387,23 @@ private:
      */
     CameraPosition getNextCamera(CameraPosition current) const;
     
-    /**
-     *
-     */
-    void loadTextureMap(const string &filename);
-
     // Render queue indexes (in order of drawing).
-    enum RenderQueue
+    enum RenderQueueIndex
     {
         QUEUE_OPAQUE = 0,
         QUEUE_TRANSPARENT,
         QUEUE_COUNT
     };
     
-    vector<Node*> _renderQueues[QUEUE_COUNT];
+    RenderQueue _renderQueues[CameraCount][QUEUE_COUNT];
+    
+    DrawList _drawLists[CameraCount][QUEUE_COUNT];
+    
+    vector<DrawList::Binding> _drawBindings;   /**< Indexed by SceneBVH::Item::binding */
+    
+    CameraPosition _culling_camera;    /**< Camera filled by buildRenderQueues()                 */
+    
+    unsigned int _state_changes;       /**< Program and material changes in the last frame        */
     
     Scene* _scene;
     
@@ -180,16 +415,103 @@ private:
     
     bool _physicsDebug;
     
-    bool _ball_in_play;
+    bool _launch_held;             /**< BUTTON_A was down in the last updateMatch()   */
     
     bool _view_frustrum_culling;
     
-    map<string, GPair<string, bool> > textureList;
+    bool _profiler_overlay;
+    
+    TextureMap _textureMap;
+    
+    MaterialCache _materialCache;
+    
+    StaticBatcher _staticBatcher;
+    
+    CollisionProxies _collisionProxies;
+    
+    SceneBVH _sceneBVH;
+    
+    vector<SceneBVH::Item> _staticItems;
+    
+    vector<SceneBVH::Item> _dynamicItems;
+    
+    vector<Node*> _materialNodes;
     
     static const int kHudWidth;
     
     static const int kHudHeight;
     
+    static const unsigned int kTexturesPerFrame;
+    
+    static const char *kMatchLogFile;      /**< Written by F5, replayed by F6         */
+    
+    static const char *kCaptureFile;       /**< Written by F8                         */
+    
+    static const double kReplaySpeeds[];   /**< Replay speeds cycled by F7            */
+    
+    // Loading steps, in order.
+    enum LoadingStage
+    {
+        LOAD_DECODING = 0,
+        LOAD_TEXTURES,
+        LOAD_SCENE,
+        LOAD_NODES,
+        LOAD_DONE
+    };
+    
+    /**
+     * Configuration read by the loader's job, handed to the main thread
+     * by continueLoading() once the job is done.
+     */
+    struct DecodedAssets
+    {
+        DecodedAssets() : robot(NULL) {}
+
+        Robot* robot;
+
+        TextureMap textureMap;
+    };
+    
+    AssetLoader* _loader;
+    
+    DecodedAssets* _decoded;       /**< Owned by the loader's job until it is done    */
+    
+    NodeRegistry _nodeRegistry;
+    
+    BallPool _ballPool;
+    
+    int _catapult_joint;           /**< Robot mechanism joint driven by BUTTON_B      */
+    
+    FixedTimestep _timestep;       /**< Steps of updateMatch()                        */
+    
+    unsigned long _match_tick;     /**< Ticks run by updateMatch()                    */
+    
+    double _match_time;            /**< Seconds run by updateMatch()                  */
+    
+    MatchRecorder _recorder;
+    
+    MatchPlayer _player;
+    
+    MatchFrame _replay_frame;      /**< Next recorded tick to replay                  */
+    
+    bool _replaying;
+    
+    unsigned int _replay_speed;    /**< Index into kReplaySpeeds                      */
+    
+    double _replay_clock;          /**< Scaled time not yet replayed (seconds)        */
+    
+    Telemetry _telemetry;          /**< State of every tick for external dashboards   */
+    
+    FrameCapture _capture;
+    
+    CameraPosition _capture_camera;
+    
+    bool _capture_only;            /**< Nothing is drawn to the window while capturing */
+    
+    NodeRegistry::Handle _overhead_handle;
+    
+    LoadingStage _loading_stage;
+    
 };
 
 #endif
@@ -0,0 +1,221 @@
+//
+//  JobSystem.h
+//  FrcSim
+//
+//
+
+#ifndef _JOB_SYSTEM
+#define _JOB_SYSTEM
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <vector>
+
+/**
+ * Work-stealing scheduler shared by the whole simulator.
+ *
+ * There is one worker per core but one, and every worker owns a deque: jobs
+ * a worker queues go on the back of its own deque and it takes them back
+ * from there (last in, first out, while the data is still in its cache),
+ * idle workers steal from the front of the other deques.  Threads that are
+ * not workers, the main thread in particular, queue on a shared deque.
+ * A thread waiting for a Counter runs queued jobs until the counter drops
+ * to zero, so the main thread is the extra core and nested waits cannot
+ * deadlock.  Workers sleep on a condition variable when nothing is queued.
+ *
+ * parallelFor() splits an index range into chunks, runs the first on the
+ * calling thread and the others as jobs; short ranges run inline.  Jobs
+ * must not touch GL, which only the main thread may use.
+ */
+class JobSystem
+{
+
+public:
+
+    typedef std::function<void()> Task;
+
+    typedef std::function<void(size_t begin, size_t end)> RangeTask;
+
+    /**
+     * Number of jobs not yet finished, waited on with wait().
+     */
+    class Counter
+    {
+
+    public:
+
+        Counter() : _pending(0) {}
+
+        /**
+         * Returns true once every job counted has finished.
+         *
+         * @return true if no job is pending
+         */
+        bool isDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+        /**
+         * Returns the number of jobs not yet finished.
+         *
+         * @return pending jobs
+         */
+        unsigned int getPending() const { return _pending.load(std::memory_order_acquire); }
+
+    private:
+
+        friend class JobSystem;
+
+        /**
+         * Hidden copy constructor.
+         */
+        Counter(const Counter &counter);
+
+        /**
+         * Hidden assignment operator.
+         */
+        Counter &operator=(const Counter &counter);
+
+        std::atomic<unsigned int> _pending;
+
+    };
+
+    /**
+     * Returns the scheduler, started with one worker per core but one on
+     * first use.
+     *
+     * @return the shared instance
+     */
+    static JobSystem &getInstance();
+
+    /**
+     * Constructor.
+     *
+     * @param workerCount number of worker threads, 0 for one per core but one
+     */
+    explicit JobSystem(unsigned int workerCount = 0);
+
+    /**
+     * Destructor, runs the queued jobs and stops the workers.
+     */
+    ~JobSystem();
+
+    /**
+     * Queues a job, jobs may queue more jobs.
+     *
+     * @param task function to run
+     * @param counter if not NULL, counts the job until it has run
+     */
+    void run(const Task &task, Counter *counter = NULL);
+
+    /**
+     * Runs queued jobs until every job counted by a counter has finished.
+     *
+     * @param counter counter passed to run()
+     */
+    void wait(const Counter &counter);
+
+    /**
+     * Runs a task over [begin, end) in chunks of at least grain indices and
+     * returns when every chunk has run.
+     *
+     * @param begin first index
+     * @param end one past the last index
+     * @param grain smallest chunk worth a job
+     * @param task function called with each chunk
+     */
+    void parallelFor(size_t begin, size_t end, size_t grain, const RangeTask &task);
+
+    /**
+     * Returns the number of worker threads.
+     *
+     * @return number of worker threads
+     */
+    unsigned int getWorkerCount() const { return (unsigned int)_workers.size(); }
+
+    /**
+     * Returns the number of threads running jobs, the workers and a waiting
+     * thread.
+     *
+     * @return number of threads
+     */
+    unsigned int getThreadCount() const { return (unsigned int)_workers.size() + 1; }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    JobSystem(const JobSystem &jobs);
+
+    /**
+     * Hidden assignment operator.
+     */
+    JobSystem &operator=(const JobSystem &jobs);
+
+    /**
+     * Queued job.
+     */
+    struct Job
+    {
+        Task task;
+
+        Counter *counter;
+    };
+
+    /**
+     * Deque of one worker, or the shared one, padded so that no two deques
+     * share a cache line.
+     */
+    struct Queue
+    {
+        std::mutex mutex;
+
+        std::deque<Job> jobs;
+
+        char padding[64];
+    };
+
+    /**
+     * Takes a job for a thread: its own deque first, then the others.
+     *
+     * @param queue deque of the calling thread
+     * @param job receives the job
+     * @return false if every deque is empty
+     */
+    bool take(unsigned int queue, Job &job);
+
+    /**
+     * Runs a job and counts it as finished.
+     */
+    void execute(Job &job);
+
+    /**
+     * Returns the deque of the calling thread.
+     */
+    unsigned int getQueue() const;
+
+    /**
+     * Worker thread body.
+     */
+    void workerLoop(unsigned int index);
+
+    std::vector<Queue*> _queues;   /**< One per worker, the shared one last           */
+
+    std::vector<std::thread> _workers;
+
+    std::atomic<unsigned int> _queued;     /**< Jobs in any deque                     */
+
+    std::atomic<unsigned int> _sleeping;   /**< Workers waiting for _wake             */
+
+    std::atomic<bool> _stopping;
+
+    std::mutex _sleep_mutex;
+
+    std::condition_variable _wake;
+
+};
+
+#endif // _JOB_SYSTEM
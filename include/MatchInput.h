@@ -0,0 +1,64 @@
+//
+//  MatchInput.h
+//  FrcSim
+//
+//
+
+#ifndef _MATCH_INPUT
+#define _MATCH_INPUT
+
+/**
+ * Driver inputs sampled for a single simulation step.
+ *
+ * AerialAssist::update() fills this in from the gamepad, the headless
+ * simulation gets it from the command line or a script.
+ */
+struct MatchInput
+{
+    /**
+     * Default constructor (no inputs active).
+     */
+    MatchInput() :
+        leftTrigger(0.0f),
+        rightTrigger(0.0f),
+        leftStick(Vector2::zero()),
+        rightStick(Vector2::zero()),
+        launchBall(false),
+        fireCatapult(false)
+    {
+    }
+
+    /**
+     * Converts the triggers to a velocity setpoint, the right trigger drives
+     * forward and takes precedence over the left trigger (reverse).
+     *
+     * @param deadband trigger values within +/- deadband are ignored
+     * @return velocity setpoint in percent of maximum
+     */
+    float getThrottle(float deadband) const
+    {
+        if (rightTrigger <= -deadband || rightTrigger >= deadband)
+        {
+            return rightTrigger;
+        }
+        if (leftTrigger <= -deadband || leftTrigger >= deadband)
+        {
+            return -1.0f * leftTrigger;
+        }
+        return 0.0f;
+    }
+
+    float leftTrigger;             /**< Left trigger (reverse), 0.0 to 1.0            */
+
+    float rightTrigger;            /**< Right trigger (forward), 0.0 to 1.0           */
+
+    Vector2 leftStick;             /**< Left joystick position                        */
+
+    Vector2 rightStick;            /**< Right joystick position                       */
+
+    bool launchBall;               /**< BUTTON_A, put the game ball in play           */
+    
+    bool fireCatapult;             /**< BUTTON_B, swing the catapult while held       */
+};
+
+#endif // _MATCH_INPUT
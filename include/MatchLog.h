@@ -0,0 +1,302 @@
+//
+//  MatchLog.h
+//  FrcSim
+//
+//
+
+#ifndef _MATCH_LOG
+#define _MATCH_LOG
+
+#include <stdint.h>
+
+/**
+ * Driver inputs of one tick and the robot and ball state after it.
+ */
+struct MatchFrame
+{
+    /**
+     * Values stored per frame, each as the raw bits of its float or double.
+     */
+    enum Field
+    {
+        TIMESTEP,
+        LEFT_TRIGGER,
+        RIGHT_TRIGGER,
+        LEFT_STICK_X,
+        LEFT_STICK_Y,
+        RIGHT_STICK_X,
+        RIGHT_STICK_Y,
+        FLAGS,
+        ROBOT_X,
+        ROBOT_Y,
+        ROBOT_Z,
+        ROBOT_YAW,
+        ROBOT_VELOCITY,
+        ROBOT_SETPOINT,
+        BALL_X,
+        BALL_Y,
+        BALL_Z,
+        BALL_LINEAR_X,
+        BALL_LINEAR_Y,
+        BALL_LINEAR_Z,
+        BALL_ANGULAR_X,
+        BALL_ANGULAR_Y,
+        BALL_ANGULAR_Z,
+        FIELD_COUNT
+    };
+
+    /**
+     * Bits of the FLAGS field.
+     */
+    enum Flag
+    {
+        FLAG_LAUNCH_BALL = 1,
+        FLAG_FIRE_CATAPULT = 2,
+        FLAG_BALL_IN_PLAY = 4
+    };
+
+    MatchFrame();
+
+    /**
+     * Packs the frame into raw field values.
+     *
+     * @param fields receives FIELD_COUNT values
+     */
+    void getFields(uint64_t *fields) const;
+
+    /**
+     * Unpacks raw field values, tick and time are not part of the fields.
+     *
+     * @param fields FIELD_COUNT values
+     */
+    void setFields(const uint64_t *fields);
+
+    unsigned long tick;            /**< Ticks taken including this one                */
+
+    double time;                   /**< Simulated seconds after this tick             */
+
+    float timestep;                /**< Length of this tick in seconds                */
+
+    MatchInput input;              /**< Driver inputs applied during this tick        */
+
+    Vector3 robotPosition;
+
+    float robotYaw;
+
+    double robotVelocity;
+
+    double robotSetpoint;
+
+    bool ballInPlay;
+
+    Vector3 ballPosition;
+
+    Vector3 ballLinearVelocity;
+
+    Vector3 ballAngularVelocity;
+};
+
+/**
+ * Writes a match log.
+ *
+ * The log is a 16 byte header ('FRCR', version, keyframe interval) followed
+ * by one record per tick.  A keyframe record holds the tick, the time and
+ * every field; the other records hold a bit mask of the fields that changed
+ * since the previous tick and, for each of them, the XOR of the old and new
+ * bits.  Every number is written as a LEB128 varint, so untouched inputs
+ * cost nothing and a slowly moving value a few bytes, while replays stay
+ * bit exact.
+ */
+class MatchRecorder
+{
+
+public:
+
+    static const uint32_t kMagic = 0x52435246;     /**< 'FRCR' little endian         */
+
+    static const uint32_t kVersion = 1;
+
+    static const unsigned int kDefaultKeyframeInterval = 200;  /**< Ticks, 1 sec at 200 Hz */
+
+    /**
+     * Default constructor.
+     */
+    MatchRecorder();
+
+    /**
+     * Destructor, closes the log.
+     */
+    ~MatchRecorder();
+
+    /**
+     * Creates a log, replacing an existing file.
+     *
+     * @param filename path of the log
+     * @param keyframeInterval ticks between keyframes
+     * @return true if the file was created
+     */
+    bool open(const string &filename, unsigned int keyframeInterval = kDefaultKeyframeInterval);
+
+    /**
+     * Appends a tick.
+     *
+     * @param frame inputs and state of the tick
+     */
+    void record(const MatchFrame &frame);
+
+    /**
+     * Flushes and closes the log.
+     */
+    void close();
+
+    /**
+     * Returns true while a log is open.
+     *
+     * @return true if recording
+     */
+    bool isOpen() const { return _file != NULL; }
+
+    /**
+     * Returns the number of bytes written, header included.
+     *
+     * @return bytes written
+     */
+    unsigned long getBytesWritten() const { return _bytes; }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    MatchRecorder(const MatchRecorder &recorder);
+
+    /**
+     * Hidden assignment operator.
+     */
+    MatchRecorder &operator=(const MatchRecorder &recorder);
+
+    FILE *_file;
+
+    unsigned int _keyframe_interval;
+
+    unsigned long _frames;         /**< Records written                               */
+
+    unsigned long _bytes;
+
+    uint64_t _previous[MatchFrame::FIELD_COUNT];
+
+    vector<uint8_t> _buffer;       /**< Encoded record                                */
+
+};
+
+/**
+ * Reads a match log written by MatchRecorder.
+ */
+class MatchPlayer
+{
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    MatchPlayer();
+
+    /**
+     * Reads a log and indexes its keyframes.
+     *
+     * @param filename path of the log
+     * @return true if the file is a readable log
+     */
+    bool open(const string &filename);
+
+    /**
+     * Decodes the next tick.
+     *
+     * @param frame receives the tick
+     * @return false at the end of the log
+     */
+    bool next(MatchFrame &frame);
+
+    /**
+     * Moves to the last keyframe at or before a tick.  The keyframe's state
+     * is where a world has to be put before the following ticks replay.
+     *
+     * @param tick tick to seek to
+     * @param frame receives the keyframe
+     * @return false if the log has no keyframe at or before the tick
+     */
+    bool seek(unsigned long tick, MatchFrame &frame);
+
+    /**
+     * Moves to the last keyframe at or before a simulated time, using the
+     * times recorded in the log whatever timestep it was recorded with.
+     *
+     * @param time seconds to seek to
+     * @param frame receives the keyframe
+     * @return false if the log has no keyframe at or before the time
+     */
+    bool seekTime(double time, MatchFrame &frame);
+
+    /**
+     * Moves back to the first tick.
+     */
+    void rewind();
+
+    /**
+     * Returns the number of ticks in the log.
+     *
+     * @return number of ticks
+     */
+    unsigned long getFrameCount() const { return _frame_count; }
+
+    /**
+     * Returns the simulated time at the end of the log.
+     *
+     * @return seconds
+     */
+    double getDuration() const { return _duration; }
+
+private:
+
+    /**
+     * Position of a keyframe in the log.
+     */
+    struct Keyframe
+    {
+        unsigned long tick;
+
+        double time;               /**< Simulated seconds after the keyframe's tick   */
+
+        size_t offset;
+    };
+
+    /**
+     * Decodes the record at _offset.
+     */
+    bool decode(MatchFrame &frame);
+
+    /**
+     * Reads a varint at _offset.
+     */
+    bool readVarint(uint64_t &value);
+
+    vector<uint8_t> _data;
+
+    size_t _offset;                /**< Next record                                   */
+
+    uint64_t _previous[MatchFrame::FIELD_COUNT];
+
+    unsigned long _tick;           /**< Tick of the last decoded record               */
+
+    double _time;
+
+    vector<Keyframe> _keyframes;
+
+    unsigned long _frame_count;
+
+    double _duration;
+
+};
+
+#endif // _MATCH_LOG
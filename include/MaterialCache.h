@@ -0,0 +1,169 @@
+//
+//  MaterialCache.h
+//  FrcSim
+//
+//
+
+#ifndef _MATERIAL_CACHE
+#define _MATERIAL_CACHE
+
+/**
+ * Render state shared by every node using the same shader defines, texture,
+ * transparency and specularity.
+ *
+ * GamePlay binds a material's auto parameters (world view matrix etc.) to
+ * the node owning it, so each node still gets its own Material.  Everything
+ * else comes from the cache: one Texture::Sampler per texture (loaded and
+ * configured once) and one StateBlock per entry.  The effect itself is
+ * shared through GamePlay's effect cache because every entry uses the same
+ * shader files and defines.
+ *
+ * The cache also remembers the entry of every node it set up, so drawing
+ * can sort by entry without looking at the node's tags.
+ */
+class MaterialCache
+{
+
+public:
+
+    static const unsigned int kNoEntry = 0xFFFFFFFF;    /**< Node without a cached material */
+
+    /**
+     * Lookup key, one entry per distinct combination.
+     */
+    struct Key
+    {
+        Key(const char *d, const char *t, bool a, float s) :
+            defines(d ? d : ""), texture(t ? t : ""), transparent(a), specularity(s) {}
+
+        bool operator<(const Key &key) const
+        {
+            if (defines != key.defines) return defines < key.defines;
+            if (texture != key.texture) return texture < key.texture;
+            if (transparent != key.transparent) return transparent < key.transparent;
+            return specularity < key.specularity;
+        }
+
+        string defines;            /**< Shader defines                                */
+
+        string texture;            /**< Path of the diffuse texture                   */
+
+        bool transparent;          /**< Node is drawn in the transparent queue        */
+
+        float specularity;         /**< Specular exponent                             */
+    };
+
+    /**
+     * Shared render state for a key.
+     */
+    struct Entry
+    {
+        Entry() : id(0), sampler(NULL), stateBlock(NULL) {}
+
+        unsigned int id;           /**< Small unique number, in creation order        */
+
+        Texture::Sampler *sampler; /**< Diffuse texture sampler                       */
+
+        RenderState::StateBlock *stateBlock;   /**< Cull and depth state              */
+    };
+
+    /**
+     * Default constructor.
+     */
+    MaterialCache();
+
+    /**
+     * Destructor, releases the cached samplers and state blocks.
+     */
+    ~MaterialCache();
+
+    /**
+     * Returns the entry for a key, creating it the first time the key is seen.
+     *
+     * @param key shader defines, texture, transparency and specularity
+     * @return shared render state
+     */
+    const Entry &get(const Key &key);
+
+    /**
+     * Adds an already loaded texture, used instead of loading the file
+     * the first time an entry names it.
+     *
+     * @param path path the texture is named by
+     * @param texture texture, referenced by the cache
+     */
+    void addTexture(const string &path, Texture *texture);
+
+    /**
+     * Returns the key of an entry.
+     *
+     * @param id entry ID
+     * @return key, NULL if there is no such entry
+     */
+    const Key *getKey(unsigned int id) const;
+
+    /**
+     * Records the entry a node's material was set up from.
+     *
+     * @param node node with a model
+     * @param id entry ID
+     */
+    void setNodeEntry(const Node *node, unsigned int id) { _nodes[node] = id; }
+
+    /**
+     * Returns the entry a node's material was set up from.
+     *
+     * @param node node
+     * @return entry ID, kNoEntry if the node has no cached material
+     */
+    unsigned int getNodeEntry(const Node *node) const;
+
+    /**
+     * Releases every entry.
+     */
+    void clear();
+
+    /**
+     * Returns the number of distinct entries.
+     *
+     * @return number of entries
+     */
+    size_t getEntryCount() const { return _entries.size(); }
+
+    /**
+     * Returns the number of lookups satisfied by an existing entry.
+     *
+     * @return number of cache hits
+     */
+    unsigned int getHitCount() const { return _hits; }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    MaterialCache(const MaterialCache &cache);
+
+    /**
+     * Hidden assignment operator.
+     */
+    MaterialCache &operator=(const MaterialCache &cache);
+
+    /**
+     * Returns the sampler for a texture, creating it the first time.
+     */
+    Texture::Sampler *getSampler(const string &texture);
+
+    map<Key, Entry> _entries;
+
+    vector<const Key*> _keys;      /**< Keys of _entries, indexed by entry ID        */
+
+    map<const Node*, unsigned int> _nodes;     /**< Entry ID of each node set up      */
+
+    map<string, Texture::Sampler*> _samplers;
+
+    unsigned int _hits;
+
+};
+
+#endif // _MATERIAL_CACHE
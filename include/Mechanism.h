@@ -0,0 +1,229 @@
+//
+//  Mechanism.h
+//  FrcSim
+//
+//
+
+#ifndef _MECHANISM
+#define _MECHANISM
+
+#include "CookedCache.h"
+#include "Snapshot.h"
+
+/**
+ * Moving parts of a robot, read from the "motionList" of its configuration.
+ *
+ * Every entry becomes a compact joint: the node it moves, one axis, angular
+ * (degrees) or linear (inches), limits, a rate and a rest offset for models
+ * whose neutral pose is not the zero of the joint.  update() moves every
+ * joint toward its target at its rate within its limits; a joint with
+ * "reset" returns to its minimum when its target is released.  A node's
+ * transform is only written when its joint actually moved.
+ *
+ *     {
+ *         "name" : "Catapult",          node ID below the robot's top node
+ *         "motion" : "angular",         or "linear"
+ *         "rotationAxis" : "x",         "translationAxis" for linear joints
+ *         "minAngle" : 0,               "minPosition" for linear joints
+ *         "maxAngle" : 120,             "maxPosition" for linear joints
+ *         "offsetAngle" : -90,          "offsetPosition", optional
+ *         "rate" : 360,                 per second, optional
+ *         "reset" : true                optional
+ *     }
+ */
+class Mechanism
+{
+
+public:
+
+    static const float kDefaultRate;   /**< Units per second without a "rate"        */
+
+    /**
+     * Kind of motion.
+     */
+    enum Motion
+    {
+        ANGULAR,
+        LINEAR
+    };
+
+    /**
+     * One moving part.
+     */
+    struct Joint
+    {
+        Joint() : node(NULL), motion(ANGULAR), axis(0), reset(false), minimum(0.0f), maximum(0.0f), offset(0.0f), rate(kDefaultRate), value(0.0f), previous(0.0f), target(0.0f), origin(Vector3::zero()) {}
+
+        string name;               /**< Node ID                                       */
+
+        Node *node;                /**< Resolved by bind(), NULL until then           */
+
+        Motion motion;
+
+        unsigned char axis;        /**< 0 = x, 1 = y, 2 = z                           */
+
+        bool reset;                /**< Returns to minimum when released              */
+
+        float minimum;
+
+        float maximum;
+
+        float offset;              /**< Added to the value when posing the node       */
+
+        float rate;                /**< Maximum change per second                     */
+
+        float value;               /**< Current position within [minimum, maximum]    */
+
+        float previous;            /**< Value before the last update()                */
+
+        float target;
+
+        Vector3 origin;            /**< Node translation at bind(), linear joints     */
+    };
+
+    /**
+     * Default constructor.
+     */
+    Mechanism();
+
+    /**
+     * Copy constructor, joints are copied unbound.
+     *
+     * @param mechanism an existing instance to copy from
+     */
+    Mechanism(const Mechanism &mechanism);
+
+    /**
+     * Assignment operator, joints are copied unbound.
+     *
+     * @param mechanism an existing instance to copy from
+     * @return reference to this instance
+     */
+    Mechanism &operator=(const Mechanism &mechanism);
+
+    /**
+     * Replaces the joints with a "motionList" array.
+     *
+     * @param motionList JSON array of joints, may be null
+     */
+    void Deserialize(const Json::Value &motionList);
+
+    /**
+     * Writes the joints as a "motionList" array.
+     *
+     * @param motionList receives the joints
+     */
+    void Serialize(Json::Value &motionList) const;
+
+    /**
+     * Writes the joints to a cooked file.
+     *
+     * @param writer cooked payload
+     */
+    void Cook(CookedCache::Writer &writer) const;
+
+    /**
+     * Replaces the joints with the ones written by Cook().
+     *
+     * @param reader cooked payload
+     * @return true if the joints were read
+     */
+    bool ReadCooked(CookedCache::Reader &reader);
+
+    /**
+     * Appends every joint's position and target to a snapshot.
+     *
+     * @param snapshot receives the joints
+     */
+    void capture(Snapshot &snapshot) const;
+
+    /**
+     * Reads the joints written by capture() and poses the bound nodes.
+     *
+     * @param snapshot snapshot positioned at the joints
+     * @return true if every joint was read
+     */
+    bool restore(Snapshot &snapshot);
+
+    /**
+     * Returns the bytes capture() appends.
+     *
+     * @return snapshot size of the joints
+     */
+    size_t getSnapshotSize() const { return _joints.size() * 2 * sizeof(float); }
+
+    /**
+     * Resolves every joint's node below the robot and poses it.
+     *
+     * @param root robot's top node, NULL to unbind
+     */
+    void bind(Node *root);
+
+    /**
+     * Moves every joint toward its target.
+     *
+     * @param elapsedTime seconds since the last update
+     */
+    void update(float elapsedTime);
+
+    /**
+     * Poses the bound nodes between their values before and after the last
+     * update(), for frames drawn between two fixed steps.  The next update()
+     * poses them at their values again.
+     *
+     * @param alpha 0.0 poses the previous values, 1.0 the current ones
+     */
+    void interpolate(float alpha);
+
+    /**
+     * Finds a joint by name.
+     *
+     * @param name node ID of the joint
+     * @return joint index, -1 if there is none
+     */
+    int find(const char *name) const;
+
+    /**
+     * Sets where a joint moves to, clamped to its limits.
+     *
+     * @param index joint index
+     * @param target joint position
+     */
+    void setTarget(unsigned int index, float target);
+
+    /**
+     * Drives a joint to its maximum, or releases it.  A released joint with
+     * "reset" returns to its minimum, one without stays where it is.
+     *
+     * @param index joint index
+     * @param engaged true to drive the joint to its maximum
+     */
+    void setEngaged(unsigned int index, bool engaged);
+
+    /**
+     * Returns the number of joints.
+     *
+     * @return number of joints
+     */
+    size_t size() const { return _joints.size(); }
+
+    /**
+     * Returns a joint.
+     *
+     * @param index joint index
+     * @return joint
+     */
+    const Joint &getJoint(unsigned int index) const { return _joints[index]; }
+
+private:
+
+    /**
+     * Writes a joint position to its node.
+     */
+    static void pose(const Joint &joint, float value);
+
+    vector<Joint> _joints;
+
+};
+
+#endif // _MECHANISM
@@ -0,0 +1,154 @@
+//
+//  NodeRegistry.h
+//  FrcSim
+//
+//
+
+#ifndef _NODE_REGISTRY
+#define _NODE_REGISTRY
+
+#include <stdint.h>
+
+/**
+ * Index of the scene's nodes by ID, handing out handles that resolve in
+ * constant time.
+ *
+ * Scene::findNode() compares strings down the whole graph on every call.
+ * Game logic instead resolves a handle once at load time with find() and
+ * calls get() every tick, which is an index and a generation compare.  A
+ * node removed with remove() (or by clear()) bumps its slot's generation,
+ * so old handles resolve to NULL instead of a dangling pointer.  The
+ * registry holds a reference on every node it knows.
+ */
+class NodeRegistry
+{
+
+public:
+
+    /**
+     * Stable reference to a registered node.
+     */
+    struct Handle
+    {
+        Handle() : index(0), generation(0) {}
+
+        bool isValid() const { return generation != 0; }
+
+        uint32_t index;            /**< Slot                                          */
+
+        uint32_t generation;       /**< Slot generation when the handle was made, 0
+                                        for an invalid handle                         */
+    };
+
+    /**
+     * Default constructor.
+     */
+    NodeRegistry();
+
+    /**
+     * Destructor, releases every node.
+     */
+    ~NodeRegistry();
+
+    /**
+     * Registers every node of a scene, replacing the current content.
+     *
+     * @param scene scene to index
+     */
+    void build(Scene *scene);
+
+    /**
+     * Registers a node (and not its children).
+     *
+     * @param node node to register
+     * @return handle of the node
+     */
+    Handle add(Node *node);
+
+    /**
+     * Unregisters a node, its handles become invalid.
+     *
+     * @param node node to unregister
+     */
+    void remove(Node *node);
+
+    /**
+     * Unregisters every node.
+     */
+    void clear();
+
+    /**
+     * Finds a node by ID, nodes sharing an ID are returned in scene order.
+     *
+     * @param id node ID
+     * @param ancestor if not NULL, only nodes below (or equal to) this node match
+     * @return handle, invalid if no node matches
+     */
+    Handle find(const char *id, const Node *ancestor = NULL) const;
+
+    /**
+     * Resolves a handle.
+     *
+     * @param handle handle from find() or add()
+     * @return node, NULL if the handle is invalid or the node was removed
+     */
+    Node *get(Handle handle) const
+    {
+        if (handle.index >= _slots.size() || _slots[handle.index].generation != handle.generation)
+        {
+            return NULL;
+        }
+        return _slots[handle.index].node;
+    }
+
+    /**
+     * Returns the number of registered nodes.
+     *
+     * @return number of nodes
+     */
+    size_t size() const { return _index.size(); }
+
+    /**
+     * 32 bit FNV-1a hash of a node ID.
+     *
+     * @param id node ID
+     * @return hash
+     */
+    static uint32_t hashId(const char *id);
+
+private:
+
+    /**
+     * Node storage, reused once freed.
+     */
+    struct Slot
+    {
+        Node *node;
+
+        uint32_t generation;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    NodeRegistry(const NodeRegistry &registry);
+
+    /**
+     * Hidden assignment operator.
+     */
+    NodeRegistry &operator=(const NodeRegistry &registry);
+
+    /**
+     * Scene::visit() callback for build().
+     */
+    bool visitNode(Node *node);
+
+    vector<Slot> _slots;
+
+    vector<uint32_t> _free;        /**< Freed slots                                   */
+
+    multimap<uint32_t, uint32_t> _index;   /**< ID hash to slot, in registration order */
+
+};
+
+#endif // _NODE_REGISTRY
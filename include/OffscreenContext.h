@@ -0,0 +1,84 @@
+//
+//  OffscreenContext.h
+//  FrcSim
+//
+//
+
+#ifndef _OFFSCREEN_CONTEXT
+#define _OFFSCREEN_CONTEXT
+
+/**
+ * Desktop GL context on an EGL pbuffer, for rendering without a display.
+ *
+ * create() prefers an EGL device (EGL_EXT_device_enumeration), which needs
+ * neither an X server nor a GPU: Mesa lists a software device that renders
+ * with llvmpipe.  Without the extension it falls back to the default
+ * display.  The pbuffer is only there to make the context current, frames
+ * are drawn into a FrameCapture's framebuffer of any size.  GL entry points
+ * are loaded through GLEW the way GamePlay's platform layer does after it
+ * creates its window.  Linux only.
+ */
+class OffscreenContext
+{
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    OffscreenContext();
+
+    /**
+     * Destructor, destroys the context.
+     */
+    ~OffscreenContext();
+
+    /**
+     * Creates the context and makes it current on the calling thread.
+     *
+     * @param width pbuffer width
+     * @param height pbuffer height
+     * @return false if no EGL display offers a desktop GL pbuffer
+     */
+    bool create(unsigned int width = 16, unsigned int height = 16);
+
+    /**
+     * Releases and destroys the context.
+     */
+    void destroy();
+
+    /**
+     * Returns true once create() has succeeded.
+     *
+     * @return true if the context is current
+     */
+    bool isCreated() const { return _context != NULL; }
+
+    /**
+     * Returns the GL renderer string, to tell a GPU from llvmpipe in logs.
+     *
+     * @return GL_RENDERER, empty if no context
+     */
+    const char *getRenderer() const;
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    OffscreenContext(const OffscreenContext &context);
+
+    /**
+     * Hidden assignment operator.
+     */
+    OffscreenContext &operator=(const OffscreenContext &context);
+
+    void *_display;                /**< EGLDisplay                                    */
+
+    void *_surface;                /**< EGLSurface, the pbuffer                       */
+
+    void *_context;                /**< EGLContext                                    */
+
+};
+
+#endif // _OFFSCREEN_CONTEXT
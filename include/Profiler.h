@@ -0,0 +1,241 @@
+//
+//  Profiler.h
+//  FrcSim
+//
+//
+
+#ifndef _PROFILER
+#define _PROFILER
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Zones are compiled in for debug builds, or any build with FRCSIM_PROFILE
+#if defined(DEBUG) || defined(FRCSIM_PROFILE)
+#define FRCSIM_PROFILING 1
+#endif
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef FRCSIM_PROFILING
+/**
+ * Times the rest of the enclosing scope, name must be a string literal.
+ */
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(_profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) do {} while (0)
+#endif // FRCSIM_PROFILING
+
+/**
+ * Hierarchical frame profiler.
+ *
+ * PROFILE_ZONE() records a begin/end time pair when its scope exits.  Each
+ * thread writes its zones to its own fixed size ring (single producer, the
+ * main thread is the only consumer), so recording takes no lock; zones are
+ * dropped while a ring is full.  endFrame() drains every ring: zones of the
+ * main thread are summed per name and depth for the overlay, and while a
+ * capture is running every zone is kept and written as Chrome trace JSON
+ * (chrome://tracing, Perfetto) when the capture ends.
+ */
+class Profiler
+{
+
+public:
+
+    static const unsigned int kRingSize = 8192;    /**< Zones per thread ring (power of 2) */
+
+    /**
+     * Finished zone.
+     */
+    struct Event
+    {
+        const char *name;
+
+        uint64_t start;            /**< Nanoseconds, see now()                        */
+
+        uint64_t end;
+
+        uint32_t depth;            /**< Number of enclosing zones on the thread       */
+    };
+
+    /**
+     * Time spent in a zone of the main thread during the last frame.
+     */
+    struct ZoneTime
+    {
+        const char *name;
+
+        uint32_t depth;
+
+        uint32_t count;            /**< Times the zone was entered                    */
+
+        double milliseconds;
+
+        uint64_t start;            /**< First time the zone was entered               */
+    };
+
+    /**
+     * Returns the profiler.
+     *
+     * @return the only instance
+     */
+    static Profiler &getInstance();
+
+    /**
+     * Returns a monotonic time stamp.
+     *
+     * @return nanoseconds since an arbitrary start
+     */
+    static uint64_t now();
+
+    /**
+     * Records a finished zone on the calling thread's ring.
+     *
+     * @param event finished zone
+     */
+    void record(const Event &event);
+
+    /**
+     * Drains every thread's ring, called once per frame by the main thread.
+     */
+    void endFrame();
+
+    /**
+     * Returns the main thread's zones of the last frame, in the order they
+     * were first entered.
+     *
+     * @return zone times
+     */
+    const std::vector<ZoneTime> &getFrameZones() const { return _frame_zones; }
+
+    /**
+     * Starts keeping every zone of the next frames for a trace.
+     *
+     * @param frames number of frames to capture
+     * @param path file the Chrome trace JSON is written to
+     */
+    void startCapture(unsigned int frames, const std::string &path);
+
+    /**
+     * Returns true while a capture is running.
+     *
+     * @return true if zones are being kept for a trace
+     */
+    bool isCapturing() const { return _capture_frames > 0; }
+
+    /**
+     * Returns the number of zones dropped because a ring was full.
+     *
+     * @return number of dropped zones
+     */
+    uint64_t getDroppedCount() const { return _dropped; }
+
+private:
+
+    /**
+     * Ring of one thread.
+     */
+    struct ThreadRing
+    {
+        ThreadRing() : head(0), tail(0), thread(0) {}
+
+        Event events[kRingSize];
+
+        std::atomic<uint32_t> head;    /**< Next slot written by the owner thread      */
+
+        std::atomic<uint32_t> tail;    /**< Next slot read by endFrame()               */
+
+        uint32_t thread;               /**< Thread number in the trace                 */
+    };
+
+    /**
+     * Constructor.
+     */
+    Profiler();
+
+    /**
+     * Hidden copy constructor.
+     */
+    Profiler(const Profiler &profiler);
+
+    /**
+     * Hidden assignment operator.
+     */
+    Profiler &operator=(const Profiler &profiler);
+
+    /**
+     * Returns the calling thread's ring, created on first use.
+     */
+    ThreadRing *getRing();
+
+    /**
+     * Writes the captured zones.
+     */
+    void writeTrace();
+
+    std::mutex _mutex;             /**< Guards _rings                                 */
+
+    std::vector<ThreadRing*> _rings;
+
+    ThreadRing *_main_ring;        /**< Ring of the thread calling endFrame()         */
+
+    std::vector<ZoneTime> _frame_zones;
+
+    std::vector<Event> _capture;
+
+    std::vector<uint32_t> _capture_threads;
+
+    unsigned int _capture_frames;
+
+    std::string _capture_path;
+
+    std::atomic<uint64_t> _dropped;
+
+};
+
+/**
+ * Scope timed by PROFILE_ZONE().
+ */
+class ProfileZone
+{
+
+public:
+
+    explicit ProfileZone(const char *name) : _name(name), _start(Profiler::now())
+    {
+        _depth = _thread_depth++;
+    }
+
+    ~ProfileZone()
+    {
+        Profiler::Event event;
+        event.name = _name;
+        event.start = _start;
+        event.end = Profiler::now();
+        event.depth = _depth;
+        _thread_depth--;
+        Profiler::getInstance().record(event);
+    }
+
+private:
+
+    ProfileZone(const ProfileZone &zone);
+
+    ProfileZone &operator=(const ProfileZone &zone);
+
+    static thread_local uint32_t _thread_depth;
+
+    const char *_name;
+
+    uint64_t _start;
+
+    uint32_t _depth;
+
+};
+
+#endif // _PROFILER
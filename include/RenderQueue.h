@@ -0,0 +1,110 @@
+//
+//  RenderQueue.h
+//  FrcSim
+//
+//
+
+#ifndef _RENDER_QUEUE
+#define _RENDER_QUEUE
+
+/**
+ * Nodes to draw for one camera and one pass, with a packed sort key.
+ *
+ * Every node carries a draw state made of its shader program (16 bits) and
+ * its material cache entry (16 bits).  Opaque queues sort on
+ * [program | material | depth] so nodes sharing a shader and texture are
+ * drawn together, nearest first within a group so early depth rejection
+ * works.  Transparent queues sort on depth alone, farthest first, so
+ * blending composes correctly.  Depth is the distance along the camera's
+ * forward vector, stored as the raw bits of the non-negative float which
+ * compare in the same order as the values.
+ *
+ * The queue only collects and orders nodes; DrawList draws them.
+ */
+class RenderQueue
+{
+
+public:
+
+    static const unsigned int kNoBinding = 0xFFFFFFFF;    /**< Node drawn with its own bindings */
+
+    /**
+     * Queued node.
+     */
+    struct Draw
+    {
+        unsigned long long key;    /**< Sort key, set by sort()                       */
+
+        Node *node;
+
+        unsigned int state;        /**< Program and material, see makeState()         */
+
+        unsigned int binding;      /**< Parameters DrawList sets, or kNoBinding        */
+    };
+
+    /**
+     * Packs a shader program and material cache entry into a draw state.
+     *
+     * @param program GL program name
+     * @param material material cache entry ID
+     * @return draw state
+     */
+    static unsigned int makeState(unsigned int program, unsigned int material)
+    {
+        return ((program & 0xFFFF) << 16) | (material & 0xFFFF);
+    }
+
+    /**
+     * Removes all nodes.
+     */
+    void clear() { _draws.clear(); }
+
+    /**
+     * Adds a node.
+     *
+     * @param node node with a model
+     * @param state draw state from makeState()
+     * @param binding entry of the DrawList bindings, kNoBinding for none
+     */
+    void push(Node *node, unsigned int state, unsigned int binding = kNoBinding)
+    {
+        Draw draw;
+        draw.key = 0;
+        draw.node = node;
+        draw.state = state;
+        draw.binding = binding;
+        _draws.push_back(draw);
+    }
+
+    /**
+     * Returns the number of nodes.
+     *
+     * @return number of queued nodes
+     */
+    size_t size() const { return _draws.size(); }
+
+    /**
+     * Returns a queued node.
+     *
+     * @param i position in the queue
+     * @return queued node
+     */
+    const Draw &operator[](size_t i) const { return _draws[i]; }
+
+    /**
+     * Sorts the queue for a camera position, reads nothing of the camera
+     * so queues of different views can be sorted on different threads.
+     *
+     * @param eye camera position in world space
+     * @param forward camera forward vector in world space
+     * @param backToFront true for transparent queues
+     */
+    void sort(const Vector3 &eye, const Vector3 &forward, bool backToFront);
+
+private:
+
+    vector<Draw> _draws;
+
+};
+
+#endif // _RENDER_QUEUE
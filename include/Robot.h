@@ -9,11 +9,30 @@
 #ifndef _ROBOT
 #define _ROBOT
 
+#include "CookedCache.h"
+#include "Mechanism.h"
+
 class Robot  : public IJsonSerializable
 {
     
+    friend class RobotFleet;
+    
 public:
     
+    /**
+     * Kinematic state of the robot, see getState().
+     */
+    struct State
+    {
+        Vector3 position;          /**< Position of robot on field (in inches)        */
+        
+        Vector3 rotation;          /**< Pitch, roll, yaw in degrees                   */
+        
+        double velocity;           /**< Current velocity in inches/sec                */
+        
+        double velocitySetpoint;   /**< Desired velocity in inches/sec                */
+    };
+    
     /**
      * Default constructor.
      */
@@ -33,6 +52,24 @@ public:
      */
     Robot(const GFileName &configFile);
     
+    /**
+     * Overloaded constructor.
+     *
+     * @param configFile Filename of JSON configuration file
+     * @param loadModel false to skip loading the robot's bundle and collision
+     *                  object (headless simulation)
+     */
+    Robot(const GFileName &configFile, bool loadModel);
+    
+    /**
+     * Overloaded constructor.
+     *
+     * @param root JsonCPP root node of an already parsed configuration
+     * @param loadModel false to skip loading the robot's bundle and collision
+     *                  object (headless simulation)
+     */
+    Robot(Json::Value &root, bool loadModel);
+    
     /**
      * Returns the pointer to the robot's top-level node.
      *
@@ -48,17 +85,55 @@ public:
     GFileName getTextureMapFile() const { return _texture_map_file; }
     
     /**
-     * Load robot configuration from JSON file.
+     * Load robot configuration from JSON file, or from its cooked copy when
+     * the JSON has not changed since it was cooked.
      *
      * @param filename relative file name to load configuration from
      */
     void LoadConfig(const GFileName &filename);
     
+    /**
+     * Returns the filename of the robot model's bundle.
+     *
+     * @return GFileName contains the robot model's bundle
+     */
+    GFileName getBundleFile() const { return _bundle_file; }
+    
+    /**
+     * Returns the robot's moving parts from the "motionList".
+     *
+     * @return robot's mechanism
+     */
+    Mechanism &getMechanism() { return _mechanism; }
+    
+    /**
+     * Loads the robot's bundle, builds its node hierarchy and collision
+     * object from the configuration read.  Called by Deserialize() unless
+     * the model is not loaded, must run on the main thread.
+     */
+    void LoadModel();
+    
+    /**
+     * Writes the configuration to a cooked payload.
+     *
+     * @param writer payload to append to
+     */
+    void Cook(CookedCache::Writer &writer) const;
+    
+    /**
+     * Reads the configuration from a cooked payload written by Cook().
+     *
+     * @param reader payload to read from
+     * @return false if the payload is truncated or has a different layout
+     */
+    bool ReadCooked(CookedCache::Reader &reader);
+    
     /**
      * Update the robot's node position and rotation in the scene.
      *
      * Moves the robot based on its current facing, velocity, acceleration
-     * and position of the wheels.
+     * and position of the wheels.  A robot without a node (headless) is
+     * moved along its yaw without physics.
      *
      * @param elapsedTime elapsed time since the last frame in seconds
      */
@@ -92,6 +167,58 @@ public:
      */
     void setYaw(float yaw);
     
+    /**
+     * Moves a headless robot, a robot with a model follows its node.
+     *
+     * @param position new position on the field (in inches)
+     */
+    void setPosition(const Vector3 &position);
+    
+    /**
+     * Sets the current and desired velocity, bypassing the acceleration
+     * limit (used to restore a recorded state).
+     *
+     * @param velocity current velocity in inches/sec
+     * @param setpoint desired velocity in inches/sec
+     */
+    void setVelocityState(double velocity, double setpoint);
+    
+    /**
+     * Copies the robot's kinematic state.
+     *
+     * @param state receives the state
+     */
+    void getState(State &state) const;
+    
+    /**
+     * Puts the robot in a state from getState().
+     *
+     * @param state kinematic state
+     */
+    void setState(const State &state);
+    
+    /**
+     * Appends the kinematic state and the mechanism's joints to a snapshot.
+     *
+     * @param snapshot receives the state
+     */
+    void capture(Snapshot &snapshot) const;
+    
+    /**
+     * Reads the state written by capture().
+     *
+     * @param snapshot snapshot positioned at the robot
+     * @return true if the state was read
+     */
+    bool restore(Snapshot &snapshot);
+    
+    /**
+     * Returns the bytes capture() appends.
+     *
+     * @return snapshot size of the robot
+     */
+    size_t getSnapshotSize() const { return sizeof(State) + _mechanism.getSnapshotSize(); }
+    
     /**
      * Get a copy of the robot's roll.
      *
@@ -120,6 +247,27 @@ public:
      */
     Vector3 getPosition() const { return _position; }
     
+    /**
+     * Gets a copy of the robot's current velocity.
+     *
+     * @return current velocity in inches/sec
+     */
+    double getVelocity() const { return _velocity; }
+    
+    /**
+     * Get a copy of the robot's desired velocity.
+     *
+     * @return desired velocity in inches/sec
+     */
+    double getVelocitySetpoint() const { return _velocity_setpoint; }
+    
+    /**
+     * Get the most the robot's velocity changes per second.
+     *
+     * @return maximum acceleration in inches/sec/sec
+     */
+    double getMaxAcceleration() const { return _max_acceleration; }
+    
     /**
      * Method to write Robot configuration to JSON file.
      *
@@ -176,6 +324,11 @@ protected:
     
     double _mass;                  /**< Mass of robot in pounds                       */
     
+    Mechanism _mechanism;          /**< Joints of the "motionList"                    */
+    
+    bool _load_model;              /**< Load bundle and collision object when the
+                                        configuration is deserialized                 */
+    
 };
 
 #endif // _ROBOT
@@ -0,0 +1,133 @@
+//
+//  RobotFleet.h
+//  FrcSim
+//
+//
+
+#ifndef _ROBOT_FLEET
+#define _ROBOT_FLEET
+
+/**
+ * Kinematic state of many robots stored as one array per field.
+ *
+ * update() runs the velocity ramp of Robot::update() over every robot in a
+ * single pass (two robots per SSE2 instruction where available) and then
+ * pushes the velocities to the robots' PhysicsCharacters, which are looked
+ * up once in add() instead of with a dynamic_cast every tick.  Robots
+ * without a node (headless) are driven along their yaw as Robot::update()
+ * does.  The fleet does not own the robots; it copies their state in add()
+ * and writes velocity and position back after every update() so the Robot
+ * getters stay current.  Only the headless position integration runs as
+ * JobSystem jobs of kRobotsPerJob robots, over the fleet's own arrays;
+ * Bullet calls, node reads, write-back and mechanisms (which move nodes)
+ * stay on the calling thread.
+ */
+class RobotFleet
+{
+
+public:
+
+    static const unsigned int kRobotsPerJob = 16;
+
+    /**
+     * Default constructor.
+     */
+    RobotFleet();
+
+    /**
+     * Adds a robot, reading its configuration and current state.
+     *
+     * @param robot robot to drive, must outlive the fleet or clear()
+     * @return index of the robot in the fleet
+     */
+    unsigned int add(Robot *robot);
+
+    /**
+     * Removes all robots.
+     */
+    void clear();
+
+    /**
+     * Sets a robot's desired velocity.
+     *
+     * @param index robot index from add()
+     * @param velocityPercent fraction of the robot's maximum velocity (-1 to 1)
+     */
+    void setVelocity(unsigned int index, float velocityPercent);
+
+    /**
+     * Sets a robot's heading.
+     *
+     * @param index robot index from add()
+     * @param yaw heading in degrees
+     */
+    void setYaw(unsigned int index, float yaw);
+
+    /**
+     * Advances every robot.
+     *
+     * @param elapsedTime seconds since the last update
+     */
+    void update(float elapsedTime);
+
+    /**
+     * Returns the number of robots.
+     *
+     * @return number of robots
+     */
+    size_t size() const { return _robots.size(); }
+
+    /**
+     * Returns a robot.
+     *
+     * @param index robot index from add()
+     * @return robot
+     */
+    Robot *getRobot(unsigned int index) const { return _robots[index]; }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    RobotFleet(const RobotFleet &fleet);
+
+    /**
+     * Hidden assignment operator.
+     */
+    RobotFleet &operator=(const RobotFleet &fleet);
+
+    /**
+     * Runs the velocity ramp over every robot.
+     */
+    void rampVelocities(double elapsedTime);
+
+    vector<Robot*> _robots;
+
+    vector<Node*> _nodes;          /**< NULL for headless robots                      */
+
+    vector<PhysicsCharacter*> _characters;   /**< NULL for headless robots        */
+
+    vector<double> _velocity;      /**< Inches/sec                                    */
+
+    vector<double> _setpoint;      /**< Desired velocity in inches/sec                */
+
+    vector<double> _max_acceleration;
+
+    vector<double> _max_velocity;
+
+    vector<float> _position_x;     /**< Inches                                        */
+
+    vector<float> _position_y;
+
+    vector<float> _position_z;
+
+    vector<float> _yaw;            /**< Degrees                                       */
+
+    vector<float> _heading_x;      /**< sin(yaw), headless driving direction          */
+
+    vector<float> _heading_z;      /**< cos(yaw)                                      */
+
+};
+
+#endif // _ROBOT_FLEET
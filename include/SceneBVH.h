@@ -0,0 +1,242 @@
+//
+//  SceneBVH.h
+//  FrcSim
+//
+//
+
+#ifndef _SCENE_BVH
+#define _SCENE_BVH
+
+/**
+ * Bounding volume hierarchy over the nodes that never move, plus a short
+ * list of nodes that do (robot, game balls).
+ *
+ * The hierarchy is built once from the static nodes' world bounding spheres,
+ * culling walks it from the root and rejects or accepts whole subtrees at a
+ * time, so the cost stays nearly flat as the field gets more detailed.  The
+ * dynamic nodes are tested one by one every frame.
+ *
+ * Several views are culled in one walk: each hierarchy node carries a mask
+ * of the views that may still see it and of those that need testing, so a
+ * subtree is entered once however many cameras look at it.
+ *
+ * Above kParallelItems static nodes the top of the hierarchy is opened into
+ * a few subtrees per thread which are walked as JobSystem jobs, each into
+ * its own list; the lists are then appended to the render queues in leaf
+ * order, so the queues are the same as from a single walk.
+ */
+class SceneBVH
+{
+
+public:
+
+    static const unsigned int kLeafSize = 4;   /**< Maximum nodes in a leaf            */
+
+    static const unsigned int kMaxViews = 32;  /**< Views culled in one walk          */
+
+    static const unsigned int kParallelItems = 2048;   /**< Static nodes above which culling runs as jobs */
+
+    /**
+     * Node to cull.
+     */
+    struct Item
+    {
+        Item() : node(NULL), transparent(false), state(0), binding(RenderQueue::kNoBinding) {}
+        Item(Node *n, const BoundingSphere &b, bool a, unsigned int s, unsigned int d = RenderQueue::kNoBinding) : node(n), bounds(b), transparent(a), state(s), binding(d) {}
+
+        Node *node;                /**< Node with a model                             */
+
+        BoundingSphere bounds;     /**< World bounds (static nodes only)              */
+
+        bool transparent;          /**< Node goes in the transparent queue            */
+
+        unsigned int state;        /**< Draw state, see RenderQueue::makeState()      */
+
+        unsigned int binding;      /**< DrawList binding, see RenderQueue::Draw       */
+    };
+
+    /**
+     * Camera to cull for and the lists receiving its visible nodes.
+     */
+    struct View
+    {
+        View() : frustum(NULL), opaque(NULL), transparent(NULL) {}
+        View(const Frustum *f, RenderQueue *o, RenderQueue *t) : frustum(f), opaque(o), transparent(t) {}
+
+        const Frustum *frustum;    /**< Camera frustum                                */
+
+        RenderQueue *opaque;       /**< Receives the visible opaque nodes             */
+
+        RenderQueue *transparent;  /**< Receives the visible transparent nodes        */
+    };
+
+    /**
+     * Default constructor.
+     */
+    SceneBVH();
+
+    /**
+     * Builds the hierarchy.
+     *
+     * @param staticItems nodes that never move, with their world bounds
+     * @param dynamicItems nodes that move, their bounds are read every frame
+     */
+    void build(const vector<Item> &staticItems, const vector<Item> &dynamicItems);
+
+    /**
+     * Removes all nodes.
+     */
+    void clear();
+
+    /**
+     * Returns true once build() has been called.
+     *
+     * @return true if the hierarchy can be used for culling
+     */
+    bool isBuilt() const { return _built; }
+
+    /**
+     * Appends the nodes inside a frustum to the opaque or transparent list.
+     *
+     * @param frustum camera frustum
+     * @param test false to skip the frustum test and return every node
+     * @param opaque receives the visible opaque nodes
+     * @param transparent receives the visible transparent nodes
+     */
+    void cull(const Frustum &frustum, bool test, RenderQueue &opaque, RenderQueue &transparent) const;
+
+    /**
+     * Culls several views in a single walk of the hierarchy.
+     *
+     * @param views cameras with their output lists (at most kMaxViews)
+     * @param count number of views
+     * @param test false to skip the frustum tests and return every node
+     */
+    void cull(const View *views, unsigned int count, bool test) const;
+
+    /**
+     * Returns the number of hierarchy nodes.
+     *
+     * @return number of hierarchy nodes (internal and leaves)
+     */
+    size_t getNodeCount() const { return _nodes.size(); }
+
+    /**
+     * Returns the number of static nodes.
+     *
+     * @return number of static nodes in the hierarchy
+     */
+    size_t getStaticCount() const { return _items.size(); }
+
+    /**
+     * Smallest sphere enclosing two spheres.
+     *
+     * @param a first sphere
+     * @param b second sphere
+     * @return sphere containing both
+     */
+    static BoundingSphere merge(const BoundingSphere &a, const BoundingSphere &b);
+
+private:
+
+    /**
+     * Hierarchy node, a leaf if count > 0.  The left child of an internal
+     * node immediately follows it, right is the index of the right child.
+     */
+    struct BVHNode
+    {
+        BoundingSphere bounds;
+
+        unsigned int first;        /**< First item (leaves)                           */
+
+        unsigned int count;        /**< Number of items (leaves)                      */
+
+        unsigned int right;        /**< Right child (internal nodes)                  */
+    };
+
+    /**
+     * Hierarchy node still to walk and the views it is still in and must
+     * still be tested against.
+     */
+    struct Subtree
+    {
+        Subtree() : node(0), visible(0), check(0) {}
+        Subtree(unsigned int n, unsigned int v, unsigned int c) : node(n), visible(v), check(c) {}
+
+        unsigned int node;
+
+        unsigned int visible;
+
+        unsigned int check;
+    };
+
+    /**
+     * Visible static item and the views seeing it.
+     */
+    struct Hit
+    {
+        unsigned int item;
+
+        unsigned int mask;
+    };
+
+    /**
+     * Result of testing a sphere against all six planes.
+     */
+    enum Containment
+    {
+        OUTSIDE = 0,
+        PARTIAL,
+        INSIDE
+    };
+
+    /**
+     * Builds the subtree for items [first, first + count).
+     *
+     * @return index of the subtree's root
+     */
+    unsigned int buildNode(unsigned int first, unsigned int count);
+
+    /**
+     * Classifies a sphere against a frustum.
+     */
+    static Containment classify(const BoundingSphere &sphere, const Frustum &frustum);
+
+    /**
+     * Tests a sphere against the views in a mask, clears the bits of the
+     * views it is outside of from visible and of those it is inside of from
+     * check.
+     */
+    static void classify(const BoundingSphere &sphere, const View *views, unsigned int &visible, unsigned int &check);
+
+    /**
+     * Walks a subtree and appends its visible items, in leaf order.
+     */
+    void walk(const Subtree &root, const View *views, vector<Hit> &hits) const;
+
+    /**
+     * Replaces the subtrees by their children, left before right, until
+     * there are at least count of them or only leaves are left.
+     */
+    void open(vector<Subtree> &subtrees, size_t count, const View *views) const;
+
+    /**
+     * Appends an item to the lists of every view in a mask.
+     */
+    static void emit(const Item &item, const View *views, unsigned int mask);
+
+    vector<Item> _items;           /**< Static items, in leaf order                   */
+
+    vector<Item> _dynamic;         /**< Dynamic items                                 */
+
+    vector<BVHNode> _nodes;
+
+    mutable vector<Subtree> _subtrees;     /**< Walked by the jobs of cull()          */
+
+    mutable vector< vector<Hit> > _hits;   /**< Visible items of each subtree         */
+
+    bool _built;
+
+};
+
+#endif // _SCENE_BVH
@@ -0,0 +1,248 @@
+//
+//  SimulationWorld.h
+//  FrcSim
+//
+//
+
+#ifndef _SIMULATION_WORLD
+#define _SIMULATION_WORLD
+
+class btBroadphaseInterface;
+class btCollisionDispatcher;
+class btDefaultCollisionConfiguration;
+class btSequentialImpulseConstraintSolver;
+class btDiscreteDynamicsWorld;
+class btCollisionShape;
+class btRigidBody;
+
+/**
+ * A self-contained field, robot and game ball that can be stepped without a
+ * window or GL context.
+ *
+ * The world owns its own Bullet dynamics world rather than using the game's
+ * PhysicsController, so any number of worlds can exist side by side and each
+ * one is advanced on a fixed timestep as fast as the CPU allows.
+ */
+class SimulationWorld
+{
+
+public:
+
+    static const float kDefaultTimestep;   /**< Fixed timestep in seconds (200 Hz)   */
+
+    /**
+     * Physical constants of the field, read from the scene and physics files
+     * used by the game.
+     */
+    struct Parameters
+    {
+        /**
+         * Default constructor (values match res/frcsim.physics).
+         */
+        Parameters();
+
+        /**
+         * Reads the gravity from the scene file and the ball and robot
+         * collision objects from the physics file.
+         *
+         * @param sceneFile scene file containing the "physics" namespace
+         * @param physicsFile physics file containing "ball" and "robot"
+         * @return true if both files were read
+         */
+        bool load(const char* sceneFile, const char* physicsFile);
+
+        Vector3 gravity;           /**< Gravity in inches/sec/sec                     */
+
+        float ballRadius;          /**< Radius of the game ball in inches             */
+
+        float ballMass;            /**< Mass of the game ball in pounds               */
+
+        float ballFriction;        /**< Game ball friction                            */
+
+        float ballRestitution;     /**< Game ball restitution                         */
+
+        float ballLinearDamping;   /**< Game ball linear damping                      */
+
+        float ballAngularDamping;  /**< Game ball angular damping                     */
+
+        Vector3 ballLaunch;        /**< Position the ball is put in play (inches)     */
+
+        Vector3 robotExtents;      /**< Size of the robot's collision box (inches)    */
+
+        Vector3 robotCenter;       /**< Offset of the collision box from the robot    */
+
+        float floorFriction;       /**< Floor friction                                */
+
+        float floorRestitution;    /**< Floor restitution                             */
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param parameters physical constants for the world
+     * @param robot headless robot to simulate, the world takes ownership
+     */
+    SimulationWorld(const Parameters &parameters, Robot *robot);
+
+    /**
+     * Destructor.
+     */
+    ~SimulationWorld();
+
+    /**
+     * Sets the driver inputs used by the following steps.
+     *
+     * @param input current driver inputs
+     */
+    void setInput(const MatchInput &input);
+
+    /**
+     * Advances the robot and physics by a single fixed step.
+     *
+     * @param timestep step length in seconds
+     */
+    void step(float timestep);
+
+    /**
+     * Steps the world until the simulated time reaches the given duration.
+     *
+     * @param duration simulated time to run to in seconds
+     * @param timestep step length in seconds
+     */
+    void run(double duration, float timestep);
+
+    /**
+     * Returns the pointer to the simulated robot.
+     *
+     * @return pointer to the robot owned by this world
+     */
+    Robot *getRobot() const { return _robot; }
+
+    /**
+     * Returns the simulated time.
+     *
+     * @return simulated time in seconds since the world was created
+     */
+    double getSimulatedTime() const { return _simulated_time; }
+
+    /**
+     * Returns the number of steps taken.
+     *
+     * @return number of steps since the world was created
+     */
+    unsigned long getTickCount() const { return _tick_count; }
+
+    /**
+     * Returns true once the game ball has been put in play.
+     *
+     * @return true if the ball is in play
+     */
+    bool isBallInPlay() const { return _ball_in_play; }
+
+    /**
+     * Returns the game ball's position.
+     *
+     * @return position of the ball on the field (in inches)
+     */
+    Vector3 getBallPosition() const;
+    
+    /**
+     * Fills in the robot and ball state after the last step, plus the tick
+     * count and simulated time.
+     *
+     * @param frame receives the state, inputs are left alone
+     */
+    void getFrame(MatchFrame &frame) const;
+    
+    /**
+     * Puts the robot and ball in a recorded state and sets the tick count
+     * and simulated time, used to seek to a keyframe.  Bullet's contact
+     * cache is not part of the state, so contacts settle again.
+     *
+     * @param frame recorded state
+     */
+    void applyFrame(const MatchFrame &frame);
+    
+    /**
+     * Returns the bytes capture() writes, reserve a Snapshot with it once.
+     *
+     * @return snapshot size of this world
+     */
+    size_t getSnapshotSize() const;
+    
+    /**
+     * Copies the whole simulation state: clock, inputs, robot and mechanism,
+     * ball-in-play flag and the Bullet state of the robot and ball bodies.
+     *
+     * @param snapshot receives the state, cleared first
+     */
+    void capture(Snapshot &snapshot) const;
+    
+    /**
+     * Puts the world back in a captured state.  Cached contacts of the ball
+     * are dropped, so every restore of the same snapshot steps identically.
+     *
+     * @param snapshot state from capture() of this world
+     * @return true if the snapshot was read
+     */
+    bool restore(Snapshot &snapshot);
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    SimulationWorld(const SimulationWorld &world);
+
+    /**
+     * Hidden assignment operator.
+     */
+    SimulationWorld &operator=(const SimulationWorld &world);
+
+    /**
+     * Moves the robot's kinematic collision box to the robot's position.
+     */
+    void syncRobotBody();
+
+    /**
+     * Puts the game ball on the field.
+     */
+    void launchBall();
+
+    Parameters _parameters;
+
+    Robot *_robot;
+
+    MatchInput _input;
+
+    double _simulated_time;
+
+    unsigned long _tick_count;
+
+    bool _ball_in_play;
+
+    btDefaultCollisionConfiguration *_collision_configuration;
+
+    btCollisionDispatcher *_dispatcher;
+
+    btBroadphaseInterface *_broadphase;
+
+    btSequentialImpulseConstraintSolver *_solver;
+
+    btDiscreteDynamicsWorld *_world;
+
+    btCollisionShape *_floor_shape;
+
+    btCollisionShape *_robot_shape;
+
+    btCollisionShape *_ball_shape;
+
+    btRigidBody *_floor_body;
+
+    btRigidBody *_robot_body;
+
+    btRigidBody *_ball_body;
+
+};
+
+#endif // _SIMULATION_WORLD
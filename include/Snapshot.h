@@ -0,0 +1,114 @@
+//
+//  Snapshot.h
+//  FrcSim
+//
+//
+
+#ifndef _SNAPSHOT
+#define _SNAPSHOT
+
+#include <cstring>
+
+/**
+ * Flat byte buffer holding a copy of simulation state.
+ *
+ * Values are plain-old-data copied with memcpy in the order they are put
+ * and read back in the same order, there is no tagging or versioning: a
+ * snapshot is only valid for the object (and build) that captured it.
+ * reserve() once with the size the owner reports and capture/restore do
+ * not allocate, which keeps forking thousands of branches cheap.
+ */
+class Snapshot
+{
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    Snapshot() : _size(0), _read(0) {}
+
+    /**
+     * Preallocates the buffer.
+     *
+     * @param capacity bytes
+     */
+    void reserve(size_t capacity)
+    {
+        if (capacity > _data.size())
+        {
+            _data.resize(capacity);
+        }
+    }
+
+    /**
+     * Empties the snapshot before a capture, keeping the buffer.
+     */
+    void clear()
+    {
+        _size = 0;
+        _read = 0;
+    }
+
+    /**
+     * Moves back to the first value before a restore.
+     */
+    void rewind() { _read = 0; }
+
+    /**
+     * Appends a value, the buffer grows if reserve() was too small.
+     *
+     * @param value plain-old-data value
+     */
+    template <class T> void put(const T &value)
+    {
+        if (_size + sizeof(T) > _data.size())
+        {
+            _data.resize((_size + sizeof(T)) * 2);
+        }
+        memcpy(&_data[_size], &value, sizeof(T));
+        _size += sizeof(T);
+    }
+
+    /**
+     * Reads the next value.
+     *
+     * @param value receives the value
+     * @return false if the snapshot has no more values
+     */
+    template <class T> bool get(T &value)
+    {
+        if (_read + sizeof(T) > _size)
+        {
+            return false;
+        }
+        memcpy(&value, &_data[_read], sizeof(T));
+        _read += sizeof(T);
+        return true;
+    }
+
+    /**
+     * Returns the number of bytes captured.
+     *
+     * @return bytes in use
+     */
+    size_t size() const { return _size; }
+
+    /**
+     * Returns true once every captured value was read.
+     *
+     * @return true at the end
+     */
+    bool isAtEnd() const { return _read == _size; }
+
+private:
+
+    vector<uint8_t> _data;
+
+    size_t _size;
+
+    size_t _read;
+
+};
+
+#endif // _SNAPSHOT
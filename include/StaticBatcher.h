@@ -0,0 +1,95 @@
+//
+//  StaticBatcher.h
+//  FrcSim
+//
+//
+
+#ifndef _STATIC_BATCHER
+#define _STATIC_BATCHER
+
+/**
+ * Merges nodes that never move and share a material into a few large
+ * meshes, so the field is drawn in a handful of draw calls.
+ *
+ * Nodes are grouped by material cache entry and vertex format, sorted along
+ * the longest axis of the group so each batch stays compact (and culls
+ * well), and packed into batches of at most 65535 vertices with 16 bit
+ * indices.  Positions and normals are transformed into world space, the
+ * batch nodes have an identity transform and their own bounds.  The original
+ * nodes keep their transform and collision objects but lose their model.
+ *
+ * GamePlay does not keep a CPU copy of mesh data, so the vertex and index
+ * buffers are read back from GL.  OpenGL ES has no buffer readback, there
+ * build() leaves the scene untouched.
+ */
+class StaticBatcher
+{
+
+public:
+
+    static const unsigned int kMaxVertices = 65535;    /**< Vertices per batch (16 bit indices) */
+
+    /**
+     * Default constructor.
+     */
+    StaticBatcher();
+
+    /**
+     * Adds a node to merge.
+     *
+     * @param node static opaque node with a model
+     * @param material material cache entry of the node
+     */
+    void add(Node *node, unsigned int material);
+
+    /**
+     * Merges the nodes added, adds the batch nodes to a scene and removes
+     * the models of the merged nodes.  Groups of a single node are left
+     * alone.  Each batch node needs a material before it is drawn.
+     *
+     * @param scene scene receiving the batch nodes
+     * @param batches receives the batch nodes
+     * @param materials receives the material cache entry of each batch
+     * @return number of nodes merged
+     */
+    unsigned int build(Scene *scene, vector<Node*> &batches, vector<unsigned int> &materials);
+
+    /**
+     * Removes the nodes added.
+     */
+    void clear() { _candidates.clear(); }
+
+    /**
+     * Reads back the vertices and triangle indices of a mesh.
+     *
+     * @param mesh mesh with triangle parts
+     * @param vertices receives the vertex data
+     * @param indices receives the triangle list
+     * @return false on OpenGL ES or if the mesh has no triangles to read
+     */
+    static bool readMesh(Mesh *mesh, vector<float> &vertices, vector<unsigned int> &indices);
+
+private:
+
+    /**
+     * Node to merge.
+     */
+    struct Candidate
+    {
+        Node *node;
+
+        unsigned int material;     /**< Material cache entry                          */
+
+        float center;              /**< Bounds center along the group's sort axis     */
+    };
+
+    /**
+     * Creates a batch node from merged world space data.
+     */
+    static Node *createBatch(const VertexFormat &format, const vector<float> &vertices, const vector<unsigned short> &indices, unsigned int number);
+
+    vector<Candidate> _candidates;
+
+};
+
+#endif // _STATIC_BATCHER
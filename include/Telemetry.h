@@ -0,0 +1,222 @@
+//
+//  Telemetry.h
+//  FrcSim
+//
+//
+
+#ifndef _TELEMETRY
+#define _TELEMETRY
+
+#include <stdint.h>
+
+#include <atomic>
+
+struct MatchFrame;
+
+/**
+ * Robot and ball state published once per tick.  Fixed width fields only,
+ * the layout is shared with readers in other processes.
+ */
+struct TelemetrySample
+{
+    /**
+     * Copies the robot and ball state of a tick.
+     *
+     * @param frame state after the tick
+     */
+    void set(const MatchFrame &frame);
+
+    uint64_t tick;
+
+    double time;                   /**< Simulated seconds                             */
+
+    double robotVelocity;          /**< Inches/sec                                    */
+
+    double robotSetpoint;          /**< Inches/sec                                    */
+
+    float robotPosition[3];        /**< Inches                                        */
+
+    float robotYaw;                /**< Degrees                                       */
+
+    float ballPosition[3];         /**< Inches                                        */
+
+    float ballVelocity[3];         /**< Inches/sec                                    */
+
+    uint32_t ballInPlay;
+
+    uint32_t reserved;
+};
+
+/**
+ * Shared memory channel of TelemetrySamples.
+ *
+ * The simulator is the only writer.  The segment is a header followed by a
+ * power of two ring of slots; every slot carries a sequence number that is
+ * odd while the slot is written and 2 * (index + 1) once sample `index` is
+ * complete (a seqlock), so any number of readers copy samples without a
+ * syscall or lock and detect a sample overwritten under them.  The writer
+ * never waits for readers, a reader that falls more than a ring behind
+ * skips ahead.  POSIX shared memory is not available on Android, where
+ * open() fails and publish() does nothing.
+ */
+class Telemetry
+{
+
+public:
+
+    static const uint32_t kMagic = 0x54435246;     /**< 'FRCT' little endian         */
+
+    static const uint32_t kVersion = 1;
+
+    static const uint32_t kDefaultCapacity = 4096; /**< Samples, 20 sec at 200 Hz    */
+
+    static const char *kDefaultName;               /**< Shared memory object name    */
+
+    /**
+     * Start of the segment.
+     */
+    struct Header
+    {
+        uint32_t magic;
+
+        uint32_t version;
+
+        uint32_t capacity;         /**< Slots, a power of 2                           */
+
+        uint32_t sampleSize;       /**< sizeof(TelemetrySample)                       */
+
+        std::atomic<uint64_t> head;    /**< Samples published                         */
+    };
+
+    /**
+     * Ring entry.
+     */
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+
+        TelemetrySample sample;
+    };
+
+    /**
+     * Default constructor.
+     */
+    Telemetry();
+
+    /**
+     * Destructor, unmaps the segment and removes it if this is the writer.
+     */
+    ~Telemetry();
+
+    /**
+     * Creates the segment as the writer, replacing a stale one.
+     *
+     * @param name shared memory object name, starting with '/'
+     * @param capacity ring size, rounded up to a power of 2
+     * @return true if the segment was created
+     */
+    bool create(const char *name = kDefaultName, uint32_t capacity = kDefaultCapacity);
+
+    /**
+     * Maps an existing segment read only, as a reader.
+     *
+     * @param name shared memory object name
+     * @return true if the segment was mapped and has a known layout
+     */
+    bool open(const char *name = kDefaultName);
+
+    /**
+     * Unmaps the segment.
+     */
+    void close();
+
+    /**
+     * Returns true while a segment is mapped.
+     *
+     * @return true if mapped
+     */
+    bool isOpen() const { return _header != NULL; }
+
+    /**
+     * Writes the next sample, writer only.
+     *
+     * @param sample state of the tick
+     */
+    void publish(const TelemetrySample &sample)
+    {
+        if (!_header)
+        {
+            return;
+        }
+        uint64_t index = _header->head.load(std::memory_order_relaxed);
+        Slot &slot = _slots[index & (_header->capacity - 1)];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.sample = sample;
+        slot.sequence.store(2 * (index + 1), std::memory_order_release);
+        _header->head.store(index + 1, std::memory_order_release);
+    }
+
+    /**
+     * Returns the number of samples published so far.
+     *
+     * @return index of the next sample
+     */
+    uint64_t getHead() const { return _header ? _header->head.load(std::memory_order_acquire) : 0; }
+
+    /**
+     * Copies a sample, reader side.
+     *
+     * @param index sample index, below getHead()
+     * @param sample receives the sample
+     * @return false if the sample was overwritten (or not yet written)
+     */
+    bool read(uint64_t index, TelemetrySample &sample) const
+    {
+        if (!_header)
+        {
+            return false;
+        }
+        const Slot &slot = _slots[index & (_header->capacity - 1)];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        sample = slot.sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+        return before == after && before == 2 * (index + 1);
+    }
+
+    /**
+     * Returns the ring size.
+     *
+     * @return number of slots
+     */
+    uint32_t getCapacity() const { return _header ? _header->capacity : 0; }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    Telemetry(const Telemetry &telemetry);
+
+    /**
+     * Hidden assignment operator.
+     */
+    Telemetry &operator=(const Telemetry &telemetry);
+
+    /**
+     * Returns the segment size for a capacity.
+     */
+    static size_t getSegmentSize(uint32_t capacity);
+
+    Header *_header;
+
+    Slot *_slots;
+
+    size_t _size;                  /**< Mapped bytes                                  */
+
+    string _name;                  /**< Set when this process created the segment     */
+
+};
+
+#endif // _TELEMETRY
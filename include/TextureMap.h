@@ -0,0 +1,152 @@
+//
+//  TextureMap.h
+//  FrcSim
+//
+//
+
+#ifndef _TEXTURE_MAP
+#define _TEXTURE_MAP
+
+/**
+ * Node ID to texture rules read from the texture map JSON files.
+ *
+ * Rules are kept in the same order as before (sorted by pattern, the first
+ * file to name a pattern wins) and the first rule whose regular expression
+ * matches a node ID is used.  compile() reduces every pattern to a literal
+ * that any match must contain and builds one Aho-Corasick automaton over
+ * those literals, so match() scans the node ID once and only runs the
+ * regular expressions of the rules whose literal was found.  Patterns with
+ * no usable literal are always tried.
+ */
+class TextureMap
+{
+
+public:
+
+    /**
+     * Texture assigned by a rule.
+     */
+    struct Entry
+    {
+        Entry() : transparent(false) {}
+        Entry(const string &t, bool a) : texture(t), transparent(a) {}
+
+        string texture;            /**< Path of the diffuse texture                   */
+
+        bool transparent;          /**< Node is drawn in the transparent queue        */
+    };
+
+    /**
+     * Default constructor.
+     */
+    TextureMap();
+
+    /**
+     * Reads the "textureMapList" array of a texture map JSON file and adds
+     * its rules.
+     *
+     * @param filename full path of the JSON file
+     * @return true if the file was read
+     */
+    bool load(const string &filename);
+
+    /**
+     * Adds a rule, ignored if the pattern already has a rule.
+     *
+     * @param pattern regular expression matched against node IDs
+     * @param texture path of the diffuse texture
+     * @param transparent true to draw matching nodes in the transparent queue
+     */
+    void add(const string &pattern, const string &texture, bool transparent);
+
+    /**
+     * Removes all rules.
+     */
+    void clear();
+
+    /**
+     * Exchanges the rules of two maps, compiled rules stay valid.
+     *
+     * @param other map to exchange with
+     */
+    void swap(TextureMap &other);
+
+    /**
+     * Builds the literal automaton, done by match() if rules were added
+     * since the last compile.
+     */
+    void compile();
+
+    /**
+     * Finds the first rule matching a node ID.
+     *
+     * @param id node ID
+     * @return matching rule, NULL if none matches
+     */
+    const Entry *match(const char *id);
+
+    /**
+     * Finds the first rule matching a node ID, compile() must have been
+     * called since the last rule was added.
+     *
+     * @param id node ID
+     * @return matching rule, NULL if none matches
+     */
+    const Entry *match(const char *id) const;
+
+    /**
+     * Appends the textures named by the rules, each texture once.
+     *
+     * @param textures receives the texture paths
+     */
+    void getTextures(vector<string> &textures) const;
+
+    /**
+     * Returns the number of rules.
+     *
+     * @return number of rules
+     */
+    size_t getRuleCount() const { return _entries.size(); }
+
+private:
+
+    /**
+     * Compiled rule, in first-match order.
+     */
+    struct Rule
+    {
+        GString pattern;           /**< Regular expression, built once               */
+
+        string literal;            /**< Lower case text every match contains, empty
+                                        if the rule must always be tried             */
+
+        const Entry *entry;        /**< Texture for nodes matching the rule           */
+    };
+
+    /**
+     * Returns the longest run of characters a pattern requires in any match.
+     *
+     * @param pattern regular expression
+     * @return lower case literal, empty if none could be found
+     */
+    static string requiredLiteral(const string &pattern);
+
+    map<string, Entry> _entries;   /**< Rules keyed (and ordered) by pattern         */
+
+    vector<Rule> _rules;
+
+    vector<unsigned int> _always;  /**< Rules without a literal                      */
+
+    unsigned char _classes[256];   /**< Byte to automaton input class                */
+
+    unsigned int _class_count;
+
+    vector<int> _delta;            /**< State transitions, _class_count per state    */
+
+    vector< vector<unsigned int> > _outputs;   /**< Rules whose literal ends in a state */
+
+    bool _compiled;
+
+};
+
+#endif // _TEXTURE_MAP
@@ -0,0 +1,98 @@
+//
+//  ThreadPool.h
+//  FrcSim
+//
+//
+
+#ifndef _THREAD_POOL
+#define _THREAD_POOL
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+/**
+ * Fixed set of worker threads pulling tasks from a shared queue.
+ */
+class ThreadPool
+{
+
+public:
+
+    typedef std::function<void()> Task;
+
+    /**
+     * Constructor.
+     *
+     * @param threadCount number of worker threads, 0 for one per core
+     */
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    /**
+     * Destructor, waits for queued tasks to finish.
+     */
+    ~ThreadPool();
+
+    /**
+     * Queues a task to run on the next free worker.
+     *
+     * @param task function to run
+     */
+    void enqueue(const Task &task);
+
+    /**
+     * Blocks until every queued task has finished.
+     */
+    void wait();
+
+    /**
+     * Returns true if no task is queued or running, without blocking.
+     *
+     * @return true if every queued task has finished
+     */
+    bool isIdle() const;
+
+    /**
+     * Returns the number of worker threads.
+     *
+     * @return number of worker threads
+     */
+    unsigned int getThreadCount() const { return (unsigned int)_workers.size(); }
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    ThreadPool(const ThreadPool &pool);
+
+    /**
+     * Hidden assignment operator.
+     */
+    ThreadPool &operator=(const ThreadPool &pool);
+
+    /**
+     * Worker thread body.
+     */
+    void workerLoop();
+
+    std::vector<std::thread> _workers;
+
+    std::deque<Task> _tasks;
+
+    mutable std::mutex _mutex;
+
+    std::condition_variable _task_ready;
+
+    std::condition_variable _tasks_done;
+
+    unsigned int _busy;
+
+    bool _stopping;
+
+};
+
+#endif // _THREAD_POOL
@@ -0,0 +1,162 @@
+//
+//  AssetLoader.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+
+#include <map>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "Profiler.h"
+#include "MaterialCache.h"
+#include "AssetLoader.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+//----------------------------------------------------------------------
+//
+// AssetLoader()
+//
+//----------------------------------------------------------------------
+AssetLoader::AssetLoader() :
+    _queued(0),
+    _completed(0)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// ~AssetLoader()
+//
+//----------------------------------------------------------------------
+AssetLoader::~AssetLoader()
+{
+    JobSystem::getInstance().wait(_jobs);
+    map<string, Image*>::iterator it;
+    for (it = _images.begin(); it != _images.end(); it++)
+    {
+        SAFE_RELEASE(it->second);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// run()
+//
+//----------------------------------------------------------------------
+void AssetLoader::run(const JobSystem::Task &task)
+{
+    _queued++;
+    JobSystem::getInstance().run([this, task]()
+    {
+        PROFILE_ZONE("AssetLoader::run");
+        task();
+        _completed++;
+    }, &_jobs);
+}
+
+//----------------------------------------------------------------------
+//
+// prefetch()
+//
+//----------------------------------------------------------------------
+void AssetLoader::prefetch(const string &path)
+{
+    run([path]()
+    {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file)
+        {
+            char buffer[64 * 1024];
+            while (fread(buffer, 1, sizeof(buffer), file) == sizeof(buffer))
+            {
+            }
+            fclose(file);
+        }
+    });
+}
+
+//----------------------------------------------------------------------
+//
+// decodeImage()
+//
+//----------------------------------------------------------------------
+void AssetLoader::decodeImage(const string &path)
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        if (!_images.insert(make_pair(path, (Image*)NULL)).second)
+        {
+            return;
+        }
+    }
+    // One more unit for the upload on the main thread
+    _queued++;
+    run([this, path]()
+    {
+        PROFILE_ZONE("Image::create");
+        Image *image = Image::create(path.c_str());
+#if DEBUG
+        if (!image)
+        {
+            fprintf(stderr, "[ERROR] Image \"%s\" not decoded\n", path.c_str());
+        }
+#endif // DEBUG
+        lock_guard<mutex> lock(_mutex);
+        _images[path] = image;
+    });
+}
+
+//----------------------------------------------------------------------
+//
+// uploadTextures()
+//
+//----------------------------------------------------------------------
+bool AssetLoader::uploadTextures(MaterialCache &cache, unsigned int maxCount)
+{
+    PROFILE_ZONE("AssetLoader::uploadTextures");
+    lock_guard<mutex> lock(_mutex);
+    unsigned int count = 0;
+    map<string, Image*>::iterator it = _images.begin();
+    while (it != _images.end() && count < maxCount)
+    {
+        if (it->second)
+        {
+            Texture *texture = Texture::create(it->second, true);
+            if (texture)
+            {
+                cache.addTexture(it->first, texture);
+                SAFE_RELEASE(texture);
+            }
+            SAFE_RELEASE(it->second);
+        }
+        _images.erase(it++);
+        _completed++;
+        count++;
+    }
+    return _images.empty();
+}
+
+//----------------------------------------------------------------------
+//
+// getProgress()
+//
+//----------------------------------------------------------------------
+float AssetLoader::getProgress() const
+{
+    unsigned int queued = _queued;
+    unsigned int completed = _completed;
+    return queued ? (float)completed / (float)queued : 1.0f;
+}
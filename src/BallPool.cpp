@@ -0,0 +1,245 @@
+//
+//  BallPool.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "BallPool.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+const float BallPool::kDespawnHeight = -200.0f;
+
+/**
+ * Where balls out of play wait, below the floor and out of every view.
+ */
+static const float kParkDepth = -100000.0f;
+
+//----------------------------------------------------------------------
+//
+// BallPool()
+//
+//----------------------------------------------------------------------
+BallPool::BallPool() :
+    _scene(NULL),
+    _active(0)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// ~BallPool()
+//
+//----------------------------------------------------------------------
+BallPool::~BallPool()
+{
+    clear();
+}
+
+//----------------------------------------------------------------------
+//
+// create()
+//
+//----------------------------------------------------------------------
+unsigned int BallPool::create(Scene *scene, Node *prototype, const char *physicsUrl, unsigned int size)
+{
+    clear();
+    if (!scene || !prototype || size == 0)
+    {
+        return 0;
+    }
+    _scene = scene;
+
+    // One parse for every ball
+    Properties* properties = Properties::create(physicsUrl);
+#if DEBUG
+    if (!properties)
+    {
+        fprintf(stderr, "[ERROR] Ball collision object \"%s\" not read\n", physicsUrl);
+    }
+#endif // DEBUG
+    unsigned int bodies = 0;
+    _balls.reserve(size);
+    _free.reserve(size);
+    for (unsigned int i = 0; i < size; i++)
+    {
+        Ball ball;
+        if (i == 0)
+        {
+            ball.node = prototype;
+            prototype->addRef();
+        }
+        else
+        {
+            char id[64];
+            snprintf(id, sizeof(id), "%s_%u", prototype->getId(), i);
+            ball.node = prototype->clone();
+            ball.node->setId(id);
+            scene->addNode(ball.node);
+        }
+        ball.node->setTranslation(0.0f, kParkDepth, 0.0f);
+        ball.body = NULL;
+        if (properties)
+        {
+            properties->rewind();
+            ball.body = dynamic_cast<PhysicsRigidBody*>(ball.node->setCollisionObject(properties));
+        }
+        if (ball.body)
+        {
+            ball.body->setEnabled(false);
+            bodies++;
+        }
+        ball.active = false;
+        _balls.push_back(ball);
+    }
+    SAFE_DELETE(properties);
+
+    // Spawn hands out the lowest free index first
+    for (unsigned int i = size; i > 0; i--)
+    {
+        _free.push_back(i - 1);
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Ball pool of %u balls, %u with rigid bodies\n", size, bodies);
+#endif // DEBUG
+    return bodies;
+}
+
+//----------------------------------------------------------------------
+//
+// clear()
+//
+//----------------------------------------------------------------------
+void BallPool::clear()
+{
+    for (size_t i = 0; i < _balls.size(); i++)
+    {
+        if (i > 0 && _scene)
+        {
+            _scene->removeNode(_balls[i].node);
+        }
+        SAFE_RELEASE(_balls[i].node);
+    }
+    _balls.clear();
+    _free.clear();
+    _active = 0;
+    _scene = NULL;
+}
+
+//----------------------------------------------------------------------
+//
+// spawn()
+//
+//----------------------------------------------------------------------
+int BallPool::spawn(const Vector3 &position, const Vector3 &velocity)
+{
+    if (_free.empty())
+    {
+        return -1;
+    }
+    unsigned int index = _free.back();
+    _free.pop_back();
+    Ball &ball = _balls[index];
+    ball.node->setTranslation(position);
+    if (ball.body)
+    {
+        // Enabling reads the node's transform into the body
+        ball.body->setEnabled(true);
+        ball.body->setLinearVelocity(velocity);
+        ball.body->setAngularVelocity(Vector3::zero());
+    }
+    ball.active = true;
+    _active++;
+    return (int)index;
+}
+
+//----------------------------------------------------------------------
+//
+// despawn()
+//
+//----------------------------------------------------------------------
+void BallPool::despawn(unsigned int index)
+{
+    Ball &ball = _balls[index];
+    if (!ball.active)
+    {
+        return;
+    }
+    if (ball.body)
+    {
+        ball.body->setEnabled(false);
+    }
+    ball.node->setTranslation(0.0f, kParkDepth, 0.0f);
+    ball.active = false;
+    _active--;
+
+    // Keep the free list ordered so the lowest index is reused first
+    vector<unsigned int>::iterator it = _free.begin();
+    while (it != _free.end() && *it > index)
+    {
+        ++it;
+    }
+    _free.insert(it, index);
+}
+
+//----------------------------------------------------------------------
+//
+// despawnAll()
+//
+//----------------------------------------------------------------------
+void BallPool::despawnAll()
+{
+    for (unsigned int i = 0; i < _balls.size(); i++)
+    {
+        despawn(i);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// update()
+//
+//----------------------------------------------------------------------
+unsigned int BallPool::update()
+{
+    for (unsigned int i = 0; i < _balls.size() && _active > 0; i++)
+    {
+        if (_balls[i].active && _balls[i].node->getTranslationY() < kDespawnHeight)
+        {
+            despawn(i);
+        }
+    }
+    return _active;
+}
+
+//----------------------------------------------------------------------
+//
+// getFirstActive()
+//
+//----------------------------------------------------------------------
+int BallPool::getFirstActive() const
+{
+    for (unsigned int i = 0; i < _balls.size(); i++)
+    {
+        if (_balls[i].active)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
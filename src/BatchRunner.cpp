@@ -0,0 +1,313 @@
+//
+//  BatchRunner.cpp
+//  FrcSim
+//
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Robot.h"
+#include "MatchInput.h"
+#include "FrcSim.h"
+#include "SimulationWorld.h"
+#include "ThreadPool.h"
+#include "BatchRunner.h"
+
+/**
+ * Configuration keys the headless world reads; any other key, such as
+ * "mass" of the kinematic robot body, would repeat the same match.
+ */
+static const char* kSweepableKeys[] =
+{
+    "maxAcceleration",
+    "maxVelocity",
+    "velocity",
+    "positionX",
+    "positionY",
+    "positionZ"
+};
+
+//----------------------------------------------------------------------
+//
+// isSweepable()
+//
+//----------------------------------------------------------------------
+static bool isSweepable(const string &key)
+{
+    for (size_t i = 0; i < sizeof(kSweepableKeys) / sizeof(kSweepableKeys[0]); i++)
+    {
+        if (key == kSweepableKeys[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+//
+// readJsonFile()
+//
+//----------------------------------------------------------------------
+static bool readJsonFile(const string &filename, Json::Value &root)
+{
+    std::string jsonInput;
+    std::ifstream inFile;
+    inFile.open(filename.c_str(), std::ios_base::in);
+    if (!inFile)
+    {
+        fprintf(stderr, "[ERROR] File \"%s\" not opened\n", filename.c_str());
+        return false;
+    }
+    inFile.seekg(0, std::ios::end);
+    long length = (long)inFile.tellg();
+    jsonInput.resize(length);
+    inFile.seekg(0, std::ios::beg);
+    inFile.read(&jsonInput[0], jsonInput.size());
+    inFile.close();
+
+    Json::Reader reader;
+    if (!reader.parse(jsonInput, root))
+    {
+        fprintf(stderr, "[ERROR] File \"%s\" not parsed\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// BatchRunner()
+//
+//----------------------------------------------------------------------
+BatchRunner::BatchRunner(const SimulationWorld::Parameters &parameters) :
+    _parameters(parameters),
+    _duration(150.0),
+    _timestep(SimulationWorld::kDefaultTimestep),
+    _throttle(0.0f),
+    _yaw(0.0f),
+    _launch(-1.0)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// loadSweep()
+//
+//----------------------------------------------------------------------
+bool BatchRunner::loadSweep(const string &filename)
+{
+    Json::Value root;
+    if (!readJsonFile(filename, root))
+    {
+        return false;
+    }
+    string config = root.get("config", "/res/data/AerialAssist2028.json").asString();
+    _duration = root.get("duration", 150.0).asDouble();
+    _timestep = (float)root.get("timestep", SimulationWorld::kDefaultTimestep).asDouble();
+    _throttle = (float)root.get("throttle", 0.0).asDouble();
+    _yaw = (float)root.get("yaw", 0.0).asDouble();
+    _launch = root.get("launch", -1.0).asDouble();
+    if (!readJsonFile(string(FileSystem::getResourcePath()) + config, _config))
+    {
+        return false;
+    }
+
+    // Expand each swept key into its list of values
+    _keys.clear();
+    vector<RunValues> values;
+    Json::Value sweep = root["sweep"];
+    Json::Value::Members members = sweep.getMemberNames();
+    for (size_t i = 0; i < members.size(); i++)
+    {
+        if (!isSweepable(members[i]))
+        {
+            fprintf(stderr, "[ERROR] Sweep key \"%s\" does not change a headless match\n", members[i].c_str());
+            return false;
+        }
+        Json::Value entry = sweep[members[i]];
+        RunValues list;
+        if (entry.isArray())
+        {
+            for (unsigned int j = 0; j < entry.size(); j++)
+            {
+                list.push_back(entry[j].asDouble());
+            }
+        }
+        else if (entry.isObject())
+        {
+            double min_value = entry.get("min", 0.0).asDouble();
+            double max_value = entry.get("max", min_value).asDouble();
+            int steps = entry.get("steps", 1).asInt();
+            for (int j = 0; j < steps; j++)
+            {
+                list.push_back((steps > 1) ? min_value + ((max_value - min_value) * j / (steps - 1)) : min_value);
+            }
+        }
+        else if (entry.isNumeric())
+        {
+            list.push_back(entry.asDouble());
+        }
+        if (list.empty())
+        {
+            fprintf(stderr, "[ERROR] Sweep key \"%s\" has no values\n", members[i].c_str());
+            return false;
+        }
+        _keys.push_back(members[i]);
+        values.push_back(list);
+    }
+
+    // Every combination of the swept values is one run
+    _runs.clear();
+    _runs.push_back(RunValues());
+    for (size_t k = 0; k < values.size(); k++)
+    {
+        vector<RunValues> expanded;
+        expanded.reserve(_runs.size() * values[k].size());
+        for (size_t r = 0; r < _runs.size(); r++)
+        {
+            for (size_t v = 0; v < values[k].size(); v++)
+            {
+                RunValues run = _runs[r];
+                run.push_back(values[k][v]);
+                expanded.push_back(run);
+            }
+        }
+        _runs.swap(expanded);
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Sweep \"%s\" expanded to %lu runs over %lu keys\n", filename.c_str(), (unsigned long)_runs.size(), (unsigned long)_keys.size());
+#endif // DEBUG
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// run()
+//
+//----------------------------------------------------------------------
+bool BatchRunner::run(unsigned int threadCount, const string &resultsFile)
+{
+    vector<Result> results;
+    run(threadCount, results);
+    return writeResults(resultsFile, results);
+}
+
+//----------------------------------------------------------------------
+//
+// run()
+//
+//----------------------------------------------------------------------
+void BatchRunner::run(unsigned int threadCount, vector<Result> &results)
+{
+    results.assign(_runs.size(), Result());
+    ThreadPool pool(threadCount);
+    for (size_t i = 0; i < _runs.size(); i++)
+    {
+        const RunValues *values = &_runs[i];
+        Result *result = &results[i];
+        pool.enqueue([this, values, result]() { runMatch(*values, *result); });
+    }
+    pool.wait();
+}
+
+//----------------------------------------------------------------------
+//
+// runMatch()
+//
+//----------------------------------------------------------------------
+void BatchRunner::runMatch(const RunValues &values, Result &result) const
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // Each run gets its own copy of the configuration, robot and world
+    Json::Value config = _config;
+    for (size_t k = 0; k < _keys.size(); k++)
+    {
+        config[_keys[k]] = values[k];
+    }
+    Robot *robot = new Robot(config, false);
+    robot->setYaw(_yaw);
+    SimulationWorld world(_parameters, robot);
+
+    MatchInput input;
+    if (_throttle >= 0.0f)
+    {
+        input.rightTrigger = _throttle;
+    }
+    else
+    {
+        input.leftTrigger = -1.0f * _throttle;
+    }
+    while (world.getSimulatedTime() + (_timestep * 0.5) < _duration)
+    {
+        input.launchBall = (_launch >= 0.0 && world.getSimulatedTime() >= _launch);
+        world.setInput(input);
+        world.step(_timestep);
+    }
+
+    result.ticks = world.getTickCount();
+    result.simulatedTime = world.getSimulatedTime();
+    result.position = robot->getPosition();
+    result.velocity = robot->getVelocity();
+    result.ballInPlay = world.isBallInPlay();
+    result.ball = world.getBallPosition();
+    result.wallTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------
+//
+// writeResults()
+//
+//----------------------------------------------------------------------
+bool BatchRunner::writeResults(const string &resultsFile, const vector<Result> &results) const
+{
+    FILE *file = fopen(resultsFile.c_str(), "w");
+    if (!file)
+    {
+        fprintf(stderr, "[ERROR] File \"%s\" not opened\n", resultsFile.c_str());
+        return false;
+    }
+    fprintf(file, "run");
+    for (size_t k = 0; k < _keys.size(); k++)
+    {
+        fprintf(file, ",%s", _keys[k].c_str());
+    }
+    fprintf(file, ",ticks,simulated,positionX,positionY,positionZ,velocity,ballInPlay,ballX,ballY,ballZ,wall\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        fprintf(file, "%lu", (unsigned long)i);
+        for (size_t k = 0; k < _keys.size(); k++)
+        {
+            fprintf(file, ",%g", _runs[i][k]);
+        }
+        fprintf(file, ",%lu,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%.3f,%.3f,%.3f,%.6f\n", r.ticks, r.simulatedTime,
+                r.position.x, r.position.y, r.position.z, r.velocity, r.ballInPlay ? 1 : 0,
+                r.ball.x, r.ball.y, r.ball.z, r.wallTime);
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,493 @@
+//
+//  CollisionProxies.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "CookedCache.h"
+#include "StaticBatcher.h"
+#include "CollisionProxies.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+/**
+ * A decomposition keeps a split only if the two boxes hold at most this
+ * fraction of the volume of the box they replace.
+ */
+static const float kSplitGain = 0.75f;
+
+/**
+ * Smallest proxy thickness in inches, flat geometry still gets a volume.
+ */
+static const float kMinThickness = 0.5f;
+
+/**
+ * Names of the shapes in frcsim.physics, in Shape order.
+ */
+static const char *kShapeNames[] = { "mesh", "box", "sphere", "capsule", "boxes" };
+
+/**
+ * Triangles of a decomposition and their bounds.
+ */
+struct Cluster
+{
+    vector<unsigned int> triangles;
+
+    Vector3 low;
+
+    Vector3 high;
+
+    bool final;                    /**< Splitting it does not pay off                 */
+};
+
+//----------------------------------------------------------------------
+//
+// getBounds()
+//
+//----------------------------------------------------------------------
+static void getBounds(const vector<Vector3> &corners, Cluster &cluster)
+{
+    cluster.low.set(FLT_MAX, FLT_MAX, FLT_MAX);
+    cluster.high.set(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (size_t i = 0; i < cluster.triangles.size(); i++)
+    {
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            const Vector3 &p = corners[cluster.triangles[i] * 3 + c];
+            cluster.low.set(min(cluster.low.x, p.x), min(cluster.low.y, p.y), min(cluster.low.z, p.z));
+            cluster.high.set(max(cluster.high.x, p.x), max(cluster.high.y, p.y), max(cluster.high.z, p.z));
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// getVolume()
+//
+//----------------------------------------------------------------------
+static float getVolume(const Cluster &cluster)
+{
+    Vector3 size = cluster.high - cluster.low;
+    return max(size.x, kMinThickness) * max(size.y, kMinThickness) * max(size.z, kMinThickness);
+}
+
+/**
+ * Orders triangles by their centroid along one axis.
+ */
+struct CentroidLess
+{
+    CentroidLess(const vector<Vector3> &corners, int axis) : _corners(corners), _axis(axis) {}
+
+    float centroid(unsigned int triangle) const
+    {
+        const Vector3 *p = &_corners[triangle * 3];
+        return (_axis == 0) ? p[0].x + p[1].x + p[2].x : ((_axis == 1) ? p[0].y + p[1].y + p[2].y : p[0].z + p[1].z + p[2].z);
+    }
+
+    bool operator()(unsigned int a, unsigned int b) const { return centroid(a) < centroid(b); }
+
+    const vector<Vector3> &_corners;
+
+    int _axis;
+};
+
+//----------------------------------------------------------------------
+//
+// CollisionProxies()
+//
+//----------------------------------------------------------------------
+CollisionProxies::CollisionProxies() :
+    _max_boxes(kDefaultMaxBoxes)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// load()
+//
+//----------------------------------------------------------------------
+bool CollisionProxies::load(const char *physicsFile)
+{
+    _physics_file = physicsFile;
+    _collision_object = "staticBox";
+    _max_boxes = kDefaultMaxBoxes;
+    _rules.clear();
+    Properties* physics = Properties::create(physicsFile);
+    if (!physics)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] Physics file \"%s\" not read\n", physicsFile);
+#endif // DEBUG
+        return false;
+    }
+    Properties* proxies = physics->getNamespace("collisionProxies", true, false);
+    if (proxies)
+    {
+        if (proxies->exists("collisionObject"))
+        {
+            _collision_object = proxies->getString("collisionObject");
+        }
+        if (proxies->exists("maxBoxes"))
+        {
+            _max_boxes = (unsigned int)max(1, proxies->getInt("maxBoxes"));
+        }
+        Properties* nodes = proxies->getNamespace("nodes", true, false);
+        const char* name = nodes ? nodes->getNextProperty() : NULL;
+        for ( ; name; name = nodes->getNextProperty())
+        {
+            const char* value = nodes->getString();
+            Rule rule;
+            rule.node = name;
+            rule.shape = MESH;
+            for (unsigned int s = 0; s < sizeof(kShapeNames) / sizeof(kShapeNames[0]); s++)
+            {
+                if (value && strcmp(value, kShapeNames[s]) == 0)
+                {
+                    rule.shape = (Shape)s;
+                }
+            }
+            _rules.push_back(rule);
+        }
+    }
+    SAFE_DELETE(physics);
+    return !_rules.empty();
+}
+
+//----------------------------------------------------------------------
+//
+// apply()
+//
+//----------------------------------------------------------------------
+unsigned int CollisionProxies::apply(Scene *scene, const string &bundle)
+{
+    _proxies.clear();
+    if (_rules.empty())
+    {
+        return 0;
+    }
+    CookedCache cache(bundle, CookedCache::COLLISION_PROXIES);
+    if (!readCooked(cache))
+    {
+        fit(scene);
+        CookedCache::Writer writer;
+        uint64_t hash = getRulesHash();
+        writer.putUInt((uint32_t)hash);
+        writer.putUInt((uint32_t)(hash >> 32));
+        writer.putUInt((uint32_t)_proxies.size());
+        for (size_t i = 0; i < _proxies.size(); i++)
+        {
+            const Proxy &proxy = _proxies[i];
+            writer.putString(proxy.node.c_str());
+            writer.putUInt(proxy.shape);
+            writer.putFloat(proxy.center.x);
+            writer.putFloat(proxy.center.y);
+            writer.putFloat(proxy.center.z);
+            writer.putFloat(proxy.size.x);
+            writer.putFloat(proxy.size.y);
+            writer.putFloat(proxy.size.z);
+        }
+        if (cache.hasSource())
+        {
+            cache.save(writer);
+        }
+    }
+
+    PhysicsRigidBody::Parameters parameters;
+    parameters.mass = 0.0f;
+    string url = _physics_file + "#" + _collision_object;
+    Properties* object = Properties::create(url.c_str());
+    if (object)
+    {
+        parameters.friction = object->exists("friction") ? object->getFloat("friction") : parameters.friction;
+        parameters.restitution = object->exists("restitution") ? object->getFloat("restitution") : parameters.restitution;
+        parameters.linearDamping = object->exists("linearDamping") ? object->getFloat("linearDamping") : parameters.linearDamping;
+        parameters.angularDamping = object->exists("angularDamping") ? object->getFloat("angularDamping") : parameters.angularDamping;
+        SAFE_DELETE(object);
+    }
+
+    unsigned int created = 0;
+    for (size_t i = 0; i < _rules.size(); i++)
+    {
+        Node* node = scene->findNode(_rules[i].node.c_str());
+        if (node && _rules[i].shape == MESH)
+        {
+            string mesh_url = _physics_file + "#staticMesh";
+            node->setCollisionObject(mesh_url.c_str());
+            created++;
+        }
+    }
+    unsigned int part = 0;
+    for (size_t i = 0; i < _proxies.size(); i++)
+    {
+        const Proxy &proxy = _proxies[i];
+        Node* node = scene->findNode(proxy.node.c_str());
+        if (!node)
+        {
+            continue;
+        }
+        PhysicsCollisionShape::Definition shape;
+        switch (proxy.shape)
+        {
+            case SPHERE:
+                shape = PhysicsCollisionShape::sphere(proxy.size.x, proxy.center);
+                break;
+            case CAPSULE:
+                shape = PhysicsCollisionShape::capsule(proxy.size.x, proxy.size.y, proxy.center);
+                break;
+            default:
+                shape = PhysicsCollisionShape::box(proxy.size, proxy.center);
+                break;
+        }
+        if (proxy.shape == BOXES)
+        {
+            // A node has one collision object, every box gets a child
+            char id[32];
+            sprintf(id, "collisionProxy%u", part++);
+            Node* child = Node::create(id);
+            node->addChild(child);
+            child->setCollisionObject(PhysicsCollisionObject::RIGID_BODY, shape, &parameters);
+            child->release();
+        }
+        else
+        {
+            node->setCollisionObject(PhysicsCollisionObject::RIGID_BODY, shape, &parameters);
+        }
+        created++;
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] %u collision objects for %lu field nodes\n", created, (unsigned long)_rules.size());
+#endif // DEBUG
+    return created;
+}
+
+//----------------------------------------------------------------------
+//
+// readCooked()
+//
+//----------------------------------------------------------------------
+bool CollisionProxies::readCooked(const CookedCache &cache)
+{
+    if (!cache.isCooked())
+    {
+        return false;
+    }
+    CookedCache::Reader reader = cache.getReader();
+    uint64_t hash = reader.getUInt();
+    hash |= (uint64_t)reader.getUInt() << 32;
+    if (hash != getRulesHash())
+    {
+        return false;
+    }
+    vector<Proxy> proxies;
+    unsigned int count = reader.getUInt();
+    for (unsigned int i = 0; i < count && reader.isValid(); i++)
+    {
+        Proxy proxy;
+        proxy.node = reader.getString();
+        proxy.shape = reader.getUInt();
+        proxy.center.x = reader.getFloat();
+        proxy.center.y = reader.getFloat();
+        proxy.center.z = reader.getFloat();
+        proxy.size.x = reader.getFloat();
+        proxy.size.y = reader.getFloat();
+        proxy.size.z = reader.getFloat();
+        proxies.push_back(proxy);
+    }
+    if (!reader.isValid() || !reader.isAtEnd())
+    {
+        return false;
+    }
+    _proxies.swap(proxies);
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// getRulesHash()
+//
+//----------------------------------------------------------------------
+uint64_t CollisionProxies::getRulesHash() const
+{
+    string rules;
+    char max_boxes[16];
+    sprintf(max_boxes, "%u;", _max_boxes);
+    rules += max_boxes;
+    for (size_t i = 0; i < _rules.size(); i++)
+    {
+        rules += _rules[i].node + "=" + kShapeNames[_rules[i].shape] + ";";
+    }
+    return CookedCache::hash(rules.data(), rules.size());
+}
+
+//----------------------------------------------------------------------
+//
+// fit()
+//
+//----------------------------------------------------------------------
+void CollisionProxies::fit(Scene *scene)
+{
+    vector<Vector3> triangles;
+    for (size_t i = 0; i < _rules.size(); i++)
+    {
+        if (_rules[i].shape == MESH)
+        {
+            continue;
+        }
+        Node* node = scene->findNode(_rules[i].node.c_str());
+        if (!node || !readTriangles(node, triangles))
+        {
+#if DEBUG
+            fprintf(stderr, "[ERROR] No mesh to fit a collision proxy to for node \"%s\"\n", _rules[i].node.c_str());
+#endif // DEBUG
+            continue;
+        }
+        fit(_rules[i], triangles);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// fit()
+//
+//----------------------------------------------------------------------
+void CollisionProxies::fit(const Rule &rule, const vector<Vector3> &triangles)
+{
+    Cluster all;
+    all.final = false;
+    all.triangles.resize(triangles.size() / 3);
+    for (unsigned int t = 0; t < all.triangles.size(); t++)
+    {
+        all.triangles[t] = t;
+    }
+    getBounds(triangles, all);
+
+    vector<Cluster> clusters(1, all);
+    while (rule.shape == BOXES && clusters.size() < _max_boxes)
+    {
+        // Split the largest box that can still be split
+        int largest = -1;
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            if (!clusters[c].final && (largest < 0 || getVolume(clusters[c]) > getVolume(clusters[largest])))
+            {
+                largest = (int)c;
+            }
+        }
+        if (largest < 0)
+        {
+            break;
+        }
+        Cluster &cluster = clusters[largest];
+        if (cluster.triangles.size() < 2)
+        {
+            cluster.final = true;
+            continue;
+        }
+        Vector3 size = cluster.high - cluster.low;
+        int axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+        vector<unsigned int>::iterator median = cluster.triangles.begin() + cluster.triangles.size() / 2;
+        std::nth_element(cluster.triangles.begin(), median, cluster.triangles.end(), CentroidLess(triangles, axis));
+        Cluster low;
+        Cluster high;
+        low.final = false;
+        high.final = false;
+        low.triangles.assign(cluster.triangles.begin(), median);
+        high.triangles.assign(median, cluster.triangles.end());
+        getBounds(triangles, low);
+        getBounds(triangles, high);
+        if (getVolume(low) + getVolume(high) > kSplitGain * getVolume(cluster))
+        {
+            cluster.final = true;
+            continue;
+        }
+        cluster = low;
+        clusters.push_back(high);
+    }
+
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        Proxy proxy;
+        proxy.node = rule.node;
+        proxy.shape = rule.shape;
+        proxy.center = (clusters[c].low + clusters[c].high) * 0.5f;
+        Vector3 size = clusters[c].high - clusters[c].low;
+        proxy.size.set(max(size.x, kMinThickness), max(size.y, kMinThickness), max(size.z, kMinThickness));
+        if (rule.shape == SPHERE || rule.shape == CAPSULE)
+        {
+            // Farthest corner from the center, around the Y axis for a capsule
+            float radius = 0.0f;
+            for (size_t i = 0; i < triangles.size(); i++)
+            {
+                Vector3 offset = triangles[i] - proxy.center;
+                if (rule.shape == CAPSULE)
+                {
+                    offset.y = 0.0f;
+                }
+                radius = max(radius, offset.lengthSquared());
+            }
+            radius = max((float)sqrt(radius), kMinThickness);
+            proxy.size.set(radius, (rule.shape == CAPSULE) ? max(size.y, 2.0f * radius) : 0.0f, 0.0f);
+        }
+        _proxies.push_back(proxy);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// readTriangles()
+//
+//----------------------------------------------------------------------
+bool CollisionProxies::readTriangles(Node *node, vector<Vector3> &triangles)
+{
+    triangles.clear();
+    Model* model = node->getModel();
+    Mesh* mesh = model ? model->getMesh() : NULL;
+    vector<float> vertices;
+    vector<unsigned int> indices;
+    if (!mesh || !StaticBatcher::readMesh(mesh, vertices, indices))
+    {
+        return false;
+    }
+    const VertexFormat &format = mesh->getVertexFormat();
+    unsigned int stride = format.getVertexSize() / sizeof(float);
+    int position_offset = -1;
+    unsigned int offset = 0;
+    for (unsigned int e = 0; e < format.getElementCount(); e++)
+    {
+        const VertexFormat::Element &element = format.getElement(e);
+        if (element.usage == VertexFormat::POSITION && element.size == 3)
+        {
+            position_offset = offset;
+        }
+        offset += element.size;
+    }
+    if (position_offset < 0)
+    {
+        return false;
+    }
+    triangles.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        const float *vertex = &vertices[indices[i] * stride + position_offset];
+        triangles.push_back(Vector3(vertex[0], vertex[1], vertex[2]));
+    }
+    return !triangles.empty();
+}
@@ -0,0 +1,350 @@
+//
+//  ControlMailbox.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+#include <string>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#ifndef ANDROID
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // ANDROID
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif // __linux__
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+#include "MatchInput.h"
+#include "Telemetry.h"
+#include "ControlMailbox.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+const char *ControlMailbox::kDefaultName = "/frcsim-control";
+
+/**
+ * Polls of a sequence before sleeping on it, long enough to cover a
+ * controller that answers within a few microseconds.  On a single core the
+ * other side cannot run while we spin, so sleep right away.
+ */
+static const int kSpinCount = 4000;
+static const int kSpins = (thread::hardware_concurrency() > 1) ? kSpinCount : 0;
+
+//----------------------------------------------------------------------
+//
+// getInput()
+//
+//----------------------------------------------------------------------
+void ControlMailbox::Command::getInput(MatchInput &input) const
+{
+    input = MatchInput();
+    if (velocity >= 0.0f)
+    {
+        input.rightTrigger = velocity;
+    }
+    else
+    {
+        input.leftTrigger = -1.0f * velocity;
+    }
+    input.launchBall = (buttons & BUTTON_LAUNCH_BALL) != 0;
+    input.fireCatapult = (buttons & BUTTON_FIRE_CATAPULT) != 0;
+}
+
+//----------------------------------------------------------------------
+//
+// ControlMailbox()
+//
+//----------------------------------------------------------------------
+ControlMailbox::ControlMailbox() :
+    _segment(NULL),
+    _sequence(0)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// ~ControlMailbox()
+//
+//----------------------------------------------------------------------
+ControlMailbox::~ControlMailbox()
+{
+    close();
+}
+
+//----------------------------------------------------------------------
+//
+// create()
+//
+//----------------------------------------------------------------------
+bool ControlMailbox::create(const char *name, double period)
+{
+    close();
+#ifndef ANDROID
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666);
+    if (fd < 0)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] ControlMailbox: cannot create %s\n", name);
+#endif // DEBUG
+        return false;
+    }
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, sizeof(Segment)) == 0)
+    {
+        memory = mmap(NULL, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] ControlMailbox: cannot map %s\n", name);
+#endif // DEBUG
+        shm_unlink(name);
+        return false;
+    }
+
+    // The segment is zero filled: no sensors or commands posted yet
+    _segment = (Segment *)memory;
+    _sequence = 0;
+    _name = name;
+    _segment->version = kVersion;
+    _segment->period = period;
+    // Controllers check the magic last, publish it after the rest
+    std::atomic_thread_fence(std::memory_order_release);
+    _segment->magic = kMagic;
+    return true;
+#else
+    return false;
+#endif // ANDROID
+}
+
+//----------------------------------------------------------------------
+//
+// open()
+//
+//----------------------------------------------------------------------
+bool ControlMailbox::open(const char *name)
+{
+    close();
+#ifndef ANDROID
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size == sizeof(Segment))
+    {
+        memory = mmap(NULL, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+    Segment *segment = (Segment *)memory;
+    bool valid = segment->magic == kMagic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid || segment->version != kVersion)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] ControlMailbox: %s is not a control mailbox\n", name);
+#endif // DEBUG
+        munmap(memory, sizeof(Segment));
+        return false;
+    }
+
+    // Start from the sensors currently posted, a controller can restart
+    _segment = segment;
+    _sequence = 0;
+    return true;
+#else
+    return false;
+#endif // ANDROID
+}
+
+//----------------------------------------------------------------------
+//
+// close()
+//
+//----------------------------------------------------------------------
+void ControlMailbox::close()
+{
+#ifndef ANDROID
+    if (_segment && !_name.empty())
+    {
+        _segment->stopped.store(1, std::memory_order_relaxed);
+        _segment->sensorSequence.fetch_add(1, std::memory_order_release);
+        wake(_segment->sensorSequence);
+    }
+    if (_segment)
+    {
+        munmap(_segment, sizeof(Segment));
+    }
+    if (!_name.empty())
+    {
+        shm_unlink(_name.c_str());
+    }
+#endif // ANDROID
+    _segment = NULL;
+    _sequence = 0;
+    _name.clear();
+}
+
+//----------------------------------------------------------------------
+//
+// postSensors()
+//
+//----------------------------------------------------------------------
+void ControlMailbox::postSensors(const TelemetrySample &sensors)
+{
+    if (!_segment)
+    {
+        return;
+    }
+    _segment->sensors = sensors;
+    _segment->sensorSequence.store(++_sequence, std::memory_order_release);
+    wake(_segment->sensorSequence);
+}
+
+//----------------------------------------------------------------------
+//
+// waitCommand()
+//
+//----------------------------------------------------------------------
+bool ControlMailbox::waitCommand(Command &command, int timeout)
+{
+    if (!_segment)
+    {
+        return false;
+    }
+
+    // Answered once the command sequence catches up with the sensors
+    if (!wait(_segment->commandSequence, _sequence - 1, timeout))
+    {
+        return false;
+    }
+    command = _segment->command;
+    return command.detach == 0;
+}
+
+//----------------------------------------------------------------------
+//
+// waitSensors()
+//
+//----------------------------------------------------------------------
+bool ControlMailbox::waitSensors(TelemetrySample &sensors, int timeout)
+{
+    if (!_segment || !wait(_segment->sensorSequence, _sequence, timeout))
+    {
+        return false;
+    }
+    _sequence = _segment->sensorSequence.load(std::memory_order_acquire);
+    if (_segment->stopped.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    sensors = _segment->sensors;
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// postCommand()
+//
+//----------------------------------------------------------------------
+void ControlMailbox::postCommand(const Command &command)
+{
+    if (!_segment)
+    {
+        return;
+    }
+    _segment->command = command;
+    _segment->commandSequence.store(_sequence, std::memory_order_release);
+    wake(_segment->commandSequence);
+}
+
+//----------------------------------------------------------------------
+//
+// wait()
+//
+//----------------------------------------------------------------------
+bool ControlMailbox::wait(std::atomic<uint32_t> &sequence, uint32_t value, int timeout)
+{
+    for (int i = 0; i < kSpins; i++)
+    {
+        if (sequence.load(std::memory_order_acquire) != value)
+        {
+            return true;
+        }
+#if defined(__i386__) || defined(__x86_64__)
+        _mm_pause();
+#endif
+    }
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout);
+    while (sequence.load(std::memory_order_acquire) == value)
+    {
+        chrono::steady_clock::duration left = deadline - chrono::steady_clock::now();
+        if (timeout >= 0 && left <= chrono::steady_clock::duration::zero())
+        {
+            return false;
+        }
+#ifdef __linux__
+        // Returns at once if the sequence already moved, wakes spuriously
+        // and on signals, all of which the loop handles
+        struct timespec wait_time;
+        struct timespec *wait_limit = NULL;
+        if (timeout >= 0)
+        {
+            long long ns = chrono::duration_cast<chrono::nanoseconds>(left).count();
+            wait_time.tv_sec = (time_t)(ns / 1000000000LL);
+            wait_time.tv_nsec = (long)(ns % 1000000000LL);
+            wait_limit = &wait_time;
+        }
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&sequence), FUTEX_WAIT, value, wait_limit, NULL, 0);
+#else
+        this_thread::sleep_for(chrono::microseconds(20));
+#endif // __linux__
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// wake()
+//
+//----------------------------------------------------------------------
+void ControlMailbox::wake(std::atomic<uint32_t> &sequence)
+{
+#ifdef __linux__
+    // Shared (not FUTEX_PRIVATE) wake, the waiter is another process
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&sequence), FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+    (void)sequence;
+#endif // __linux__
+}
@@ -0,0 +1,207 @@
+//
+//  CookedCache.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include <vector>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#include "CookedCache.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+//----------------------------------------------------------------------
+//
+// CookedCache()
+//
+//----------------------------------------------------------------------
+CookedCache::CookedCache(const string &source, Kind kind) :
+    _source_path(source),
+    _cooked_path(source + ".cooked"),
+    _kind(kind),
+    _source(NULL),
+    _source_size(0),
+    _source_hash(0),
+    _cooked(NULL),
+    _cooked_size(0)
+{
+    _source = map(_source_path, _source_size);
+    if (!_source)
+    {
+        return;
+    }
+    _source_hash = hash(_source, _source_size);
+
+    _cooked = map(_cooked_path, _cooked_size);
+    if (!_cooked)
+    {
+        return;
+    }
+    Header header;
+    bool valid = (_cooked_size >= sizeof(header));
+    if (valid)
+    {
+        memcpy(&header, _cooked, sizeof(header));
+        valid = (header.magic == kMagic &&
+                 header.version == kVersion &&
+                 header.kind == (uint32_t)_kind &&
+                 header.sourceSize == _source_size &&
+                 header.sourceHash == _source_hash &&
+                 header.payloadSize == _cooked_size - sizeof(header));
+    }
+    if (!valid)
+    {
+#ifdef DEBUG
+        fprintf(stderr, "[Debug] Cooked file \"%s\" out of date\n", _cooked_path.c_str());
+#endif // DEBUG
+        unmap(_cooked, _cooked_size);
+        _cooked = NULL;
+        _cooked_size = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// ~CookedCache()
+//
+//----------------------------------------------------------------------
+CookedCache::~CookedCache()
+{
+    unmap(_source, _source_size);
+    unmap(_cooked, _cooked_size);
+}
+
+//----------------------------------------------------------------------
+//
+// getReader()
+//
+//----------------------------------------------------------------------
+CookedCache::Reader CookedCache::getReader() const
+{
+    if (!_cooked)
+    {
+        return Reader(NULL, 0);
+    }
+    return Reader(_cooked + sizeof(Header), _cooked_size - sizeof(Header));
+}
+
+//----------------------------------------------------------------------
+//
+// save()
+//
+//----------------------------------------------------------------------
+bool CookedCache::save(const Writer &writer) const
+{
+    if (!_source)
+    {
+        return false;
+    }
+    const vector<unsigned char> &payload = writer.getData();
+    Header header;
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.kind = (uint32_t)_kind;
+    header.payloadSize = (uint32_t)payload.size();
+    header.sourceSize = _source_size;
+    header.sourceHash = _source_hash;
+
+    char suffix[32];
+    sprintf(suffix, ".%d.tmp", (int)getpid());
+    string temp_path = _cooked_path + suffix;
+    FILE *file = fopen(temp_path.c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool written = (fwrite(&header, sizeof(header), 1, file) == 1);
+    if (written && !payload.empty())
+    {
+        written = (fwrite(&payload[0], payload.size(), 1, file) == 1);
+    }
+    written = (fclose(file) == 0) && written;
+    if (!written || rename(temp_path.c_str(), _cooked_path.c_str()) != 0)
+    {
+        remove(temp_path.c_str());
+#if DEBUG
+        fprintf(stderr, "[ERROR] Cooked file \"%s\" not written\n", _cooked_path.c_str());
+#endif // DEBUG
+        return false;
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Cooked \"%s\" (%lu bytes)\n", _cooked_path.c_str(), (unsigned long)payload.size());
+#endif // DEBUG
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// hash()
+//
+//----------------------------------------------------------------------
+uint64_t CookedCache::hash(const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char*)data;
+    uint64_t value = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+        value ^= bytes[i];
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
+
+//----------------------------------------------------------------------
+//
+// map()
+//
+//----------------------------------------------------------------------
+const unsigned char *CookedCache::map(const string &path, size_t &size)
+{
+    size = 0;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size <= 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+    size = (size_t)status.st_size;
+    return (const unsigned char*)data;
+}
+
+//----------------------------------------------------------------------
+//
+// unmap()
+//
+//----------------------------------------------------------------------
+void CookedCache::unmap(const unsigned char *data, size_t size)
+{
+    if (data)
+    {
+        munmap((void*)data, size);
+    }
+}
@@ -0,0 +1,145 @@
+//
+//  DrawList.cpp
+//  FrcSim
+//
+//
+
+#include <vector>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "DrawList.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+//----------------------------------------------------------------------
+//
+// View::set()
+//
+//----------------------------------------------------------------------
+void DrawList::View::set(const Camera *camera, const Node *spotLight)
+{
+    view = camera->getViewMatrix();
+    viewProjection = camera->getViewProjectionMatrix();
+    Node *camera_node = camera->getNode();
+    eye = camera_node->getTranslationWorld();
+    forward = camera_node->getForwardVectorWorld();
+
+    // What Node::getTranslationView() and getForwardVectorView() return
+    // with this camera active
+    spotLightPosition.set(0.0f, 0.0f, 0.0f);
+    spotLightDirection.set(0.0f, 0.0f, -1.0f);
+    if (spotLight)
+    {
+        view.transformPoint(spotLight->getTranslationWorld(), &spotLightPosition);
+        view.transformVector(spotLight->getForwardVectorWorld(), &spotLightDirection);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// bind()
+//
+//----------------------------------------------------------------------
+bool DrawList::bind(Node *node, Binding &binding)
+{
+    Model *model = node->getModel();
+    Material *material = model ? model->getMaterial() : NULL;
+    if (!material)
+    {
+        return false;
+    }
+    binding.worldView = material->getParameter("u_worldViewMatrix");
+    binding.worldViewProjection = material->getParameter("u_worldViewProjectionMatrix");
+    binding.inverseTransposeWorldView = material->getParameter("u_inverseTransposeWorldViewMatrix");
+    binding.spotLightPosition = material->getParameter("u_spotLightPosition[0]");
+    binding.spotLightDirection = material->getParameter("u_spotLightDirection[0]");
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// DrawList()
+//
+//----------------------------------------------------------------------
+DrawList::DrawList()
+{
+}
+
+//----------------------------------------------------------------------
+//
+// build()
+//
+//----------------------------------------------------------------------
+void DrawList::build(const RenderQueue &queue, const vector<Binding> &bindings, const View &view)
+{
+    _commands.resize(queue.size());
+    _spot_light_position = view.spotLightPosition;
+    _spot_light_direction = view.spotLightDirection;
+    JobSystem::getInstance().parallelFor(0, queue.size(), kCommandsPerJob, [this, &queue, &bindings, &view](size_t begin, size_t end)
+    {
+        PROFILE_ZONE("DrawList::build");
+        for (size_t i = begin; i < end; i++)
+        {
+            const RenderQueue::Draw &draw = queue[i];
+            Command &command = _commands[i];
+            command.model = draw.node->getModel();
+            command.state = draw.state;
+            command.binding = NULL;
+            if (draw.binding == RenderQueue::kNoBinding)
+            {
+                continue;
+            }
+            command.binding = &bindings[draw.binding];
+            const Matrix &world = draw.node->getWorldMatrix();
+            Matrix::multiply(view.view, world, &command.worldView);
+            Matrix::multiply(view.viewProjection, world, &command.worldViewProjection);
+            command.worldView.invert(&command.inverseTransposeWorldView);
+            command.inverseTransposeWorldView.transpose();
+        }
+    });
+}
+
+//----------------------------------------------------------------------
+//
+// draw()
+//
+//----------------------------------------------------------------------
+unsigned int DrawList::draw(bool wireframe, unsigned int &state) const
+{
+    unsigned int changes = 0;
+    for (size_t i = 0; i < _commands.size(); i++)
+    {
+        const Command &command = _commands[i];
+        if ((command.state ^ state) & 0xFFFF0000)
+        {
+            changes++;
+        }
+        if ((command.state ^ state) & 0x0000FFFF)
+        {
+            changes++;
+        }
+        state = command.state;
+        const Binding *binding = command.binding;
+        if (binding)
+        {
+            binding->worldView->setValue(command.worldView);
+            binding->worldViewProjection->setValue(command.worldViewProjection);
+            binding->inverseTransposeWorldView->setValue(command.inverseTransposeWorldView);
+            binding->spotLightPosition->setValue(_spot_light_position);
+            binding->spotLightDirection->setValue(_spot_light_direction);
+        }
+        command.model->draw(wireframe);
+    }
+    return changes;
+}
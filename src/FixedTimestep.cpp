@@ -0,0 +1,60 @@
+//
+//  FixedTimestep.cpp
+//  FrcSim
+//
+//
+
+#include "FixedTimestep.h"
+
+const float FixedTimestep::kDefaultStep = 1.0f / 60.0f;
+
+//----------------------------------------------------------------------
+//
+// FixedTimestep()
+//
+//----------------------------------------------------------------------
+FixedTimestep::FixedTimestep(float step, unsigned int maxSubsteps) :
+    _step(step),
+    _max_substeps(maxSubsteps),
+    _accumulator(0.0),
+    _dropped(0.0)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// advance()
+//
+//----------------------------------------------------------------------
+unsigned int FixedTimestep::advance(double elapsedTime)
+{
+    if (elapsedTime > 0.0)
+    {
+        _accumulator += elapsedTime;
+    }
+    unsigned int steps = 0;
+    while (_accumulator >= _step && steps < _max_substeps)
+    {
+        _accumulator -= _step;
+        steps++;
+    }
+    if (_accumulator >= _step)
+    {
+        // Over budget, keep the fraction so interpolation stays smooth
+        double excess = _accumulator - _step * (unsigned long)(_accumulator / _step);
+        _dropped += _accumulator - excess;
+        _accumulator = excess;
+    }
+    return steps;
+}
+
+//----------------------------------------------------------------------
+//
+// reset()
+//
+//----------------------------------------------------------------------
+void FixedTimestep::reset()
+{
+    _accumulator = 0.0;
+    _dropped = 0.0;
+}
@@ -0,0 +1,469 @@
+//
+//  FrameCapture.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include <vector>
+#include <string>
+
+#include <png.h>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "FrameCapture.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+//----------------------------------------------------------------------
+//
+// FrameCapture()
+//
+//----------------------------------------------------------------------
+FrameCapture::FrameCapture() :
+    _framebuffer(NULL),
+    _previous(NULL),
+    _width(0),
+    _height(0),
+    _format(RAW),
+    _raw(NULL),
+    _next_readback(0),
+    _frame(0),
+    _stopping(false),
+    _written(0),
+    _dropped(0)
+{
+    for (unsigned int i = 0; i < kReadbackDepth; i++)
+    {
+        _readbacks[i].buffer = 0;
+        _readbacks[i].fence = NULL;
+        _readbacks[i].frame = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// ~FrameCapture()
+//
+//----------------------------------------------------------------------
+FrameCapture::~FrameCapture()
+{
+    close();
+}
+
+//----------------------------------------------------------------------
+//
+// open()
+//
+//----------------------------------------------------------------------
+bool FrameCapture::open(unsigned int width, unsigned int height, const string &path, Format format)
+{
+    close();
+    if (width == 0 || height == 0)
+    {
+        return false;
+    }
+    if (format == PNG && path.find('%') == string::npos)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] PNG capture path \"%s\" has no frame number\n", path.c_str());
+#endif // DEBUG
+        return false;
+    }
+    if (format == RAW)
+    {
+        _raw = fopen(path.c_str(), "wb");
+        if (!_raw)
+        {
+#if DEBUG
+            fprintf(stderr, "[ERROR] Capture file \"%s\" not created\n", path.c_str());
+#endif // DEBUG
+            return false;
+        }
+    }
+    _width = width;
+    _height = height;
+    _path = path;
+    _format = format;
+    _frame = 0;
+    _written = 0;
+    _dropped = 0;
+
+    // Color and depth, the scene is drawn with depth testing
+    _framebuffer = FrameBuffer::create("frameCapture", width, height);
+    DepthStencilTarget *depth = DepthStencilTarget::create("frameCaptureDepth", DepthStencilTarget::DEPTH, width, height);
+    _framebuffer->setDepthStencilTarget(depth);
+    SAFE_RELEASE(depth);
+
+    size_t size = (size_t)width * height * 4;
+#ifndef OPENGL_ES
+    for (unsigned int i = 0; i < kReadbackDepth; i++)
+    {
+        glGenBuffers(1, &_readbacks[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, _readbacks[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        _readbacks[i].fence = NULL;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif // OPENGL_ES
+    _next_readback = 0;
+
+    // Every frame is allocated here, capturing allocates nothing
+    _free.clear();
+    for (unsigned int i = 0; i < kFrameCount; i++)
+    {
+        _frames[i].pixels.resize(size);
+        _free.push_back(&_frames[i]);
+    }
+    _stopping = false;
+    if (_format == RAW)
+    {
+        _writer = thread(&FrameCapture::writerLoop, this);
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Capturing %ux%u frames to \"%s\"\n", width, height, path.c_str());
+#endif // DEBUG
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// close()
+//
+//----------------------------------------------------------------------
+void FrameCapture::close()
+{
+    if (!_framebuffer)
+    {
+        return;
+    }
+    collect(true);
+#ifndef OPENGL_ES
+    for (unsigned int i = 0; i < kReadbackDepth; i++)
+    {
+        glDeleteBuffers(1, &_readbacks[i].buffer);
+        _readbacks[i].buffer = 0;
+    }
+#endif // OPENGL_ES
+    SAFE_RELEASE(_framebuffer);
+    _previous = NULL;
+
+    // The writer and the encoding jobs finish what was queued
+    JobSystem::getInstance().wait(_jobs);
+    if (_writer.joinable())
+    {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _frame_ready.notify_all();
+        _writer.join();
+    }
+    if (_raw)
+    {
+        fclose(_raw);
+        _raw = NULL;
+    }
+    _free.clear();
+    for (unsigned int i = 0; i < kFrameCount; i++)
+    {
+        vector<unsigned char>().swap(_frames[i].pixels);
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Capture of %u frames closed, %u written, %u dropped\n", _frame, (unsigned int)_written, (unsigned int)_dropped);
+#endif // DEBUG
+}
+
+//----------------------------------------------------------------------
+//
+// begin()
+//
+//----------------------------------------------------------------------
+void FrameCapture::begin()
+{
+    _previous = _framebuffer->bind();
+}
+
+//----------------------------------------------------------------------
+//
+// end()
+//
+//----------------------------------------------------------------------
+void FrameCapture::end()
+{
+    PROFILE_ZONE("FrameCapture::end");
+    unsigned int frame = _frame++;
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+#ifndef OPENGL_ES
+    // The buffer about to be reused holds the oldest frame, which is the
+    // only one the CPU ever waits for
+    Readback &readback = _readbacks[_next_readback];
+    if (readback.fence)
+    {
+        finish(readback);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.frame = frame;
+    _next_readback = (_next_readback + 1) % kReadbackDepth;
+    glFlush();
+#else
+    Frame *pooled = acquire();
+    if (pooled)
+    {
+        glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, &pooled->pixels[0]);
+        pooled->index = frame;
+        submit(pooled);
+    }
+    else
+    {
+        _dropped++;
+    }
+#endif // OPENGL_ES
+    if (_previous)
+    {
+        _previous->bind();
+    }
+    else
+    {
+        FrameBuffer::bindDefault();
+    }
+    collect(false);
+}
+
+//----------------------------------------------------------------------
+//
+// collect()
+//
+//----------------------------------------------------------------------
+void FrameCapture::collect(bool wait)
+{
+#ifndef OPENGL_ES
+    for (unsigned int i = 0; i < kReadbackDepth; i++)
+    {
+        Readback &readback = _readbacks[(_next_readback + i) % kReadbackDepth];
+        if (!readback.fence)
+        {
+            continue;
+        }
+        if (!wait)
+        {
+            GLenum status = glClientWaitSync(readback.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            {
+                // Later frames are not ready either
+                return;
+            }
+        }
+        finish(readback);
+    }
+#endif // OPENGL_ES
+}
+
+//----------------------------------------------------------------------
+//
+// finish()
+//
+//----------------------------------------------------------------------
+void FrameCapture::finish(Readback &readback)
+{
+#ifndef OPENGL_ES
+    PROFILE_ZONE("FrameCapture::finish");
+    glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(readback.fence);
+    readback.fence = NULL;
+    Frame *frame = acquire();
+    if (!frame)
+    {
+        _dropped++;
+        return;
+    }
+    size_t size = frame->pixels.size();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (pixels)
+    {
+        memcpy(&frame->pixels[0], pixels, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!pixels)
+    {
+        release(frame);
+        _dropped++;
+        return;
+    }
+    frame->index = readback.frame;
+    submit(frame);
+#endif // OPENGL_ES
+}
+
+//----------------------------------------------------------------------
+//
+// acquire()
+//
+//----------------------------------------------------------------------
+FrameCapture::Frame *FrameCapture::acquire()
+{
+    lock_guard<mutex> lock(_mutex);
+    if (_free.empty())
+    {
+        return NULL;
+    }
+    Frame *frame = _free.back();
+    _free.pop_back();
+    return frame;
+}
+
+//----------------------------------------------------------------------
+//
+// release()
+//
+//----------------------------------------------------------------------
+void FrameCapture::release(Frame *frame)
+{
+    lock_guard<mutex> lock(_mutex);
+    _free.push_back(frame);
+}
+
+//----------------------------------------------------------------------
+//
+// submit()
+//
+//----------------------------------------------------------------------
+void FrameCapture::submit(Frame *frame)
+{
+    if (_format == RAW)
+    {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _queue.push_back(frame);
+        }
+        _frame_ready.notify_one();
+        return;
+    }
+
+    // Files are independent, encode several at once
+    JobSystem::getInstance().run([this, frame]()
+    {
+        PROFILE_ZONE("FrameCapture::writePng");
+        if (writePng(*frame))
+        {
+            _written++;
+        }
+        release(frame);
+    }, &_jobs);
+}
+
+//----------------------------------------------------------------------
+//
+// writerLoop()
+//
+//----------------------------------------------------------------------
+void FrameCapture::writerLoop()
+{
+    unique_lock<mutex> lock(_mutex);
+    while (true)
+    {
+        while (!_stopping && _queue.empty())
+        {
+            _frame_ready.wait(lock);
+        }
+        if (_queue.empty())
+        {
+            // Stopping and nothing left to write
+            return;
+        }
+        Frame *frame = _queue.front();
+        _queue.pop_front();
+        lock.unlock();
+        bool written = writeRaw(*frame);
+        lock.lock();
+        _free.push_back(frame);
+        if (written)
+        {
+            _written++;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// writeRaw()
+//
+//----------------------------------------------------------------------
+bool FrameCapture::writeRaw(const Frame &frame)
+{
+    // GL rows are bottom-up, files are top-down
+    size_t stride = (size_t)_width * 4;
+    for (unsigned int y = _height; y > 0; y--)
+    {
+        if (fwrite(&frame.pixels[(y - 1) * stride], 1, stride, _raw) != stride)
+        {
+#if DEBUG
+            fprintf(stderr, "[ERROR] Capture frame %u not written to \"%s\"\n", frame.index, _path.c_str());
+#endif // DEBUG
+            return false;
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// writePng()
+//
+//----------------------------------------------------------------------
+bool FrameCapture::writePng(const Frame &frame) const
+{
+    char filename[1024];
+    snprintf(filename, sizeof(filename), _path.c_str(), frame.index);
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] Capture frame \"%s\" not created\n", filename);
+#endif // DEBUG
+        return false;
+    }
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    if (!info || setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_write_struct(&png, info ? &info : NULL);
+        fclose(file);
+#if DEBUG
+        fprintf(stderr, "[ERROR] Capture frame \"%s\" not encoded\n", filename);
+#endif // DEBUG
+        return false;
+    }
+    png_init_io(png, file);
+
+    // Fastest deflate, frames are written as fast as they are drawn
+    png_set_compression_level(png, 1);
+    png_set_IHDR(png, info, _width, _height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    size_t stride = (size_t)_width * 4;
+    for (unsigned int y = _height; y > 0; y--)
+    {
+        png_write_row(png, (png_const_bytep)&frame.pixels[(y - 1) * stride]);
+    }
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+    fclose(file);
+    return true;
+}
@@ -29,6 +29,7 @@ using namespace gameplay;
 
 #include "json/IJsonSerializable.h"
 #include "Robot.h"
+#include "MatchInput.h"
 #include "FrcSim.h"
 
 #ifdef ANDROID
@@ -45,6 +46,10 @@ const GFileName AerialAssist::_kSceneFile = "res/frcsim.scene";
 const float AerialAssist::_joystickDeadband = 0.05;
 const int AerialAssist::kHudWidth = 320;
 const int AerialAssist::kHudHeight = 200;
+const unsigned int AerialAssist::kTexturesPerFrame = 8;
+const char *AerialAssist::kMatchLogFile = "frcsim-match.frcr";
+const char *AerialAssist::kCaptureFile = "frcsim-capture.rgba";
+const double AerialAssist::kReplaySpeeds[] = { 1.0, 2.0, 4.0, 8.0 };
 
 //----------------------------------------------------------------------
 //
@@ -53,18 +58,32 @@ const int AerialAssist::kHudHeight = 200;
 //----------------------------------------------------------------------
 AerialAssist::AerialAssist() :
     _spotlight_node(NULL),
-    _scene(NULL),
     _spotlight(NULL),
     _robot(NULL),
-    _font(NULL),
-    _gamepad(NULL),
     _elapsedTime(0.0),
     _active_camera(High),
     _hud_camera(Overhead),
+    _culling_camera(High),
+    _state_changes(0),
+    _scene(NULL),
+    _font(NULL),
+    _gamepad(NULL),
     _wireframe(false),
     _physicsDebug(true),
-    _ball_in_play(false),
-    _view_frustrum_culling(true)
+    _launch_held(false),
+    _view_frustrum_culling(true),
+    _profiler_overlay(false),
+    _loader(NULL),
+    _decoded(NULL),
+    _catapult_joint(-1),
+    _match_tick(0),
+    _match_time(0.0),
+    _replaying(false),
+    _replay_speed(0),
+    _replay_clock(0.0),
+    _capture_camera(Chase),
+    _capture_only(false),
+    _loading_stage(LOAD_DECODING)
 {
     for (int i = 0; i < CameraCount; i++)
     {
@@ -81,19 +100,105 @@ void AerialAssist::initialize()
 {
     _gamepad = getGamepad(0);
     
+    // Dashboards on this machine read every tick from shared memory
+    _telemetry.create();
+    
 	// Create the font and scene
     _font = Font::create("res/ui/arial.gpb");
     
     GFileName resPath = FileSystem::getResourcePath();
     GFileName textureMapFile = _kFieldTextureMap;
-    GFileName AerialAssistField = _kFieldBundle;
     GString fullPath = resPath + textureMapFile;
     
     // Copy files from "res" directory to Android SD card
     FileSystem::createFileFromAsset(textureMapFile);
     
-    textureList.clear();
-    loadTextureMap((const char*)fullPath);
+    _textureMap.clear();
+    
+    // JSON, PNG decoding and bundle reads run on the workers, update()
+    // finishes loading on the main thread once they are done
+    _loader = new AssetLoader();
+    _loading_stage = LOAD_DECODING;
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Loading assets on %u threads\n", _loader->getThreadCount());
+#endif // DEBUG
+    _loader->prefetch((const char*)(resPath + _kFieldBundle));
+    string fieldTextureMap = (const char*)fullPath;
+    string resourcePath = (const char*)resPath;
+    
+    // The job only fills its own DecodedAssets, nothing the main thread
+    // reads until continueLoading() takes them
+    AssetLoader* loader = _loader;
+    DecodedAssets* decoded = new DecodedAssets();
+    _decoded = decoded;
+    _loader->run([loader, decoded, fieldTextureMap, resourcePath]()
+    {
+        decoded->textureMap.load(fieldTextureMap);
+        decoded->robot = new Robot("/res/data/AerialAssist2028.json", false);
+        decoded->textureMap.load(resourcePath + (const char*)decoded->robot->getTextureMapFile());
+        loader->prefetch(resourcePath + (const char*)decoded->robot->getBundleFile());
+        
+        // Every texture setSceneMaterial() and createFloorModel() can use
+        vector<string> textures;
+        decoded->textureMap.getTextures(textures);
+        textures.push_back("res/textures/gray.png");
+        textures.push_back("res/textures/brown.png");
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            loader->decodeImage(textures[i]);
+        }
+    });
+}
+
+//----------------------------------------------------------------------
+//
+// continueLoading()
+//
+//----------------------------------------------------------------------
+void AerialAssist::continueLoading()
+{
+    switch (_loading_stage)
+    {
+        case LOAD_DECODING:
+            // isDecoded() acquires what the job released when it finished
+            if (_loader->isDecoded())
+            {
+                _robot = _decoded->robot;
+                _textureMap.swap(_decoded->textureMap);
+                SAFE_DELETE(_decoded);
+                _loading_stage = LOAD_TEXTURES;
+            }
+            break;
+        case LOAD_TEXTURES:
+            // A few uploads per frame keep the progress display moving
+            if (_loader->uploadTextures(_materialCache, kTexturesPerFrame))
+            {
+                _loading_stage = LOAD_SCENE;
+            }
+            break;
+        case LOAD_SCENE:
+            loadScene();
+            _loading_stage = LOAD_NODES;
+            break;
+        case LOAD_NODES:
+            createSceneNodes();
+            SAFE_DELETE(_loader);
+            _timestep.reset();
+            _loading_stage = LOAD_DONE;
+            break;
+        default:
+            break;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// loadScene()
+//
+//----------------------------------------------------------------------
+void AerialAssist::loadScene()
+{
+    GFileName AerialAssistField = _kFieldBundle;
     
 #ifdef DEBUG
     fprintf(stderr, "[Debug] Loading field model from GPB \"%s\"\n", (const char*)AerialAssistField);
@@ -104,14 +209,21 @@ void AerialAssist::initialize()
 
     // create scene
     _scene = Scene::load(_kSceneFile);
-    
-    _robot = new Robot("/res/data/AerialAssist2028.json");
+}
+
+//----------------------------------------------------------------------
+//
+// createSceneNodes()
+//
+//----------------------------------------------------------------------
+void AerialAssist::createSceneNodes()
+{
+    // Configuration and texture map were read by the loader
+    _robot->LoadModel();
     Node *robot_node = _robot->getNode();
     if (robot_node)
     {
         _scene->addNode(robot_node);
-        GFileName textureMap = resPath + _robot->getTextureMapFile();
-        loadTextureMap((const char*)textureMap);
         
         PhysicsCharacter* character = dynamic_cast<PhysicsCharacter*>(robot_node->getCollisionObject());
         if (character)
@@ -201,22 +313,35 @@ void AerialAssist::initialize()
 #ifdef DEBUG
     fprintf(stderr, "[Debug] Walking all scene nodes to set material\n");
 #endif // DEBUG
-    // Visit all the nodes in the scene to set the material
-    _scene->visit(this, &AerialAssist::setSceneMaterial);
+    // Set the material of all the nodes in the scene
+    setSceneMaterials();
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Material cache has %lu entries, %u hits\n", (unsigned long)_materialCache.getEntryCount(), _materialCache.getHitCount());
+#endif // DEBUG
     
     // Add a floor to the scene
     createFloorModel();
     
-    // Move ball onto field
+    // Every ball BUTTON_A can put in play, built now so a launch allocates
+    // nothing; the clones are dynamic nodes for the batcher and the BVH
     Node* blue_ball = _scene->findNode("GAME_BALL_BLUE_1");
-    if (blue_ball)
-    {
-        PhysicsCollisionObject* physics = blue_ball->getCollisionObject();
-        if (physics)
-        {
-            physics->setEnabled(false);
-        }
-    }
+    _ballPool.create(_scene, blue_ball, "res/frcsim.physics#ball");
+    
+    // Field collision geometry, fitted while the nodes still have models
+    _collisionProxies.load("res/frcsim.physics");
+    _collisionProxies.apply(_scene, (const char*)(GFileName(FileSystem::getResourcePath()) + _kFieldBundle));
+    
+    batchStaticNodes();
+    buildSceneBVH();
+    
+    // Resolve the nodes update() moves every frame once
+    _nodeRegistry.build(_scene);
+    _catapult_joint = _robot->getMechanism().find("Catapult");
+    _overhead_handle = _nodeRegistry.find("Overhead");
+    
+    // The collision object exists now, the fleet caches it
+    _fleet.clear();
+    _fleet.add(_robot);
 }
 
 //----------------------------------------------------------------------
@@ -285,10 +410,17 @@ void AerialAssist::setMaterial(Node* node_ptr, const char* diffuse_string_ptr, c
     Material* material_ptr = NULL;
     if (!material_set)
     {
+        // Sampler and state block are shared with every node using the same
+        // texture, the effect is shared through GamePlay's effect cache
+        MaterialCache::Key key(DEF_SHADER, diffuse_string_ptr, node_ptr->hasTag("transparent"), specularity);
+        const MaterialCache::Entry& cached = _materialCache.get(key);
+        _materialCache.setNodeEntry(node_ptr, cached.id);
         material_ptr = model->setMaterial(VERT_SHADER, FRAG_SHADER, DEF_SHADER);
-        Texture::Sampler* texture_sampler_ptr = material_ptr->getParameter("u_diffuseTexture")->setValue(diffuse_string_ptr, true);
-        texture_sampler_ptr->setFilterMode(Texture::LINEAR_MIPMAP_LINEAR, Texture::LINEAR_MIPMAP_LINEAR);
-        texture_sampler_ptr->setWrapMode(Texture::REPEAT, Texture::REPEAT);
+        if (cached.sampler)
+        {
+            material_ptr->getParameter("u_diffuseTexture")->setValue(cached.sampler);
+        }
+        material_ptr->setStateBlock(cached.stateBlock);
     }
     else
     {
@@ -302,9 +434,12 @@ void AerialAssist::setMaterial(Node* node_ptr, const char* diffuse_string_ptr, c
     normal_sampler_ptr->setFilterMode(Texture::LINEAR_MIPMAP_LINEAR, Texture::LINEAR_MIPMAP_LINEAR);
     normal_sampler_ptr->setWrapMode(Texture::REPEAT, Texture::REPEAT);
 #endif
-    material_ptr->getStateBlock()->setCullFace(true);
-    material_ptr->getStateBlock()->setDepthTest(true);
-    material_ptr->getStateBlock()->setDepthWrite(true);
+    if (material_set)
+    {
+        material_ptr->getStateBlock()->setCullFace(true);
+        material_ptr->getStateBlock()->setDepthTest(true);
+        material_ptr->getStateBlock()->setDepthWrite(true);
+    }
     material_ptr->getParameter("u_ambientColor")->bindValue(_scene, &Scene::getAmbientColor);
 
     // bind spotlight to material
@@ -338,9 +473,32 @@ void AerialAssist::setMaterial(Node* node_ptr, const char* diffuse_string_ptr, c
 //----------------------------------------------------------------------
 void AerialAssist::finalize()
 {
+    stopCapture();
+    SAFE_DELETE(_loader);
+    if (_decoded)
+    {
+        // Quit while loading, the job is done now
+        SAFE_DELETE(_decoded->robot);
+        SAFE_DELETE(_decoded);
+    }
+    _telemetry.close();
+    _nodeRegistry.clear();
+    _fleet.clear();
+    _ballPool.clear();
     SAFE_RELEASE(_spotlight);
     SAFE_RELEASE(_spotlight_node);
+    _sceneBVH.clear();
+    for (unsigned int i = 0; i < CameraCount; i++)
+    {
+        for (unsigned int j = 0; j < QUEUE_COUNT; ++j)
+        {
+            _renderQueues[i][j].clear();
+            _drawLists[i][j].clear();
+        }
+    }
+    _drawBindings.clear();
     SAFE_RELEASE(_scene);
+    _materialCache.clear();
 }
 
 //----------------------------------------------------------------------
@@ -423,55 +581,41 @@ Mesh* AerialAssist::createFloorMesh(void)
 
 //----------------------------------------------------------------------
 //
-// loadTextureMap()
+// readGamepad()
 //
 //----------------------------------------------------------------------
-void AerialAssist::loadTextureMap(const string &filename)
+void AerialAssist::readGamepad(MatchInput &input) const
 {
-    std::string jsonInput;
-    std::ifstream inFile;
-    inFile.open(filename.c_str(), std::ios_base::in);
-    if (inFile)
+    if (!_gamepad)
     {
-        inFile.seekg(0, std::ios::end);
-        long length = (long)inFile.tellg();
-        jsonInput.resize(length);
-        inFile.seekg(0, std::ios::beg);
-        inFile.read(&jsonInput[0], jsonInput.size());
-        inFile.close();
-        
-        Json::Value root;
-        Json::Reader reader;
-        if ( !reader.parse(jsonInput, root) )
+        return;
+    }
+    input.launchBall = _gamepad->isButtonDown(Gamepad::BUTTON_A);
+    input.fireCatapult = _gamepad->isButtonDown(Gamepad::BUTTON_B);
+    Form *gamepadForm = _gamepad->getForm();
+    bool virtualGamepad = (gamepadForm && gamepadForm->isEnabled());
+    if (!gamepadForm || virtualGamepad)
+    {
+        if (_gamepad->getTriggerCount() > 0)
         {
-#if DEBUG
-            fprintf(stderr, "[ERROR] File \"%s\" not parsed\n", filename.c_str());
-#endif // DEBUG
-            return;
+            input.leftTrigger = _gamepad->getTriggerValue(0);
         }
-        Json::Value textureListArray = root["textureMapList"];
-        if (textureListArray.isArray())
+        if (_gamepad->getTriggerCount() > 1)
         {
-            for (int i = 0; i < textureListArray.size(); i++)
-            {
-                Json::Value node = textureListArray[i];
-                string id = node.get("node", "").asCString();
-                string texture = node.get("texture", "").asCString();
-                bool transparent = node.get("transparent", false).asBool();
+            input.rightTrigger = _gamepad->getTriggerValue(1);
+        }
+        if (_gamepad->getJoystickCount() > 0)
+        {
+            _gamepad->getJoystickValues(0, &input.leftStick);
+        }
+        if (_gamepad->getJoystickCount() > 1)
+        {
+            _gamepad->getJoystickValues(1, &input.rightStick);
+        }
 #ifdef DEBUG
-                fprintf(stderr, "[Debug]\t\tReading texture \"%s\" for node \"%s\" (alpha %s)\n", texture.c_str(), id.c_str(), transparent?"true":"false");
+//        fprintf(stderr, "[Debug] Reading from gamepad 0 with %d joysticks and %d triggers: left (%4.2f, %4.2f), right (%4.2f, %4.2f), left_trig (%4.2f), right_trig (%4.2f)\n", _gamepad->getJoystickCount(), _gamepad->getTriggerCount(), input.leftStick.x, input.leftStick.y, input.rightStick.x, input.rightStick.y, input.leftTrigger, input.rightTrigger);
 #endif // DEBUG
-                GPair<string, bool> pair(texture, transparent);
-                textureList.insert(make_pair(id, pair));
-            }
-        }
-    }
-#if DEBUG
-    else
-    {
-        fprintf(stderr, "[ERROR] File \"%s\" not opened\n", filename.c_str());
     }
-#endif // DEBUG
 }
 
 //----------------------------------------------------------------------
@@ -481,90 +625,265 @@ void AerialAssist::loadTextureMap(const string &filename)
 //----------------------------------------------------------------------
 void AerialAssist::update(float elapsedTime)
 {
+#ifdef FRCSIM_PROFILING
+    // Everything since the last update(): render() and GamePlay's physics step
+    Profiler::getInstance().endFrame();
+#endif // FRCSIM_PROFILING
+    PROFILE_ZONE("update");
+    if (_loading_stage != LOAD_DONE)
+    {
+        continueLoading();
+        return;
+    }
     _elapsedTime += elapsedTime;
-    float throttle = 0.0;
-    float brake = 0.0;
 #ifdef DEBUG
 //    fprintf(stderr, "[Trace] elapsedTime=%8.5f, runtime=%8.5f\n", elapsedTime, _elapsedTime / 1000.0);
 #endif // DEBUG
-    Node* blue_ball = _scene->findNode("GAME_BALL_BLUE_1");
-   
-    if (_gamepad)
+    if (_replaying)
+    {
+        replayMatch(elapsedTime / 1000.0);
+    }
+    else
     {
-        if (_gamepad->isButtonDown(Gamepad::BUTTON_A))
+        MatchInput input;
         {
-            if (blue_ball && !_ball_in_play)
-            {
-                blue_ball->setTranslation(126.0, 0.0, 156.0);
-                blue_ball->setCollisionObject("res/frcsim.physics#ball");
-                PhysicsCollisionObject* ball_physics = blue_ball->getCollisionObject();
-                ball_physics->setEnabled(true);
-                _ball_in_play = true;
-            }
+            PROFILE_ZONE("readGamepad");
+            readGamepad(input);
         }
-        Vector2 left_stick, right_stick;
-        float left_trigger = 0.0, right_trigger = 0.0;
-        Form *gamepadForm = _gamepad->getForm();
-        bool virtualGamepad = (gamepadForm && gamepadForm->isEnabled());
-        if (!gamepadForm || virtualGamepad)
+        
+        // Fixed steps keep the match independent of the frame rate, the
+        // frame draws the mechanism between the last two of them
+        unsigned int steps = _timestep.advance(elapsedTime / 1000.0);
+        for (unsigned int i = 0; i < steps; i++)
         {
-            if (_gamepad->getTriggerCount() > 0)
-            {
-                left_trigger = _gamepad->getTriggerValue(0);
-            }
-            if (_gamepad->getTriggerCount() > 1)
-            {
-                right_trigger = _gamepad->getTriggerValue(1);
-            }
-            if (_gamepad->getJoystickCount() > 0)
-            {
-                _gamepad->getJoystickValues(0, &left_stick);
-            }
-            if (_gamepad->getJoystickCount() > 1)
-            {
-                _gamepad->getJoystickValues(1, &right_stick);
-            }
-            if (!isInDeadband(right_trigger))
-            {
-                throttle = right_trigger;
-            }
-            else if (!isInDeadband(left_trigger))
-            {
-                throttle = -1.0 * left_trigger;
-            }
-#ifdef DEBUG
-//            fprintf(stderr, "[Debug] Reading from gamepad 0 with %d joysticks and %d triggers: left (%4.2f, %4.2f), right (%4.2f, %4.2f), left_trig (%4.2f), right_trig (%4.2f)\n", _gamepad->getJoystickCount(), _gamepad->getTriggerCount(), left_stick.x, left_stick.y, right_stick.x, right_stick.y, left_trigger, right_trigger);
-#endif // DEBUG
+            updateMatch(input, _timestep.getStep());
+        }
+        if (_robot)
+        {
+            _robot->getMechanism().interpolate(_timestep.getAlpha());
         }
     }
     
-    Node* robot_node = NULL;
+    followRobot();
+}
+
+//----------------------------------------------------------------------
+//
+// followRobot()
+//
+//----------------------------------------------------------------------
+void AerialAssist::followRobot()
+{
+    // Keep the overhead camera centered directly above the robot (looking down)
+    Node* cam_node = _nodeRegistry.get(_overhead_handle);
+    if (cam_node && _robot)
+    {
+        Vector3 pos = _robot->getPosition();
+        cam_node->setTranslationX(pos.x);
+        cam_node->setTranslationZ(pos.z);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// updateMatch()
+//
+//----------------------------------------------------------------------
+void AerialAssist::updateMatch(const MatchInput &input, float timestep)
+{
+    // Every press of BUTTON_A puts another ball in play
+    if (input.launchBall && !_launch_held)
+    {
+        _ballPool.spawn(Vector3(126.0, 0.0, 156.0));
+    }
+    _launch_held = input.launchBall;
+    _ballPool.update();
+    float throttle = input.getThrottle(_joystickDeadband);
+    
     if (_robot)
     {
-        _robot->setVelocity(throttle);
-        
-        // Update the robot's position
-        _robot->update(elapsedTime / 1000.0);
+        PROFILE_ZONE("Robot::update");
+        if (_catapult_joint >= 0)
+        {
+            _robot->getMechanism().setEngaged(_catapult_joint, input.fireCatapult);
+        }
         
-        robot_node = _robot->getNode();
-        if (robot_node)
-        {          
-            Node* catapult_node = robot_node->findNode("Catapult");
-            if (catapult_node)
+        // Update the robot's position and mechanism
+        if (_fleet.size() > 0)
+        {
+            _fleet.setVelocity(0, throttle);
+            _fleet.update(timestep);
+        }
+    }
+    _match_tick++;
+    _match_time += timestep;
+    
+    if (_recorder.isOpen() || _telemetry.isOpen())
+    {
+        MatchFrame frame;
+        frame.tick = _match_tick;
+        frame.time = _match_time;
+        frame.timestep = timestep;
+        frame.input = input;
+        if (_robot)
+        {
+            frame.robotPosition = _robot->getPosition();
+            frame.robotYaw = _robot->getYaw();
+            frame.robotVelocity = _robot->getVelocity();
+            frame.robotSetpoint = _robot->getVelocitySetpoint();
+        }
+        // The log and telemetry carry the oldest ball in play
+        int ball = _ballPool.getFirstActive();
+        frame.ballInPlay = (ball >= 0);
+        if (ball >= 0)
+        {
+            frame.ballPosition = _ballPool.getNode(ball)->getTranslationWorld();
+            PhysicsRigidBody* ball_body = _ballPool.getBody(ball);
+            if (ball_body)
             {
-                catapult_node->setRotation(Vector3(1.0f, 0.0f, 0.0f), MATH_DEG_TO_RAD(-90));
+                frame.ballLinearVelocity = ball_body->getLinearVelocity();
+                frame.ballAngularVelocity = ball_body->getAngularVelocity();
             }
         }
+        if (_recorder.isOpen())
+        {
+            _recorder.record(frame);
+        }
+        TelemetrySample sample;
+        sample.set(frame);
+        _telemetry.publish(sample);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// replayMatch()
+//
+//----------------------------------------------------------------------
+void AerialAssist::replayMatch(double elapsedTime)
+{
+    PROFILE_ZONE("replayMatch");
+    // Recorded ticks are replayed with their own length, as many as fit in
+    // the scaled frame time
+    _replay_clock += elapsedTime * kReplaySpeeds[_replay_speed];
+    while (_replay_clock >= _replay_frame.timestep)
+    {
+        _replay_clock -= _replay_frame.timestep;
+        updateMatch(_replay_frame.input, _replay_frame.timestep);
+        if (!_player.next(_replay_frame))
+        {
+            stopReplay();
+            return;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// replayTo()
+//
+//----------------------------------------------------------------------
+bool AerialAssist::replayTo(double time)
+{
+    PROFILE_ZONE("replayTo");
+    if (!_replaying)
+    {
+        return false;
+    }
+    // Ticks are posed, not simulated, so the match time only depends on
+    // the log and the caller's clock; the tolerance absorbs rounding in
+    // the recorded sums of float ticks
+    while (_replay_frame.time <= time + 1.0e-6)
+    {
+        poseTick(_replay_frame);
+        if (!_player.next(_replay_frame))
+        {
+            stopReplay();
+            followRobot();
+            return false;
+        }
+    }
+    if (_robot)
+    {
+        _robot->getMechanism().interpolate(1.0f);
+    }
+    followRobot();
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// poseTick()
+//
+//----------------------------------------------------------------------
+void AerialAssist::poseTick(const MatchFrame &frame)
+{
+    _match_tick = frame.tick;
+    _match_time = frame.time;
+    _launch_held = frame.input.launchBall;
+    if (_robot)
+    {
+        if (_catapult_joint >= 0)
+        {
+            _robot->getMechanism().setEngaged(_catapult_joint, frame.input.fireCatapult);
+        }
+        _robot->getMechanism().update(frame.timestep);
+        _robot->setPosition(frame.robotPosition);
+        _robot->setYaw(frame.robotYaw);
+        _robot->setVelocityState(frame.robotVelocity, frame.robotSetpoint);
+        Node* robot_node = _robot->getNode();
+        if (robot_node)
+        {
+            robot_node->setTranslation(frame.robotPosition);
+        }
     }
     
-    // Keep the overhead camera centered directly above the robot (looking down)
-    Node* cam_node = _scene->findNode("Overhead");
-    if (cam_node && _robot)
+    // The log carries one ball, the oldest in play
+    if (!frame.ballInPlay)
     {
-        Vector3 pos = _robot->getPosition();
-        cam_node->setTranslationX(pos.x);
-        cam_node->setTranslationZ(pos.z);
+        _ballPool.despawnAll();
+        return;
+    }
+    int ball = _ballPool.getFirstActive();
+    if (ball < 0)
+    {
+        ball = _ballPool.spawn(frame.ballPosition);
+    }
+    if (ball >= 0)
+    {
+        _ballPool.getNode(ball)->setTranslation(frame.ballPosition);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// startReplay()
+//
+//----------------------------------------------------------------------
+void AerialAssist::startReplay(const char* path)
+{
+    _recorder.close();
+    if (!_player.open(path) || !_player.next(_replay_frame))
+    {
+        return;
     }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Replaying %lu ticks (%.1f sec) at %gx\n", _player.getFrameCount(), _player.getDuration(), kReplaySpeeds[_replay_speed]);
+#endif // DEBUG
+    _replay_clock = 0.0;
+    _replaying = true;
+}
+
+//----------------------------------------------------------------------
+//
+// stopReplay()
+//
+//----------------------------------------------------------------------
+void AerialAssist::stopReplay()
+{
+    _replaying = false;
+    _player.rewind();
+    _timestep.reset();
 }
 
 //----------------------------------------------------------------------
@@ -574,12 +893,34 @@ void AerialAssist::update(float elapsedTime)
 //----------------------------------------------------------------------
 void AerialAssist::render(float elapsedTime)
 {
+    PROFILE_ZONE("render");
+    if (_loading_stage != LOAD_DONE)
+    {
+        drawLoadingProgress();
+        return;
+    }
+    _state_changes = 0;
+    if (_capture.isOpen())
+    {
+        drawCapture();
+        if (_capture_only)
+        {
+            return;
+        }
+    }
     Rectangle default_viewport = getViewport();
+    
+    // One visibility pass for every view drawn this frame
+    CameraPosition views[] = { _active_camera, _hud_camera };
+    cullScene(views, 2);
+    buildDrawLists(views, 2);
+    
     drawScreen(_active_camera);
     
     // Draw physics debug
     if (_physicsDebug)
     {
+        PROFILE_ZONE("drawDebug");
         getPhysicsController()->drawDebug(_scene->getActiveCamera()->getViewProjectionMatrix());
     }
     
@@ -592,7 +933,13 @@ void AerialAssist::render(float elapsedTime)
     glDisable(GL_SCISSOR_TEST);
     
     // draw the frame rate
-    drawFrameRate(_font, Vector4::one(), 5, 1, getFrameRate());
+    drawFrameRate(_font, Vector4::one(), 5, 1, getFrameRate(), _state_changes);
+#ifdef FRCSIM_PROFILING
+    if (_profiler_overlay)
+    {
+        drawProfiler();
+    }
+#endif // FRCSIM_PROFILING
     
     // draw virtual gamepad
     if (_gamepad)
@@ -601,6 +948,96 @@ void AerialAssist::render(float elapsedTime)
     }
 }
 
+//----------------------------------------------------------------------
+//
+// cullScene()
+//
+//----------------------------------------------------------------------
+void AerialAssist::cullScene(const CameraPosition *cameras, unsigned int count)
+{
+    PROFILE_ZONE("cullScene");
+    SceneBVH::View views[CameraCount];
+    unsigned int view_count = 0;
+    bool culled[CameraCount] = { false };
+    for (unsigned int i = 0; i < count; i++)
+    {
+        CameraPosition camera = cameras[i];
+        if (culled[camera])
+        {
+            continue;
+        }
+        culled[camera] = true;
+        for (unsigned int j = 0; j < QUEUE_COUNT; ++j)
+        {
+            _renderQueues[camera][j].clear();
+        }
+        views[view_count++] = SceneBVH::View(&_camera[camera]->getFrustum(), &_renderQueues[camera][QUEUE_OPAQUE], &_renderQueues[camera][QUEUE_TRANSPARENT]);
+    }
+    
+    if (_sceneBVH.isBuilt())
+    {
+        // Each node is tested once against all the frusta
+        _sceneBVH.cull(views, view_count, _view_frustrum_culling);
+    }
+    else
+    {
+        // Visit all the nodes in the scene once per camera
+        for (unsigned int i = 0; i < CameraCount; i++)
+        {
+            if (culled[i])
+            {
+                _culling_camera = (CameraPosition)i;
+                _scene->visit(this, &AerialAssist::buildRenderQueues);
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// buildDrawLists()
+//
+//----------------------------------------------------------------------
+void AerialAssist::buildDrawLists(const CameraPosition *cameras, unsigned int count)
+{
+    PROFILE_ZONE("buildDrawLists");
+    
+    // Cameras are read here, the jobs only read nodes culling brought up to date
+    DrawList::View views[CameraCount];
+    unsigned int lists[CameraCount * QUEUE_COUNT];
+    unsigned int list_count = 0;
+    bool built[CameraCount] = { false };
+    for (unsigned int i = 0; i < count; i++)
+    {
+        CameraPosition camera = cameras[i];
+        if (built[camera])
+        {
+            continue;
+        }
+        built[camera] = true;
+        views[camera].set(_camera[camera], _spotlight_node);
+        for (unsigned int j = 0; j < QUEUE_COUNT; ++j)
+        {
+            lists[list_count++] = camera * QUEUE_COUNT + j;
+        }
+    }
+    
+    // One job per queue, each splits its draws further
+    JobSystem::getInstance().parallelFor(0, list_count, 1, [this, &views, &lists](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            unsigned int camera = lists[i] / QUEUE_COUNT;
+            unsigned int queue = lists[i] % QUEUE_COUNT;
+            {
+                PROFILE_ZONE("RenderQueue::sort");
+                _renderQueues[camera][queue].sort(views[camera].eye, views[camera].forward, queue == QUEUE_TRANSPARENT);
+            }
+            _drawLists[camera][queue].build(_renderQueues[camera][queue], _drawBindings, views[camera]);
+        }
+    });
+}
+
 //----------------------------------------------------------------------
 //
 // drawScreen()
@@ -613,26 +1050,122 @@ void AerialAssist::drawScreen(CameraPosition camera)
     
     _scene->setActiveCamera(_camera[camera]);
     
-    // Visit all the nodes in the scene to build our render queues, we have to
-    // do this for every camera so buildRenderQueues() can do frustrum culling
+    // Opaque nodes are grouped by program and texture, transparent nodes
+    // are drawn back to front
+    unsigned int state = 0;
     for (unsigned int i = 0; i < QUEUE_COUNT; ++i)
     {
-        _renderQueues[i].clear();
+#ifdef DEBUG
+//        fprintf(stderr, "[Debug] Rendering %s queue with %lu nodes for camera %s\n", i==0?"opaque":"transparent", _drawLists[camera][i].size(), (camera==Overhead?"overhead":(camera==Chase?"chase":"driver")));
+#endif // DEBUG
+        PROFILE_ZONE("DrawList::draw");
+        _state_changes += _drawLists[camera][i].draw(_wireframe, state);
     }
-    _scene->visit(this, &AerialAssist::buildRenderQueues);
+}
+
+//----------------------------------------------------------------------
+//
+// drawCapture()
+//
+//----------------------------------------------------------------------
+void AerialAssist::drawCapture()
+{
+    PROFILE_ZONE("drawCapture");
     
-    // Iterate through each render queue and draw its nodes
-    for (unsigned int i = 0; i < QUEUE_COUNT; ++i)
+    // The capture's own aspect ratio for culling and drawing, the window's
+    // views are culled again afterwards
+    Camera* camera = _camera[_capture_camera];
+    float aspect_ratio = camera->getAspectRatio();
+    camera->setAspectRatio((float)_capture.getWidth() / (float)_capture.getHeight());
+    cullScene(&_capture_camera, 1);
+    buildDrawLists(&_capture_camera, 1);
+    
+    Rectangle default_viewport = getViewport();
+    _capture.begin();
+    setViewport(Rectangle(_capture.getWidth(), _capture.getHeight()));
+    drawScreen(_capture_camera);
+    _capture.end();
+    setViewport(default_viewport);
+    camera->setAspectRatio(aspect_ratio);
+}
+
+//----------------------------------------------------------------------
+//
+// startCapture()
+//
+//----------------------------------------------------------------------
+bool AerialAssist::startCapture(CameraPosition camera, unsigned int width, unsigned int height, const char* path, FrameCapture::Format format, bool offscreenOnly)
+{
+    stopCapture();
+    if (camera >= CameraCount || !_capture.open(width, height, path, format))
     {
-        std::vector<Node*>& queue = _renderQueues[i];
-#ifdef DEBUG
-//        fprintf(stderr, "[Debug] Rendering %s queue with %lu nodes for camera %s\n", i==0?"opaque":"transparent", queue.size(), (camera==Overhead?"overhead":(camera==Chase?"chase":"driver")));
-#endif // DEBUG
-        for (size_t j = 0, ncount = queue.size(); j < ncount; ++j)
+        return false;
+    }
+    _capture_camera = camera;
+    _capture_only = offscreenOnly;
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// stopCapture()
+//
+//----------------------------------------------------------------------
+void AerialAssist::stopCapture()
+{
+    _capture.close();
+    _capture_only = false;
+}
+
+//----------------------------------------------------------------------
+//
+// drawLoadingProgress()
+//
+//----------------------------------------------------------------------
+void AerialAssist::drawLoadingProgress()
+{
+    clear(CLEAR_COLOR_DEPTH, Vector4(0.0, 0.0, 0.0, 1.0), 1.0f, 0);
+    char buffer[32];
+    if (_loading_stage <= LOAD_TEXTURES)
+    {
+        sprintf(buffer, "Loading %d%%", (int)(_loader->getProgress() * 100.0f));
+    }
+    else
+    {
+        sprintf(buffer, "Building scene");
+    }
+    _font->start();
+    _font->drawText(buffer, 5, getHeight() - _font->getSize() - 5, Vector4::one(), _font->getSize());
+    _font->finish();
+}
+
+//----------------------------------------------------------------------
+//
+// drawProfiler()
+//
+//----------------------------------------------------------------------
+void AerialAssist::drawProfiler()
+{
+    const vector<Profiler::ZoneTime>& zones = Profiler::getInstance().getFrameZones();
+    unsigned int size = _font->getSize();
+    unsigned int y = 1 + 3 * size;
+    char buffer[96];
+    _font->start();
+    for (size_t i = 0; i < zones.size(); i++)
+    {
+        sprintf(buffer, "%*s%s %6.3f ms", (int)(2 * zones[i].depth), "", zones[i].name, zones[i].milliseconds);
+        if (zones[i].count > 1)
         {
-            queue[j]->getModel()->draw(_wireframe);
+            sprintf(buffer + strlen(buffer), " (%u)", zones[i].count);
         }
+        _font->drawText(buffer, 5, y, Vector4::one(), size);
+        y += size;
     }
+    if (Profiler::getInstance().isCapturing())
+    {
+        _font->drawText("Capturing trace", 5, y, Vector4(1.0f, 0.0f, 0.0f, 1.0f), size);
+    }
+    _font->finish();
 }
 
 //----------------------------------------------------------------------
@@ -640,12 +1173,14 @@ void AerialAssist::drawScreen(CameraPosition camera)
 // drawFrameRate()
 //
 //----------------------------------------------------------------------
-void AerialAssist::drawFrameRate(Font* font, const Vector4& color, unsigned int x, unsigned int y, unsigned int fps)
+void AerialAssist::drawFrameRate(Font* font, const Vector4& color, unsigned int x, unsigned int y, unsigned int fps, unsigned int stateChanges)
 {
     char buffer[10];
     sprintf(buffer, "%u", fps);
     font->start();
     font->drawText(buffer, x, y, color, font->getSize());
+    sprintf(buffer, "%u", stateChanges);
+    font->drawText(buffer, x, y + font->getSize(), color, font->getSize());
     font->finish();
 }
 
@@ -660,19 +1195,19 @@ bool AerialAssist::buildRenderQueues(Node* node)
     if (model)
     {
         // Perform view-frustum culling for this node
-        if (_view_frustrum_culling && node->getBoundingSphere().intersects(_scene->getActiveCamera()->getFrustum()))
+        if (_view_frustrum_culling && node->getBoundingSphere().intersects(_camera[_culling_camera]->getFrustum()))
         {
             // Determine which render queue to insert the node into
-            std::vector<Node*>* queue;
+            RenderQueue* queue;
             if (node->hasTag("transparent"))
             {
-                queue = &_renderQueues[QUEUE_TRANSPARENT];
+                queue = &_renderQueues[_culling_camera][QUEUE_TRANSPARENT];
             }
             else
             {
-                queue = &_renderQueues[QUEUE_OPAQUE];
+                queue = &_renderQueues[_culling_camera][QUEUE_OPAQUE];
             }
-            queue->push_back(node);
+            queue->push(node, getDrawState(node));
         }
     }
     return true;
@@ -680,50 +1215,198 @@ bool AerialAssist::buildRenderQueues(Node* node)
 
 //----------------------------------------------------------------------
 //
-// setSceneMaterial()
+// batchStaticNodes()
 //
 //----------------------------------------------------------------------
-bool AerialAssist::setSceneMaterial(Node* node)
+void AerialAssist::batchStaticNodes(void)
 {
-    // If the node visited contains a model, draw it
-    string id = node->getId();    
-#ifdef DEBUG
-    fprintf(stderr, "[Debug]\tSetting material for node \"%s\"\n", id.c_str());
-#endif // DEBUG
-    Model* model = node->getModel();
-    if (model)
+    _staticBatcher.clear();
+    _scene->visit(this, &AerialAssist::collectBatchCandidates);
+    vector<Node*> batches;
+    vector<unsigned int> materials;
+    _staticBatcher.build(_scene, batches, materials);
+    _staticBatcher.clear();
+    for (size_t i = 0; i < batches.size(); i++)
     {
-        string texture = "res/textures/gray.png";
-        bool transparent = false;
-        map<string, GPair<string, bool> >::const_iterator it;
-        for (it = textureList.begin(); it != textureList.end(); it++)
+        const MaterialCache::Key* key = _materialCache.getKey(materials[i]);
+        if (key)
         {
-            GString regex = it->first.c_str();
-            if (RegExp(id.c_str(), regex))
-            {
-                texture = it->second.first;
-                transparent = it->second.second;
-#ifdef DEBUG
-                fprintf(stderr, "[Debug]\t\tRegEx match for \"%s\" on \"%s\"\n", (const char*)regex, id.c_str());
-#endif // DEBUG
-                break;
-            }
+            setMaterial(batches[i], key->texture.c_str(), NULL, key->specularity);
         }
-#ifdef DEBUG
-//        fprintf(stderr, "[Debug]\tSetting %smaterial for node \"%s\" to \"%s\"\n", (transparent?"transparent ":""), id.c_str(), texture.c_str());
-#endif // DEBUG
-        if (transparent)
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// collectBatchCandidates()
+//
+//----------------------------------------------------------------------
+bool AerialAssist::collectBatchCandidates(Node* node)
+{
+    unsigned int material = _materialCache.getNodeEntry(node);
+    if (node->getModel() && material != MaterialCache::kNoEntry && !node->hasTag("transparent") && !isDynamicNode(node))
+    {
+        _staticBatcher.add(node, material);
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// buildSceneBVH()
+//
+//----------------------------------------------------------------------
+void AerialAssist::buildSceneBVH(void)
+{
+    _staticItems.clear();
+    _dynamicItems.clear();
+    _drawBindings.clear();
+    _scene->visit(this, &AerialAssist::collectCullingItems);
+    _sceneBVH.build(_staticItems, _dynamicItems);
+    _staticItems.clear();
+    _dynamicItems.clear();
+}
+
+//----------------------------------------------------------------------
+//
+// collectCullingItems()
+//
+//----------------------------------------------------------------------
+bool AerialAssist::collectCullingItems(Node* node)
+{
+    if (node->getModel())
+    {
+        // Materials are final, draw lists set the node's matrices from now on
+        unsigned int binding = RenderQueue::kNoBinding;
+        DrawList::Binding parameters;
+        if (DrawList::bind(node, parameters))
         {
-            node->setTag("transparent", "true");
+            binding = (unsigned int)_drawBindings.size();
+            _drawBindings.push_back(parameters);
         }
-        if (texture != "")
+        SceneBVH::Item item(node, node->getBoundingSphere(), node->hasTag("transparent"), getDrawState(node), binding);
+        if (isDynamicNode(node))
         {
-            setMaterial(node, texture.c_str(), NULL, 0.0);
+            _dynamicItems.push_back(item);
         }
+        else
+        {
+            _staticItems.push_back(item);
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// isDynamicNode()
+//
+//----------------------------------------------------------------------
+bool AerialAssist::isDynamicNode(Node* node) const
+{
+    Node* robot_node = _robot ? _robot->getNode() : NULL;
+    for (Node* n = node; n; n = n->getParent())
+    {
+        if (n == robot_node)
+        {
+            return true;
+        }
+        const char* id = n->getId();
+        if (id && strncmp(id, "GAME_BALL", 9) == 0)
+        {
+            return true;
+        }
+        PhysicsCollisionObject* physics = n->getCollisionObject();
+        if (physics && !physics->isStatic())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+//
+// getDrawState()
+//
+//----------------------------------------------------------------------
+unsigned int AerialAssist::getDrawState(Node* node) const
+{
+    unsigned int program = 0;
+    Material* material = node->getModel() ? node->getModel()->getMaterial() : NULL;
+    if (material && material->getTechnique() && material->getTechnique()->getPassCount() > 0)
+    {
+        program = material->getTechnique()->getPassByIndex(0)->getEffect()->getProgram();
+    }
+    unsigned int entry = _materialCache.getNodeEntry(node);
+    return RenderQueue::makeState(program, (entry != MaterialCache::kNoEntry) ? entry : 0);
+}
+
+//----------------------------------------------------------------------
+//
+// setSceneMaterials()
+//
+//----------------------------------------------------------------------
+void AerialAssist::setSceneMaterials(void)
+{
+    PROFILE_ZONE("setSceneMaterials");
+    _materialNodes.clear();
+    _scene->visit(this, &AerialAssist::collectMaterialNodes);
+    
+    // Serial: Ghoul's RegExp() is not documented as thread-safe and the
+    // compiled automaton leaves few rules to run it on
+    _textureMap.compile();
+    for (size_t i = 0; i < _materialNodes.size(); i++)
+    {
+        setSceneMaterial(_materialNodes[i], _textureMap.match(_materialNodes[i]->getId()));
+    }
+    _materialNodes.clear();
+}
+
+//----------------------------------------------------------------------
+//
+// collectMaterialNodes()
+//
+//----------------------------------------------------------------------
+bool AerialAssist::collectMaterialNodes(Node* node)
+{
+    if (node->getModel())
+    {
+        _materialNodes.push_back(node);
     }
     return true;
 }
 
+//----------------------------------------------------------------------
+//
+// setSceneMaterial()
+//
+//----------------------------------------------------------------------
+void AerialAssist::setSceneMaterial(Node* node, const TextureMap::Entry* entry)
+{
+#ifdef DEBUG
+    fprintf(stderr, "[Debug]\tSetting material for node \"%s\"\n", node->getId());
+#endif // DEBUG
+    string texture = "res/textures/gray.png";
+    bool transparent = false;
+    if (entry)
+    {
+        texture = entry->texture;
+        transparent = entry->transparent;
+    }
+#ifdef DEBUG
+//    fprintf(stderr, "[Debug]\tSetting %smaterial for node \"%s\" to \"%s\"\n", (transparent?"transparent ":""), node->getId(), texture.c_str());
+#endif // DEBUG
+    if (transparent)
+    {
+        node->setTag("transparent", "true");
+    }
+    if (texture != "")
+    {
+        setMaterial(node, texture.c_str(), NULL, 0.0);
+    }
+}
+
 //----------------------------------------------------------------------
 //
 // keyEvent()
@@ -738,6 +1421,50 @@ void AerialAssist::keyEvent(Keyboard::KeyEvent evt, int key)
         case Keyboard::KEY_ESCAPE:
             exit();
             break;
+        case Keyboard::KEY_F5:
+            if (_recorder.isOpen())
+            {
+                _recorder.close();
+            }
+            else if (!_replaying)
+            {
+                _recorder.open(kMatchLogFile);
+            }
+            break;
+        case Keyboard::KEY_F6:
+            if (_replaying)
+            {
+                stopReplay();
+            }
+            else
+            {
+                startReplay();
+            }
+            break;
+        case Keyboard::KEY_F7:
+            _replay_speed = (_replay_speed + 1) % (sizeof(kReplaySpeeds) / sizeof(kReplaySpeeds[0]));
+            break;
+        case Keyboard::KEY_F8:
+            if (_capture.isOpen())
+            {
+                stopCapture();
+            }
+            else
+            {
+                startCapture(_active_camera, getWidth(), getHeight(), kCaptureFile, FrameCapture::RAW);
+            }
+            break;
+#ifdef FRCSIM_PROFILING
+        case Keyboard::KEY_F2:
+            _profiler_overlay = !_profiler_overlay;
+            break;
+        case Keyboard::KEY_F3:
+            if (!Profiler::getInstance().isCapturing())
+            {
+                Profiler::getInstance().startCapture(120, "frcsim-trace.json");
+            }
+            break;
+#endif // FRCSIM_PROFILING
         }
     }
 }
@@ -0,0 +1,115 @@
+//
+//  FrcSimBatch.cpp
+//  FrcSim
+//
+//  Runs a parameter sweep of headless matches across all cores.  Link with
+//  the game sources (FrcSim.cpp, Robot.cpp, SimulationWorld.cpp,
+//  ThreadPool.cpp, BatchRunner.cpp) in place of gameplay-main-<platform>.cpp.
+//
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Robot.h"
+#include "MatchInput.h"
+#include "FrcSim.h"
+#include "SimulationWorld.h"
+#include "BatchRunner.h"
+
+//----------------------------------------------------------------------
+//
+// usage()
+//
+//----------------------------------------------------------------------
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s --sweep <file> [options]\n", program);
+    fprintf(stderr, "  --resources <path>   resource directory containing res/ (default .)\n");
+    fprintf(stderr, "  --threads <n>        worker threads (default one per core)\n");
+    fprintf(stderr, "  --output <file>      results CSV (default results.csv)\n");
+}
+
+//----------------------------------------------------------------------
+//
+// main()
+//
+//----------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const char* resources = "./";
+    const char* sweep = NULL;
+    const char* output = "results.csv";
+    unsigned int threads = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--resources") == 0 && has_value)
+        {
+            resources = argv[++i];
+        }
+        else if (strcmp(argv[i], "--sweep") == 0 && has_value)
+        {
+            sweep = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && has_value)
+        {
+            threads = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+        {
+            output = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!sweep)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FileSystem::setResourcePath(resources);
+    SimulationWorld::Parameters parameters;
+    if (!parameters.load(AerialAssist::_kSceneFile, "res/frcsim.physics"))
+    {
+        fprintf(stderr, "[ERROR] Physics parameters not loaded, using defaults\n");
+    }
+
+    BatchRunner runner(parameters);
+    if (!runner.loadSweep(sweep))
+    {
+        return 1;
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (!runner.run(threads, output))
+    {
+        return 1;
+    }
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("runs=%lu wall=%.3f results=%s\n", (unsigned long)runner.getRunCount(), wall, output);
+    return 0;
+}
@@ -0,0 +1,489 @@
+//
+//  FrcSimBench.cpp
+//  FrcSim
+//
+//  Times the simulator's hot paths on synthetic data and prints one JSON
+//  object per benchmark.  Link with the game sources (everything in src/
+//  except the platform's gameplay-main-*.cpp and the other main() files).
+//
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Robot.h"
+#include "RobotFleet.h"
+#include "TextureMap.h"
+#include "RenderQueue.h"
+#include "SceneBVH.h"
+#include "MatchInput.h"
+#include "FrcSim.h"
+#include "SimulationWorld.h"
+
+/**
+ * Sizes of the synthetic data and the number of timed repetitions.
+ */
+struct BenchOptions
+{
+    BenchOptions() : nodes(10000), rules(200), robots(64), steps(1000), repeat(20), timestep(0.005f) {}
+
+    unsigned int nodes;            /**< N, node IDs matched and spheres culled        */
+
+    unsigned int rules;            /**< M, texture map rules                          */
+
+    unsigned int robots;           /**< K, robots stepped                             */
+
+    unsigned int steps;            /**< Robot updates per repetition                  */
+
+    unsigned int repeat;           /**< Timed repetitions of each benchmark           */
+
+    float timestep;
+
+    string work;                   /**< Directory for the generated texture map       */
+};
+
+//----------------------------------------------------------------------
+//
+// usage()
+//
+//----------------------------------------------------------------------
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [options]\n", program);
+    fprintf(stderr, "  --resources <path>   resource directory containing res/ (default .)\n");
+    fprintf(stderr, "  --config <file>      robot configuration (default /res/data/AerialAssist2028.json)\n");
+    fprintf(stderr, "  --nodes <n>          synthetic scene nodes (default 10000)\n");
+    fprintf(stderr, "  --rules <m>          synthetic texture map rules (default 200)\n");
+    fprintf(stderr, "  --robots <k>         robots stepped (default 64)\n");
+    fprintf(stderr, "  --steps <n>          robot updates per repetition (default 1000)\n");
+    fprintf(stderr, "  --repeat <n>         timed repetitions of each benchmark (default 20)\n");
+    fprintf(stderr, "  --work <path>        directory for generated files (default /tmp)\n");
+    fprintf(stderr, "  --filter <name>      only run benchmarks whose name contains this\n");
+}
+
+//----------------------------------------------------------------------
+//
+// report()
+//
+// Runs a benchmark once untimed, then `repeat` times, and prints its
+// statistics as one line of JSON.
+//
+//----------------------------------------------------------------------
+static void report(const char* name, const BenchOptions &options, unsigned long items, const function<void()> &body)
+{
+    body();
+    vector<double> times;
+    for (unsigned int i = 0; i < options.repeat; i++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        body();
+        times.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    sort(times.begin(), times.end());
+    double total = 0.0;
+    for (size_t i = 0; i < times.size(); i++)
+    {
+        total += times[i];
+    }
+    double mean = times.empty() ? 0.0 : total / times.size();
+    double median = times.empty() ? 0.0 : times[times.size() / 2];
+    printf("{\"bench\":\"%s\",\"nodes\":%u,\"rules\":%u,\"robots\":%u,\"items\":%lu,\"repeat\":%u,"
+           "\"min_ms\":%.6f,\"median_ms\":%.6f,\"mean_ms\":%.6f,\"max_ms\":%.6f,\"ns_per_item\":%.3f}\n",
+           name, options.nodes, options.rules, options.robots, items, options.repeat,
+           times.empty() ? 0.0 : times.front(), median, mean, times.empty() ? 0.0 : times.back(),
+           items ? median * 1000000.0 / items : 0.0);
+    fflush(stdout);
+}
+
+//----------------------------------------------------------------------
+//
+// writeTextureMap()
+//
+// Writes M rules in the form of the field's texture map: most are a literal
+// prefix and a wildcard, some use a character class.
+//
+//----------------------------------------------------------------------
+static bool writeTextureMap(const string &filename, unsigned int rules)
+{
+    Json::Value list(Json::arrayValue);
+    char pattern[64];
+    for (unsigned int i = 0; i < rules; i++)
+    {
+        if (i % 4 == 3)
+        {
+            sprintf(pattern, "PART_%04u_[0-4]", i);
+        }
+        else
+        {
+            sprintf(pattern, "PART_%04u_.*", i);
+        }
+        Json::Value rule;
+        rule["node"] = pattern;
+        rule["texture"] = (i % 2) ? "res/textures/white.png" : "res/textures/black.png";
+        if (i % 8 == 0)
+        {
+            rule["transparent"] = true;
+        }
+        list.append(rule);
+    }
+    Json::Value root;
+    root["textureMapList"] = list;
+    ofstream out(filename.c_str());
+    if (!out)
+    {
+        return false;
+    }
+    out << root;
+    return out.good();
+}
+
+//----------------------------------------------------------------------
+//
+// benchTextureMap()
+//
+//----------------------------------------------------------------------
+static void benchTextureMap(const BenchOptions &options, const string &filter)
+{
+    string filename = options.work + "/frcsim-bench-texturemap.json";
+    string cooked = filename + ".cooked";
+    if (!writeTextureMap(filename, options.rules))
+    {
+        fprintf(stderr, "[ERROR] File \"%s\" not written\n", filename.c_str());
+        return;
+    }
+
+    if (string("texture_map_parse").find(filter) != string::npos)
+    {
+        report("texture_map_parse", options, options.rules, [&]()
+        {
+            // Without the cooked copy load() parses the JSON and cooks it
+            remove(cooked.c_str());
+            TextureMap map;
+            map.load(filename);
+        });
+    }
+    if (string("texture_map_cooked").find(filter) != string::npos)
+    {
+        TextureMap warm;
+        warm.load(filename);
+        report("texture_map_cooked", options, options.rules, [&]()
+        {
+            TextureMap map;
+            map.load(filename);
+        });
+    }
+
+    if (string("texture_map_match").find(filter) != string::npos)
+    {
+        TextureMap map;
+        map.load(filename);
+        map.compile();
+        // One ID in eight matches no rule and is checked against all of them
+        vector<string> ids;
+        char id[64];
+        for (unsigned int i = 0; i < options.nodes; i++)
+        {
+            sprintf(id, (i % 8 == 7) ? "UNMAPPED_%u_%u" : "PART_%04u_%u", i % max(options.rules, 1u), i % 5);
+            ids.push_back(id);
+        }
+        const TextureMap &matcher = map;
+        unsigned long matched = 0;
+        report("texture_map_match", options, ids.size(), [&]()
+        {
+            for (size_t i = 0; i < ids.size(); i++)
+            {
+                matched += matcher.match(ids[i].c_str()) ? 1 : 0;
+            }
+        });
+#ifdef DEBUG
+        fprintf(stderr, "[Debug] %lu matches\n", matched);
+#endif // DEBUG
+    }
+    remove(cooked.c_str());
+    remove(filename.c_str());
+}
+
+//----------------------------------------------------------------------
+//
+// benchCulling()
+//
+// Culls N spheres scattered over a field-sized area from a camera at the
+// driver station, as cullScene() does for the static nodes.
+//
+//----------------------------------------------------------------------
+static void benchCulling(const BenchOptions &options, const string &filter)
+{
+    // Fixed seed so every run culls the same scene
+    unsigned int seed = 12345;
+    vector<SceneBVH::Item> items;
+    for (unsigned int i = 0; i < options.nodes; i++)
+    {
+        float v[4];
+        for (int c = 0; c < 4; c++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            v[c] = (seed >> 8) / 16777216.0f;
+        }
+        BoundingSphere bounds(Vector3(v[0] * 16.0f - 8.0f, v[1] * 3.0f, v[2] * 25.0f - 12.5f), 0.05f + v[3] * 0.5f);
+        items.push_back(SceneBVH::Item(NULL, bounds, (i % 16) == 0, RenderQueue::makeState(i % 7, i % 31)));
+    }
+    vector<SceneBVH::Item> dynamic;
+
+    Matrix projection;
+    Matrix view;
+    Matrix::createPerspective(45.0f, 16.0f / 9.0f, 0.1f, 100.0f, &projection);
+    Matrix::createLookAt(Vector3(0.0f, 2.0f, -14.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3::unitY(), &view);
+    Frustum frustum(projection * view);
+
+    RenderQueue opaque;
+    RenderQueue transparent;
+    if (string("bvh_build").find(filter) != string::npos)
+    {
+        report("bvh_build", options, items.size(), [&]()
+        {
+            SceneBVH bvh;
+            bvh.build(items, dynamic);
+        });
+    }
+    SceneBVH bvh;
+    bvh.build(items, dynamic);
+    if (string("bvh_cull").find(filter) != string::npos)
+    {
+        report("bvh_cull", options, items.size(), [&]()
+        {
+            opaque.clear();
+            transparent.clear();
+            bvh.cull(frustum, true, opaque, transparent);
+        });
+    }
+    if (string("linear_cull").find(filter) != string::npos)
+    {
+        // What buildRenderQueues() did: test every node
+        report("linear_cull", options, items.size(), [&]()
+        {
+            opaque.clear();
+            transparent.clear();
+            for (size_t i = 0; i < items.size(); i++)
+            {
+                if (items[i].bounds.intersects(frustum))
+                {
+                    (items[i].transparent ? transparent : opaque).push(items[i].node, items[i].state);
+                }
+            }
+        });
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] %lu of %lu spheres visible\n", (unsigned long)(opaque.size() + transparent.size()), (unsigned long)items.size());
+#endif // DEBUG
+}
+
+//----------------------------------------------------------------------
+//
+// benchRobots()
+//
+// Steps K headless robots one at a time and as a RobotFleet, flipping the
+// throttle every 200 steps so the velocity ramps both ways.
+//
+//----------------------------------------------------------------------
+static void benchRobots(const BenchOptions &options, const string &filter, const char* config)
+{
+    if (string("robot_update").find(filter) == string::npos && string("robot_fleet_update").find(filter) == string::npos)
+    {
+        return;
+    }
+    Robot prototype(config, false);
+    vector<Robot*> robots;
+    for (unsigned int i = 0; i < options.robots; i++)
+    {
+        robots.push_back(new Robot(prototype));
+        robots.back()->setYaw((float)(i * 7 % 360));
+    }
+    if (string("robot_update").find(filter) != string::npos)
+    {
+        report("robot_update", options, (unsigned long)options.robots * options.steps, [&]()
+        {
+            for (unsigned int step = 0; step < options.steps; step++)
+            {
+                float throttle = ((step / 200) % 2) ? -1.0f : 1.0f;
+                for (size_t i = 0; i < robots.size(); i++)
+                {
+                    if (step % 200 == 0)
+                    {
+                        robots[i]->setVelocity(throttle);
+                    }
+                    robots[i]->update(options.timestep);
+                }
+            }
+        });
+    }
+    if (string("robot_fleet_update").find(filter) != string::npos)
+    {
+        RobotFleet fleet;
+        for (size_t i = 0; i < robots.size(); i++)
+        {
+            fleet.add(robots[i]);
+        }
+        report("robot_fleet_update", options, (unsigned long)options.robots * options.steps, [&]()
+        {
+            for (unsigned int step = 0; step < options.steps; step++)
+            {
+                if (step % 200 == 0)
+                {
+                    float throttle = ((step / 200) % 2) ? -1.0f : 1.0f;
+                    for (unsigned int i = 0; i < fleet.size(); i++)
+                    {
+                        fleet.setVelocity(i, throttle);
+                    }
+                }
+                fleet.update(options.timestep);
+            }
+        });
+    }
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        SAFE_DELETE(robots[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// benchSnapshots()
+//
+// Captures and restores a world with the ball in play 1000 times per
+// repetition, the cost of forking a branch.
+//
+//----------------------------------------------------------------------
+static void benchSnapshots(const BenchOptions &options, const string &filter, const char* config)
+{
+    if (string("world_capture").find(filter) == string::npos && string("world_restore").find(filter) == string::npos)
+    {
+        return;
+    }
+    SimulationWorld::Parameters parameters;
+    SimulationWorld world(parameters, new Robot(config, false));
+    MatchInput input;
+    input.rightTrigger = 0.5f;
+    input.launchBall = true;
+    world.setInput(input);
+    world.run(1.0, options.timestep);
+
+    const unsigned int count = 1000;
+    Snapshot snapshot;
+    snapshot.reserve(world.getSnapshotSize());
+    world.capture(snapshot);
+    if (string("world_capture").find(filter) != string::npos)
+    {
+        report("world_capture", options, count, [&]()
+        {
+            for (unsigned int i = 0; i < count; i++)
+            {
+                world.capture(snapshot);
+            }
+        });
+    }
+    if (string("world_restore").find(filter) != string::npos)
+    {
+        report("world_restore", options, count, [&]()
+        {
+            for (unsigned int i = 0; i < count; i++)
+            {
+                world.restore(snapshot);
+            }
+        });
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] World snapshot is %lu bytes\n", (unsigned long)snapshot.size());
+#endif // DEBUG
+}
+
+//----------------------------------------------------------------------
+//
+// main()
+//
+//----------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const char* resources = "./";
+    const char* config = "/res/data/AerialAssist2028.json";
+    string filter;
+    BenchOptions options;
+    options.work = "/tmp";
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--resources") == 0 && has_value)
+        {
+            resources = argv[++i];
+        }
+        else if (strcmp(argv[i], "--config") == 0 && has_value)
+        {
+            config = argv[++i];
+        }
+        else if (strcmp(argv[i], "--nodes") == 0 && has_value)
+        {
+            options.nodes = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--rules") == 0 && has_value)
+        {
+            options.rules = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--robots") == 0 && has_value)
+        {
+            options.robots = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--steps") == 0 && has_value)
+        {
+            options.steps = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && has_value)
+        {
+            options.repeat = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--work") == 0 && has_value)
+        {
+            options.work = argv[++i];
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && has_value)
+        {
+            filter = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.repeat == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FileSystem::setResourcePath(resources);
+    benchTextureMap(options, filter);
+    benchCulling(options, filter);
+    benchRobots(options, filter, config);
+    benchSnapshots(options, filter, config);
+    return 0;
+}
@@ -0,0 +1,130 @@
+//
+//  FrcSimController.cpp
+//  FrcSim
+//
+//  Example controller for frcsim-headless --controller: drives forward at
+//  a fixed throttle, launches the ball after a delay and reports the round
+//  trip time of the lockstep handoff.  Link with ControlMailbox.cpp; robot
+//  code uses the same calls in its control loop.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "MatchInput.h"
+#include "Telemetry.h"
+#include "ControlMailbox.h"
+
+//----------------------------------------------------------------------
+//
+// usage()
+//
+//----------------------------------------------------------------------
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [options]\n", program);
+    fprintf(stderr, "  --name <name>        controller mailbox (default %s)\n", ControlMailbox::kDefaultName);
+    fprintf(stderr, "  --throttle <pct>     velocity command, -1.0 to 1.0 (default 0.5)\n");
+    fprintf(stderr, "  --yaw <deg>          heading command (default 0)\n");
+    fprintf(stderr, "  --launch <sec>       hold BUTTON_A from this simulated time (default never)\n");
+    fprintf(stderr, "  --duration <sec>     detach at this simulated time (default when the simulator stops)\n");
+}
+
+//----------------------------------------------------------------------
+//
+// main()
+//
+//----------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const char* name = ControlMailbox::kDefaultName;
+    float throttle = 0.5f;
+    float yaw = 0.0f;
+    double launch = -1.0;
+    double duration = -1.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--name") == 0 && has_value)
+        {
+            name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--throttle") == 0 && has_value)
+        {
+            throttle = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--yaw") == 0 && has_value)
+        {
+            yaw = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--launch") == 0 && has_value)
+        {
+            launch = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--duration") == 0 && has_value)
+        {
+            duration = atof(argv[++i]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ControlMailbox mailbox;
+    if (!mailbox.open(name))
+    {
+        fprintf(stderr, "[ERROR] Controller mailbox \"%s\" not found\n", name);
+        return 1;
+    }
+
+    // Time from posting a command to receiving the sensors it produced,
+    // the simulator's steps for the period included
+    vector<double> round_trips;
+    TelemetrySample sensors;
+    ControlMailbox::Command command;
+    chrono::steady_clock::time_point posted;
+    bool answered = false;
+    while (mailbox.waitSensors(sensors))
+    {
+        if (answered)
+        {
+            round_trips.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - posted).count());
+        }
+        if (duration >= 0.0 && sensors.time >= duration)
+        {
+            command.detach = 1;
+            mailbox.postCommand(command);
+            break;
+        }
+        command.velocity = throttle;
+        command.yaw = yaw;
+        command.buttons = (launch >= 0.0 && sensors.time >= launch) ? ControlMailbox::BUTTON_LAUNCH_BALL : 0;
+        posted = chrono::steady_clock::now();
+        mailbox.postCommand(command);
+        answered = true;
+    }
+
+    printf("robot position=(%.2f, %.2f, %.2f) velocity=%.2f\n", sensors.robotPosition[0], sensors.robotPosition[1], sensors.robotPosition[2], sensors.robotVelocity);
+    if (!round_trips.empty())
+    {
+        sort(round_trips.begin(), round_trips.end());
+        printf("commands=%lu period=%g round_trip_us min=%.1f median=%.1f max=%.1f\n", (unsigned long)round_trips.size(), mailbox.getPeriod(),
+            round_trips.front(), round_trips[round_trips.size() / 2], round_trips.back());
+    }
+    return 0;
+}
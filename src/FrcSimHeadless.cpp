@@ -0,0 +1,318 @@
+//
+//  FrcSimHeadless.cpp
+//  FrcSim
+//
+//  Runs the simulation without a window or GL context on a fixed timestep
+//  as fast as the CPU allows.  Link with the game sources (FrcSim.cpp,
+//  Robot.cpp, SimulationWorld.cpp) in place of gameplay-main-<platform>.cpp.
+//
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <thread>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Robot.h"
+#include "MatchInput.h"
+#include "FrcSim.h"
+#include "SimulationWorld.h"
+#include "Telemetry.h"
+#include "ControlMailbox.h"
+
+//----------------------------------------------------------------------
+//
+// usage()
+//
+//----------------------------------------------------------------------
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [options]\n", program);
+    fprintf(stderr, "  --resources <path>   resource directory containing res/ (default .)\n");
+    fprintf(stderr, "  --config <file>      robot configuration (default /res/data/AerialAssist2028.json)\n");
+    fprintf(stderr, "  --duration <sec>     simulated match length (default 150)\n");
+    fprintf(stderr, "  --timestep <sec>     fixed physics timestep (default %g)\n", SimulationWorld::kDefaultTimestep);
+    fprintf(stderr, "  --throttle <pct>     right trigger value, negative for left trigger (default 0)\n");
+    fprintf(stderr, "  --yaw <deg>          robot heading (default 0)\n");
+    fprintf(stderr, "  --launch <sec>       press BUTTON_A at this simulated time (default never)\n");
+    fprintf(stderr, "  --record <file>      write a match log of every tick\n");
+    fprintf(stderr, "  --replay <file>      replay a match log instead of the options above\n");
+    fprintf(stderr, "  --speed <n>          replay at n times real time, 0 as fast as possible (default 0)\n");
+    fprintf(stderr, "  --seek <sec>         start the replay at the last keyframe before this time\n");
+    fprintf(stderr, "  --telemetry <name>   publish every tick to this shared memory object (e.g. %s)\n", Telemetry::kDefaultName);
+    fprintf(stderr, "  --controller <name>  run in lockstep with a controller on this mailbox (e.g. %s)\n", ControlMailbox::kDefaultName);
+    fprintf(stderr, "  --period <sec>       simulated time per controller command (default 0.02)\n");
+}
+
+//----------------------------------------------------------------------
+//
+// main()
+//
+//----------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const char* resources = "./";
+    const char* config = "/res/data/AerialAssist2028.json";
+    double duration = 150.0;
+    float timestep = SimulationWorld::kDefaultTimestep;
+    float throttle = 0.0f;
+    float yaw = 0.0f;
+    double launch = -1.0;
+    const char* record = NULL;
+    const char* replay = NULL;
+    double speed = 0.0;
+    double seek = 0.0;
+    const char* telemetry_name = NULL;
+    const char* controller = NULL;
+    double period = 0.02;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--resources") == 0 && has_value)
+        {
+            resources = argv[++i];
+        }
+        else if (strcmp(argv[i], "--config") == 0 && has_value)
+        {
+            config = argv[++i];
+        }
+        else if (strcmp(argv[i], "--duration") == 0 && has_value)
+        {
+            duration = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--timestep") == 0 && has_value)
+        {
+            timestep = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--throttle") == 0 && has_value)
+        {
+            throttle = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--yaw") == 0 && has_value)
+        {
+            yaw = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--launch") == 0 && has_value)
+        {
+            launch = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--record") == 0 && has_value)
+        {
+            record = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && has_value)
+        {
+            replay = argv[++i];
+        }
+        else if (strcmp(argv[i], "--speed") == 0 && has_value)
+        {
+            speed = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seek") == 0 && has_value)
+        {
+            seek = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--telemetry") == 0 && has_value)
+        {
+            telemetry_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--controller") == 0 && has_value)
+        {
+            controller = argv[++i];
+        }
+        else if (strcmp(argv[i], "--period") == 0 && has_value)
+        {
+            period = atof(argv[++i]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (timestep <= 0.0f || period < timestep)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FileSystem::setResourcePath(resources);
+    SimulationWorld::Parameters parameters;
+    if (!parameters.load(AerialAssist::_kSceneFile, "res/frcsim.physics"))
+    {
+        fprintf(stderr, "[ERROR] Physics parameters not loaded, using defaults\n");
+    }
+
+    Robot* robot = new Robot(config, false);
+    robot->setYaw(yaw);
+    SimulationWorld world(parameters, robot);
+
+    MatchInput input;
+    if (throttle >= 0.0f)
+    {
+        input.rightTrigger = throttle;
+    }
+    else
+    {
+        input.leftTrigger = -1.0f * throttle;
+    }
+
+    MatchRecorder recorder;
+    if (record && !recorder.open(record))
+    {
+        fprintf(stderr, "[ERROR] Match log \"%s\" not created\n", record);
+        return 1;
+    }
+    Telemetry telemetry;
+    if (telemetry_name && !telemetry.create(telemetry_name))
+    {
+        fprintf(stderr, "[ERROR] Telemetry \"%s\" not created\n", telemetry_name);
+        return 1;
+    }
+    TelemetrySample sample;
+    ControlMailbox mailbox;
+    if (controller && !mailbox.create(controller, period))
+    {
+        fprintf(stderr, "[ERROR] Controller mailbox \"%s\" not created\n", controller);
+        return 1;
+    }
+
+    unsigned long commands = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (replay)
+    {
+        MatchPlayer player;
+        if (!player.open(replay))
+        {
+            fprintf(stderr, "[ERROR] Match log \"%s\" not read\n", replay);
+            return 1;
+        }
+        MatchFrame frame;
+        if (player.next(frame))
+        {
+            // The heading is not an input, start from the recorded one
+            robot->setYaw(frame.robotYaw);
+        }
+        player.rewind();
+        if (seek > 0.0)
+        {
+            // By recorded time, the log's timestep need not be --timestep
+            if (player.seekTime(seek, frame))
+            {
+                world.applyFrame(frame);
+            }
+        }
+        // Compare every replayed tick with the state that was recorded
+        unsigned long diverged = 0;
+        unsigned long first_divergence = 0;
+        MatchFrame state;
+        // Pace from where playback starts, which is not 0 after a seek
+        double replay_start = world.getSimulatedTime();
+        chrono::steady_clock::time_point replay_wall = chrono::steady_clock::now();
+        while (player.next(frame))
+        {
+            world.setInput(frame.input);
+            world.step(frame.timestep);
+            world.getFrame(state);
+            if (state.robotPosition != frame.robotPosition || state.robotVelocity != frame.robotVelocity ||
+                state.ballPosition != frame.ballPosition || state.ballInPlay != frame.ballInPlay)
+            {
+                if (diverged++ == 0)
+                {
+                    first_divergence = frame.tick;
+                }
+            }
+            state.input = frame.input;
+            state.timestep = frame.timestep;
+            recorder.record(state);
+            if (telemetry.isOpen())
+            {
+                sample.set(state);
+                telemetry.publish(sample);
+            }
+            if (speed > 0.0)
+            {
+                chrono::duration<double> due((world.getSimulatedTime() - replay_start) / speed);
+                this_thread::sleep_until(replay_wall + chrono::duration_cast<chrono::steady_clock::duration>(due));
+            }
+        }
+        printf("replay ticks=%lu diverged=%lu first_divergence=%lu\n", player.getFrameCount(), diverged, first_divergence);
+    }
+    else
+    {
+        // A controller commands every period, the ticks in between keep
+        // its last command
+        unsigned long ticks_per_period = (unsigned long)(period / timestep + 0.5);
+        ControlMailbox::Command command;
+        MatchFrame state;
+        while (world.getSimulatedTime() + (timestep * 0.5) < duration)
+        {
+            if (mailbox.isOpen() && world.getTickCount() % ticks_per_period == 0)
+            {
+                world.getFrame(state);
+                sample.set(state);
+                mailbox.postSensors(sample);
+                if (!mailbox.waitCommand(command))
+                {
+                    fprintf(stderr, "[ERROR] Controller detached or timed out at %.3f sec\n", world.getSimulatedTime());
+                    break;
+                }
+                command.getInput(input);
+                robot->setYaw(command.yaw);
+                commands++;
+            }
+            else if (!mailbox.isOpen())
+            {
+                input.launchBall = (launch >= 0.0 && world.getSimulatedTime() >= launch);
+            }
+            world.setInput(input);
+            world.step(timestep);
+            if (recorder.isOpen() || telemetry.isOpen())
+            {
+                MatchFrame frame;
+                world.getFrame(frame);
+                frame.input = input;
+                frame.timestep = timestep;
+                recorder.record(frame);
+                sample.set(frame);
+                telemetry.publish(sample);
+            }
+        }
+    }
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (mailbox.isOpen())
+    {
+        printf("controller commands=%lu period=%g wall_us_per_command=%.1f\n", commands, period, (commands > 0) ? wall * 1.0e6 / commands : 0.0);
+    }
+    if (recorder.isOpen())
+    {
+        printf("recorded ticks=%lu bytes=%lu\n", world.getTickCount(), recorder.getBytesWritten());
+        recorder.close();
+    }
+
+    Vector3 position = robot->getPosition();
+    Vector3 ball = world.getBallPosition();
+    printf("ticks=%lu simulated=%.3f wall=%.3f speedup=%.1f\n", world.getTickCount(), world.getSimulatedTime(), wall, (wall > 0.0) ? world.getSimulatedTime() / wall : 0.0);
+    printf("robot position=(%.2f, %.2f, %.2f) velocity=%.2f\n", position.x, position.y, position.z, robot->getVelocity());
+    printf("ball in_play=%d position=(%.2f, %.2f, %.2f)\n", world.isBallInPlay() ? 1 : 0, ball.x, ball.y, ball.z);
+    return 0;
+}
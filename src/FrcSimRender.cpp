@@ -0,0 +1,235 @@
+//
+//  FrcSimRender.cpp
+//  FrcSim
+//
+//  Renders one camera view of the match offscreen, without a window or a
+//  display, and streams the frames to disk.  Runs the full game on an EGL
+//  context (llvmpipe when there is no GPU), paused, and poses each frame
+//  from the match log at exactly 1/fps seconds of match time after the
+//  last, however long the frame takes to draw.  Link with the game
+//  sources (FrcSim.cpp, Robot.cpp, SimulationWorld.cpp), FrameCapture.cpp
+//  and OffscreenContext.cpp, -lEGL and -lpng, in place of
+//  gameplay-main-<platform>.cpp.
+//
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Robot.h"
+#include "FrcSim.h"
+#include "OffscreenContext.h"
+
+/**
+ * Camera names accepted by --camera, in CameraPosition order.
+ */
+static const char* kCameraNames[] = { "High", "DriverStation", "Overhead", "Chase", "RightSide", "LeftSide" };
+
+//----------------------------------------------------------------------
+//
+// usage()
+//
+//----------------------------------------------------------------------
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [options]\n", program);
+    fprintf(stderr, "  --camera <name>      High, DriverStation, Overhead, Chase, RightSide or LeftSide (default Chase)\n");
+    fprintf(stderr, "  --width <pixels>     frame width (default 1280)\n");
+    fprintf(stderr, "  --height <pixels>    frame height (default 720)\n");
+    fprintf(stderr, "  --fps <n>            frames per second of match time (default 30)\n");
+    fprintf(stderr, "  --frames <n>         stop after n frames, 0 for the whole replay (default 300)\n");
+    fprintf(stderr, "  --format <raw|png>   one RGBA file, or one PNG file per frame (default raw)\n");
+    fprintf(stderr, "  --output <path>      RAW file, or PNG pattern such as frame-%%06u.png (default frcsim-render.rgba)\n");
+    fprintf(stderr, "  --replay <file>      render a match log instead of the idle field\n");
+}
+
+//----------------------------------------------------------------------
+//
+// main()
+//
+//----------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    AerialAssist::CameraPosition camera = AerialAssist::Chase;
+    unsigned int width = 1280;
+    unsigned int height = 720;
+    double fps = 30.0;
+    unsigned int frames = 300;
+    FrameCapture::Format format = FrameCapture::RAW;
+    const char* output = NULL;
+    const char* replay = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--camera") == 0 && has_value)
+        {
+            const char* name = argv[++i];
+            int found = -1;
+            for (int c = 0; c < AerialAssist::CameraCount; c++)
+            {
+                if (strcmp(name, kCameraNames[c]) == 0)
+                {
+                    found = c;
+                }
+            }
+            if (found < 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            camera = (AerialAssist::CameraPosition)found;
+        }
+        else if (strcmp(argv[i], "--width") == 0 && has_value)
+        {
+            width = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--height") == 0 && has_value)
+        {
+            height = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && has_value)
+        {
+            fps = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && has_value)
+        {
+            frames = (unsigned int)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--format") == 0 && has_value)
+        {
+            const char* name = argv[++i];
+            if (strcmp(name, "raw") == 0)
+            {
+                format = FrameCapture::RAW;
+            }
+            else if (strcmp(name, "png") == 0)
+            {
+                format = FrameCapture::PNG;
+            }
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && has_value)
+        {
+            replay = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (width == 0 || height == 0 || fps <= 0.0 || (frames == 0 && !replay))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!output)
+    {
+        output = (format == FrameCapture::PNG) ? "frcsim-render-%06u.png" : "frcsim-render.rgba";
+    }
+
+    OffscreenContext context;
+    if (!context.create())
+    {
+        fprintf(stderr, "[ERROR] No offscreen GL context\n");
+        return 1;
+    }
+    printf("renderer=\"%s\"\n", context.getRenderer());
+
+    // The game is the global instance in FrcSim.cpp; run() initializes it
+    // and frame() updates and renders it, as the platform loop would
+    AerialAssist* game = static_cast<AerialAssist*>(Game::getInstance());
+    if (game->run() != 0)
+    {
+        fprintf(stderr, "[ERROR] Game not started\n");
+        return 1;
+    }
+    while (!game->isLoaded())
+    {
+        game->frame();
+    }
+    if (replay)
+    {
+        game->startReplay(replay);
+        if (!game->isReplaying())
+        {
+            fprintf(stderr, "[ERROR] Match log \"%s\" not read\n", replay);
+            game->exit();
+            return 1;
+        }
+    }
+    if (!game->startCapture(camera, width, height, output, format, true))
+    {
+        fprintf(stderr, "[ERROR] Capture \"%s\" not opened\n", output);
+        game->exit();
+        return 1;
+    }
+
+    // GamePlay steps the physics on the wall clock, so the game stays
+    // paused and every frame poses the log at the next video frame's match
+    // time; the time is computed, not summed, so it never drifts
+    game->pause();
+    const FrameCapture& capture = game->getCapture();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    unsigned int rendered = 0;
+    bool matched = true;
+    while (frames == 0 || rendered < frames)
+    {
+        double time = (rendered + 1) / fps;
+        if (replay)
+        {
+            if (!game->replayTo(time))
+            {
+                break;
+            }
+            // The frame shows the last tick ending by its time, and the
+            // next tick ends after it
+            if (game->getMatchTime() > time + 1.0e-6 || game->getReplayTime() <= time + 1.0e-6)
+            {
+                fprintf(stderr, "[ERROR] Frame %u at %.6f sec shows match time %.6f\n", rendered, time, game->getMatchTime());
+                matched = false;
+                break;
+            }
+        }
+        game->frame();
+        rendered++;
+    }
+    game->stopCapture();
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("frames=%u written=%u dropped=%u match=%.3f wall=%.3f\n", capture.getFrameCount(), capture.getWrittenCount(), capture.getDroppedCount(), rendered / fps, wall);
+    if (!matched)
+    {
+        game->exit();
+        return 1;
+    }
+    game->exit();
+    return 0;
+}
@@ -0,0 +1,135 @@
+//
+//  FrcSimTelemetry.cpp
+//  FrcSim
+//
+//  Follows the telemetry a running simulator publishes to shared memory and
+//  writes one CSV line per tick.  Link with Telemetry.cpp and MatchLog.cpp;
+//  it is also the reference reader for dashboards.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "MatchInput.h"
+#include "MatchLog.h"
+#include "Telemetry.h"
+
+//----------------------------------------------------------------------
+//
+// usage()
+//
+//----------------------------------------------------------------------
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [options]\n", program);
+    fprintf(stderr, "  --name <name>        shared memory object (default %s)\n", Telemetry::kDefaultName);
+    fprintf(stderr, "  --poll <ms>          sleep between polls when no tick is pending (default 5)\n");
+    fprintf(stderr, "  --count <n>          exit after n ticks (default run until the simulator exits)\n");
+}
+
+//----------------------------------------------------------------------
+//
+// main()
+//
+//----------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    const char* name = Telemetry::kDefaultName;
+    int poll = 5;
+    unsigned long count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--name") == 0 && has_value)
+        {
+            name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--poll") == 0 && has_value)
+        {
+            poll = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--count") == 0 && has_value)
+        {
+            count = strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Telemetry telemetry;
+    if (!telemetry.open(name))
+    {
+        fprintf(stderr, "[ERROR] Telemetry \"%s\" not found\n", name);
+        return 1;
+    }
+
+    // Start with the newest tick, a reader is not interested in history
+    uint64_t next = telemetry.getHead();
+    unsigned long printed = 0;
+    unsigned long skipped = 0;
+    int idle = 0;
+    TelemetrySample sample;
+    printf("tick,time,robot_x,robot_y,robot_z,robot_yaw,robot_velocity,robot_setpoint,ball_in_play,ball_x,ball_y,ball_z,ball_vx,ball_vy,ball_vz\n");
+    while (count == 0 || printed < count)
+    {
+        uint64_t head = telemetry.getHead();
+        if (next == head)
+        {
+            // The simulator unlinks the segment when it exits, stop once it is
+            // gone and nothing was published for a while
+            if (++idle * poll >= 1000)
+            {
+                Telemetry probe;
+                if (!probe.open(name))
+                {
+                    break;
+                }
+                idle = 0;
+            }
+            this_thread::sleep_for(chrono::milliseconds(poll));
+            continue;
+        }
+        idle = 0;
+        if (head - next > telemetry.getCapacity())
+        {
+            skipped += (unsigned long)(head - next - telemetry.getCapacity());
+            next = head - telemetry.getCapacity();
+        }
+        for ( ; next < head && (count == 0 || printed < count); next++)
+        {
+            if (!telemetry.read(next, sample))
+            {
+                skipped++;
+                continue;
+            }
+            printf("%llu,%.4f,%.3f,%.3f,%.3f,%.2f,%.3f,%.3f,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                (unsigned long long)sample.tick, sample.time,
+                sample.robotPosition[0], sample.robotPosition[1], sample.robotPosition[2], sample.robotYaw,
+                sample.robotVelocity, sample.robotSetpoint, sample.ballInPlay,
+                sample.ballPosition[0], sample.ballPosition[1], sample.ballPosition[2],
+                sample.ballVelocity[0], sample.ballVelocity[1], sample.ballVelocity[2]);
+            printed++;
+        }
+    }
+    if (skipped)
+    {
+        fprintf(stderr, "[Debug] %lu ticks overwritten before they were read\n", skipped);
+    }
+    return 0;
+}
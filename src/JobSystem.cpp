@@ -0,0 +1,297 @@
+//
+//  JobSystem.cpp
+//  FrcSim
+//
+//
+
+#include <vector>
+
+using namespace std;
+
+#include "JobSystem.h"
+
+/**
+ * Times a worker looks for queued jobs before going to sleep.
+ */
+static const unsigned int kSpinCount = 64;
+
+/**
+ * Most chunks parallelFor() makes per thread, a few so that stealing evens
+ * out chunks of uneven cost.
+ */
+static const size_t kChunksPerThread = 4;
+
+/**
+ * Scheduler the calling thread works for, NULL for other threads.
+ */
+static thread_local const JobSystem *t_owner = NULL;
+
+/**
+ * Deque of the calling worker.
+ */
+static thread_local unsigned int t_queue = 0;
+
+//----------------------------------------------------------------------
+//
+// getInstance()
+//
+//----------------------------------------------------------------------
+JobSystem &JobSystem::getInstance()
+{
+    static JobSystem jobs;
+    return jobs;
+}
+
+//----------------------------------------------------------------------
+//
+// JobSystem()
+//
+//----------------------------------------------------------------------
+JobSystem::JobSystem(unsigned int workerCount) :
+    _queued(0),
+    _sleeping(0),
+    _stopping(false)
+{
+    if (workerCount == 0)
+    {
+        // The waiting thread is the last core
+        workerCount = thread::hardware_concurrency();
+        workerCount = (workerCount > 1) ? workerCount - 1 : 1;
+    }
+    for (unsigned int i = 0; i <= workerCount; i++)
+    {
+        _queues.push_back(new Queue());
+    }
+    for (unsigned int i = 0; i < workerCount; i++)
+    {
+        _workers.push_back(thread(&JobSystem::workerLoop, this, i));
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// ~JobSystem()
+//
+//----------------------------------------------------------------------
+JobSystem::~JobSystem()
+{
+    {
+        lock_guard<mutex> lock(_sleep_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (size_t i = 0; i < _workers.size(); i++)
+    {
+        _workers[i].join();
+    }
+    for (size_t i = 0; i < _queues.size(); i++)
+    {
+        delete _queues[i];
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// getQueue()
+//
+//----------------------------------------------------------------------
+unsigned int JobSystem::getQueue() const
+{
+    return (t_owner == this) ? t_queue : (unsigned int)_workers.size();
+}
+
+//----------------------------------------------------------------------
+//
+// run()
+//
+//----------------------------------------------------------------------
+void JobSystem::run(const Task &task, Counter *counter)
+{
+    if (counter)
+    {
+        counter->_pending.fetch_add(1, memory_order_relaxed);
+    }
+    Job job;
+    job.task = task;
+    job.counter = counter;
+    Queue *queue = _queues[getQueue()];
+
+    // Counted first so take() never counts below zero
+    _queued++;
+    {
+        lock_guard<mutex> lock(queue->mutex);
+        queue->jobs.push_back(job);
+    }
+
+    // A worker going to sleep either sees the job or is seen here
+    if (_sleeping > 0)
+    {
+        lock_guard<mutex> lock(_sleep_mutex);
+        _wake.notify_one();
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// take()
+//
+//----------------------------------------------------------------------
+bool JobSystem::take(unsigned int queue, Job &job)
+{
+    if (_queued == 0)
+    {
+        return false;
+    }
+
+    // Newest job of our own deque, its data is most likely still cached
+    Queue *own = _queues[queue];
+    {
+        lock_guard<mutex> lock(own->mutex);
+        if (!own->jobs.empty())
+        {
+            job = own->jobs.back();
+            own->jobs.pop_back();
+            _queued--;
+            return true;
+        }
+    }
+
+    // Oldest job of another deque, usually the largest piece left
+    unsigned int count = (unsigned int)_queues.size();
+    for (unsigned int i = 1; i < count; i++)
+    {
+        Queue *victim = _queues[(queue + i) % count];
+        lock_guard<mutex> lock(victim->mutex);
+        if (!victim->jobs.empty())
+        {
+            job = victim->jobs.front();
+            victim->jobs.pop_front();
+            _queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+//
+// execute()
+//
+//----------------------------------------------------------------------
+void JobSystem::execute(Job &job)
+{
+    job.task();
+    if (job.counter)
+    {
+        job.counter->_pending.fetch_sub(1, memory_order_acq_rel);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// wait()
+//
+//----------------------------------------------------------------------
+void JobSystem::wait(const Counter &counter)
+{
+    unsigned int queue = getQueue();
+    while (!counter.isDone())
+    {
+        Job job;
+        if (take(queue, job))
+        {
+            execute(job);
+        }
+        else
+        {
+            // The last jobs are running on other threads
+            this_thread::yield();
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// parallelFor()
+//
+//----------------------------------------------------------------------
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain, const RangeTask &task)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    size_t count = end - begin;
+    if (grain == 0)
+    {
+        grain = 1;
+    }
+    size_t chunks = (count + grain - 1) / grain;
+    size_t maxChunks = getThreadCount() * kChunksPerThread;
+    if (chunks > maxChunks)
+    {
+        chunks = maxChunks;
+    }
+    if (chunks <= 1 || _workers.empty())
+    {
+        task(begin, end);
+        return;
+    }
+
+    // The first chunk runs here, the first few chunks are one index longer
+    size_t size = count / chunks;
+    size_t extra = count % chunks;
+    size_t first = begin + size + (extra > 0 ? 1 : 0);
+    size_t start = first;
+    Counter counter;
+    for (size_t i = 1; i < chunks; i++)
+    {
+        size_t stop = start + size + (i < extra ? 1 : 0);
+        run([&task, start, stop]() { task(start, stop); }, &counter);
+        start = stop;
+    }
+    task(begin, first);
+    wait(counter);
+}
+
+//----------------------------------------------------------------------
+//
+// workerLoop()
+//
+//----------------------------------------------------------------------
+void JobSystem::workerLoop(unsigned int index)
+{
+    t_owner = this;
+    t_queue = index;
+    while (true)
+    {
+        Job job;
+        if (take(index, job))
+        {
+            execute(job);
+            continue;
+        }
+        bool queued = false;
+        for (unsigned int i = 0; i < kSpinCount && !queued; i++)
+        {
+            this_thread::yield();
+            queued = (_queued > 0);
+        }
+        if (queued)
+        {
+            continue;
+        }
+        unique_lock<mutex> lock(_sleep_mutex);
+        _sleeping++;
+        while (_queued == 0 && !_stopping)
+        {
+            _wake.wait(lock);
+        }
+        _sleeping--;
+        if (_stopping && _queued == 0)
+        {
+            // Stopping and nothing left to do
+            return;
+        }
+    }
+}
@@ -0,0 +1,568 @@
+//
+//  MatchLog.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "MatchInput.h"
+#include "MatchLog.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+/**
+ * Record tags.
+ */
+static const uint8_t kKeyframeTag = 'K';
+static const uint8_t kDeltaTag = 'D';
+
+/**
+ * Size of the log header: magic, version, keyframe interval, reserved.
+ */
+static const size_t kHeaderSize = 16;
+
+//----------------------------------------------------------------------
+//
+// floatBits()
+//
+//----------------------------------------------------------------------
+static uint64_t floatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+//----------------------------------------------------------------------
+//
+// doubleBits()
+//
+//----------------------------------------------------------------------
+static uint64_t doubleBits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+//----------------------------------------------------------------------
+//
+// bitsFloat()
+//
+//----------------------------------------------------------------------
+static float bitsFloat(uint64_t bits)
+{
+    uint32_t narrow = (uint32_t)bits;
+    float value;
+    memcpy(&value, &narrow, sizeof(value));
+    return value;
+}
+
+//----------------------------------------------------------------------
+//
+// bitsDouble()
+//
+//----------------------------------------------------------------------
+static double bitsDouble(uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//----------------------------------------------------------------------
+//
+// putVarint()
+//
+//----------------------------------------------------------------------
+static void putVarint(vector<uint8_t> &buffer, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((uint8_t)value);
+}
+
+//----------------------------------------------------------------------
+//
+// putUInt32()
+//
+//----------------------------------------------------------------------
+static void putUInt32(uint8_t *data, uint32_t value)
+{
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+//----------------------------------------------------------------------
+//
+// getUInt32()
+//
+//----------------------------------------------------------------------
+static uint32_t getUInt32(const uint8_t *data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+//----------------------------------------------------------------------
+//
+// MatchFrame()
+//
+//----------------------------------------------------------------------
+MatchFrame::MatchFrame() :
+    tick(0),
+    time(0.0),
+    timestep(0.0f),
+    robotPosition(Vector3::zero()),
+    robotYaw(0.0f),
+    robotVelocity(0.0),
+    robotSetpoint(0.0),
+    ballInPlay(false),
+    ballPosition(Vector3::zero()),
+    ballLinearVelocity(Vector3::zero()),
+    ballAngularVelocity(Vector3::zero())
+{
+}
+
+//----------------------------------------------------------------------
+//
+// getFields()
+//
+//----------------------------------------------------------------------
+void MatchFrame::getFields(uint64_t *fields) const
+{
+    fields[TIMESTEP] = floatBits(timestep);
+    fields[LEFT_TRIGGER] = floatBits(input.leftTrigger);
+    fields[RIGHT_TRIGGER] = floatBits(input.rightTrigger);
+    fields[LEFT_STICK_X] = floatBits(input.leftStick.x);
+    fields[LEFT_STICK_Y] = floatBits(input.leftStick.y);
+    fields[RIGHT_STICK_X] = floatBits(input.rightStick.x);
+    fields[RIGHT_STICK_Y] = floatBits(input.rightStick.y);
+    fields[FLAGS] = (input.launchBall ? FLAG_LAUNCH_BALL : 0) |
+                    (input.fireCatapult ? FLAG_FIRE_CATAPULT : 0) |
+                    (ballInPlay ? FLAG_BALL_IN_PLAY : 0);
+    fields[ROBOT_X] = floatBits(robotPosition.x);
+    fields[ROBOT_Y] = floatBits(robotPosition.y);
+    fields[ROBOT_Z] = floatBits(robotPosition.z);
+    fields[ROBOT_YAW] = floatBits(robotYaw);
+    fields[ROBOT_VELOCITY] = doubleBits(robotVelocity);
+    fields[ROBOT_SETPOINT] = doubleBits(robotSetpoint);
+    fields[BALL_X] = floatBits(ballPosition.x);
+    fields[BALL_Y] = floatBits(ballPosition.y);
+    fields[BALL_Z] = floatBits(ballPosition.z);
+    fields[BALL_LINEAR_X] = floatBits(ballLinearVelocity.x);
+    fields[BALL_LINEAR_Y] = floatBits(ballLinearVelocity.y);
+    fields[BALL_LINEAR_Z] = floatBits(ballLinearVelocity.z);
+    fields[BALL_ANGULAR_X] = floatBits(ballAngularVelocity.x);
+    fields[BALL_ANGULAR_Y] = floatBits(ballAngularVelocity.y);
+    fields[BALL_ANGULAR_Z] = floatBits(ballAngularVelocity.z);
+}
+
+//----------------------------------------------------------------------
+//
+// setFields()
+//
+//----------------------------------------------------------------------
+void MatchFrame::setFields(const uint64_t *fields)
+{
+    timestep = bitsFloat(fields[TIMESTEP]);
+    input.leftTrigger = bitsFloat(fields[LEFT_TRIGGER]);
+    input.rightTrigger = bitsFloat(fields[RIGHT_TRIGGER]);
+    input.leftStick.x = bitsFloat(fields[LEFT_STICK_X]);
+    input.leftStick.y = bitsFloat(fields[LEFT_STICK_Y]);
+    input.rightStick.x = bitsFloat(fields[RIGHT_STICK_X]);
+    input.rightStick.y = bitsFloat(fields[RIGHT_STICK_Y]);
+    input.launchBall = (fields[FLAGS] & FLAG_LAUNCH_BALL) != 0;
+    input.fireCatapult = (fields[FLAGS] & FLAG_FIRE_CATAPULT) != 0;
+    ballInPlay = (fields[FLAGS] & FLAG_BALL_IN_PLAY) != 0;
+    robotPosition.x = bitsFloat(fields[ROBOT_X]);
+    robotPosition.y = bitsFloat(fields[ROBOT_Y]);
+    robotPosition.z = bitsFloat(fields[ROBOT_Z]);
+    robotYaw = bitsFloat(fields[ROBOT_YAW]);
+    robotVelocity = bitsDouble(fields[ROBOT_VELOCITY]);
+    robotSetpoint = bitsDouble(fields[ROBOT_SETPOINT]);
+    ballPosition.x = bitsFloat(fields[BALL_X]);
+    ballPosition.y = bitsFloat(fields[BALL_Y]);
+    ballPosition.z = bitsFloat(fields[BALL_Z]);
+    ballLinearVelocity.x = bitsFloat(fields[BALL_LINEAR_X]);
+    ballLinearVelocity.y = bitsFloat(fields[BALL_LINEAR_Y]);
+    ballLinearVelocity.z = bitsFloat(fields[BALL_LINEAR_Z]);
+    ballAngularVelocity.x = bitsFloat(fields[BALL_ANGULAR_X]);
+    ballAngularVelocity.y = bitsFloat(fields[BALL_ANGULAR_Y]);
+    ballAngularVelocity.z = bitsFloat(fields[BALL_ANGULAR_Z]);
+}
+
+//----------------------------------------------------------------------
+//
+// MatchRecorder()
+//
+//----------------------------------------------------------------------
+MatchRecorder::MatchRecorder() :
+    _file(NULL),
+    _keyframe_interval(kDefaultKeyframeInterval),
+    _frames(0),
+    _bytes(0)
+{
+    memset(_previous, 0, sizeof(_previous));
+}
+
+//----------------------------------------------------------------------
+//
+// ~MatchRecorder()
+//
+//----------------------------------------------------------------------
+MatchRecorder::~MatchRecorder()
+{
+    close();
+}
+
+//----------------------------------------------------------------------
+//
+// open()
+//
+//----------------------------------------------------------------------
+bool MatchRecorder::open(const string &filename, unsigned int keyframeInterval)
+{
+    close();
+    _file = fopen(filename.c_str(), "wb");
+    if (!_file)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] Match log \"%s\" not created\n", filename.c_str());
+#endif // DEBUG
+        return false;
+    }
+    _keyframe_interval = keyframeInterval ? keyframeInterval : 1;
+    _frames = 0;
+    memset(_previous, 0, sizeof(_previous));
+
+    uint8_t header[kHeaderSize];
+    memset(header, 0, sizeof(header));
+    putUInt32(header, kMagic);
+    putUInt32(header + 4, kVersion);
+    putUInt32(header + 8, _keyframe_interval);
+    fwrite(header, 1, sizeof(header), _file);
+    _bytes = sizeof(header);
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// record()
+//
+//----------------------------------------------------------------------
+void MatchRecorder::record(const MatchFrame &frame)
+{
+    if (!_file)
+    {
+        return;
+    }
+    uint64_t fields[MatchFrame::FIELD_COUNT];
+    frame.getFields(fields);
+
+    _buffer.clear();
+    if (_frames % _keyframe_interval == 0)
+    {
+        _buffer.push_back(kKeyframeTag);
+        putVarint(_buffer, frame.tick);
+        putVarint(_buffer, doubleBits(frame.time));
+        for (unsigned int f = 0; f < MatchFrame::FIELD_COUNT; f++)
+        {
+            putVarint(_buffer, fields[f]);
+        }
+    }
+    else
+    {
+        uint32_t mask = 0;
+        for (unsigned int f = 0; f < MatchFrame::FIELD_COUNT; f++)
+        {
+            if (fields[f] != _previous[f])
+            {
+                mask |= (1u << f);
+            }
+        }
+        _buffer.push_back(kDeltaTag);
+        putVarint(_buffer, mask);
+        for (unsigned int f = 0; f < MatchFrame::FIELD_COUNT; f++)
+        {
+            if (mask & (1u << f))
+            {
+                putVarint(_buffer, fields[f] ^ _previous[f]);
+            }
+        }
+    }
+    memcpy(_previous, fields, sizeof(_previous));
+    fwrite(&_buffer[0], 1, _buffer.size(), _file);
+    _bytes += _buffer.size();
+    _frames++;
+}
+
+//----------------------------------------------------------------------
+//
+// close()
+//
+//----------------------------------------------------------------------
+void MatchRecorder::close()
+{
+    if (_file)
+    {
+        fclose(_file);
+        _file = NULL;
+#ifdef DEBUG
+        fprintf(stderr, "[Debug] Match log closed, %lu ticks in %lu bytes\n", _frames, _bytes);
+#endif // DEBUG
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// MatchPlayer()
+//
+//----------------------------------------------------------------------
+MatchPlayer::MatchPlayer() :
+    _offset(0),
+    _tick(0),
+    _time(0.0),
+    _frame_count(0),
+    _duration(0.0)
+{
+    memset(_previous, 0, sizeof(_previous));
+}
+
+//----------------------------------------------------------------------
+//
+// open()
+//
+//----------------------------------------------------------------------
+bool MatchPlayer::open(const string &filename)
+{
+    _data.clear();
+    _keyframes.clear();
+    _frame_count = 0;
+    _duration = 0.0;
+
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (!file)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] Match log \"%s\" not opened\n", filename.c_str());
+#endif // DEBUG
+        return false;
+    }
+    uint8_t buffer[64 * 1024];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        _data.insert(_data.end(), buffer, buffer + count);
+    }
+    fclose(file);
+
+    if (_data.size() < kHeaderSize || getUInt32(&_data[0]) != MatchRecorder::kMagic || getUInt32(&_data[4]) != MatchRecorder::kVersion)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] \"%s\" is not a match log\n", filename.c_str());
+#endif // DEBUG
+        _data.clear();
+        return false;
+    }
+
+    // Decode once to index the keyframes and find the length
+    rewind();
+    MatchFrame frame;
+    size_t offset = _offset;
+    while (offset < _data.size() && decode(frame))
+    {
+        if (_data[offset] == kKeyframeTag)
+        {
+            Keyframe keyframe;
+            keyframe.tick = frame.tick;
+            keyframe.time = frame.time;
+            keyframe.offset = offset;
+            _keyframes.push_back(keyframe);
+        }
+        _frame_count++;
+        _duration = frame.time;
+        offset = _offset;
+    }
+#if DEBUG
+    if (offset < _data.size())
+    {
+        fprintf(stderr, "[ERROR] Match log \"%s\" truncated after tick %lu\n", filename.c_str(), frame.tick);
+    }
+#endif // DEBUG
+    // Drop a damaged tail so next() stops where the index stops
+    _data.resize(offset);
+    rewind();
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// rewind()
+//
+//----------------------------------------------------------------------
+void MatchPlayer::rewind()
+{
+    _offset = kHeaderSize;
+    _tick = 0;
+    _time = 0.0;
+    memset(_previous, 0, sizeof(_previous));
+}
+
+//----------------------------------------------------------------------
+//
+// next()
+//
+//----------------------------------------------------------------------
+bool MatchPlayer::next(MatchFrame &frame)
+{
+    if (_offset >= _data.size())
+    {
+        return false;
+    }
+    return decode(frame);
+}
+
+//----------------------------------------------------------------------
+//
+// seek()
+//
+//----------------------------------------------------------------------
+bool MatchPlayer::seek(unsigned long tick, MatchFrame &frame)
+{
+    size_t k = _keyframes.size();
+    while (k > 0 && _keyframes[k - 1].tick > tick)
+    {
+        k--;
+    }
+    if (k == 0)
+    {
+        return false;
+    }
+    _offset = _keyframes[k - 1].offset;
+    return decode(frame);
+}
+
+//----------------------------------------------------------------------
+//
+// seekTime()
+//
+//----------------------------------------------------------------------
+bool MatchPlayer::seekTime(double time, MatchFrame &frame)
+{
+    size_t k = _keyframes.size();
+    while (k > 0 && _keyframes[k - 1].time > time)
+    {
+        k--;
+    }
+    if (k == 0)
+    {
+        return false;
+    }
+    _offset = _keyframes[k - 1].offset;
+    return decode(frame);
+}
+
+//----------------------------------------------------------------------
+//
+// readVarint()
+//
+//----------------------------------------------------------------------
+bool MatchPlayer::readVarint(uint64_t &value)
+{
+    value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+        if (_offset >= _data.size())
+        {
+            return false;
+        }
+        uint8_t byte = _data[_offset++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+//
+// decode()
+//
+//----------------------------------------------------------------------
+bool MatchPlayer::decode(MatchFrame &frame)
+{
+    uint8_t tag = _data[_offset++];
+    uint64_t fields[MatchFrame::FIELD_COUNT];
+    if (tag == kKeyframeTag)
+    {
+        uint64_t tick;
+        uint64_t time;
+        if (!readVarint(tick) || !readVarint(time))
+        {
+            return false;
+        }
+        for (unsigned int f = 0; f < MatchFrame::FIELD_COUNT; f++)
+        {
+            if (!readVarint(fields[f]))
+            {
+                return false;
+            }
+        }
+        _tick = (unsigned long)tick;
+        _time = bitsDouble(time);
+    }
+    else if (tag == kDeltaTag)
+    {
+        uint64_t mask;
+        if (!readVarint(mask))
+        {
+            return false;
+        }
+        for (unsigned int f = 0; f < MatchFrame::FIELD_COUNT; f++)
+        {
+            fields[f] = _previous[f];
+            if (mask & (1u << f))
+            {
+                uint64_t change;
+                if (!readVarint(change))
+                {
+                    return false;
+                }
+                fields[f] ^= change;
+            }
+        }
+        // Same accumulation as SimulationWorld::step()
+        _tick++;
+        _time += bitsFloat(fields[MatchFrame::TIMESTEP]);
+    }
+    else
+    {
+        return false;
+    }
+    memcpy(_previous, fields, sizeof(_previous));
+    frame.setFields(fields);
+    frame.tick = _tick;
+    frame.time = _time;
+    return true;
+}
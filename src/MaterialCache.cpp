@@ -0,0 +1,169 @@
+//
+//  MaterialCache.cpp
+//  FrcSim
+//
+//
+
+#include <map>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "MaterialCache.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+//----------------------------------------------------------------------
+//
+// MaterialCache()
+//
+//----------------------------------------------------------------------
+MaterialCache::MaterialCache() :
+    _hits(0)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// ~MaterialCache()
+//
+//----------------------------------------------------------------------
+MaterialCache::~MaterialCache()
+{
+    clear();
+}
+
+//----------------------------------------------------------------------
+//
+// get()
+//
+//----------------------------------------------------------------------
+const MaterialCache::Entry &MaterialCache::get(const Key &key)
+{
+    map<Key, Entry>::iterator it = _entries.find(key);
+    if (it != _entries.end())
+    {
+        _hits++;
+        return it->second;
+    }
+
+    Entry entry;
+    entry.id = (unsigned int)_entries.size();
+    entry.sampler = getSampler(key.texture);
+    if (entry.sampler)
+    {
+        entry.sampler->addRef();
+    }
+    entry.stateBlock = RenderState::StateBlock::create();
+    entry.stateBlock->setCullFace(true);
+    entry.stateBlock->setDepthTest(true);
+    entry.stateBlock->setDepthWrite(true);
+#ifdef DEBUG
+    fprintf(stderr, "[Debug]\t\tMaterial cache entry %u for \"%s\" (%s%s, specularity %4.2f)\n", entry.id, key.texture.c_str(), key.defines.c_str(), key.transparent ? ", transparent" : "", key.specularity);
+#endif // DEBUG
+    it = _entries.insert(make_pair(key, entry)).first;
+    _keys.push_back(&it->first);
+    return it->second;
+}
+
+//----------------------------------------------------------------------
+//
+// getKey()
+//
+//----------------------------------------------------------------------
+const MaterialCache::Key *MaterialCache::getKey(unsigned int id) const
+{
+    return (id < _keys.size()) ? _keys[id] : NULL;
+}
+
+//----------------------------------------------------------------------
+//
+// getNodeEntry()
+//
+//----------------------------------------------------------------------
+unsigned int MaterialCache::getNodeEntry(const Node *node) const
+{
+    map<const Node*, unsigned int>::const_iterator it = _nodes.find(node);
+    return (it != _nodes.end()) ? it->second : kNoEntry;
+}
+
+//----------------------------------------------------------------------
+//
+// clear()
+//
+//----------------------------------------------------------------------
+void MaterialCache::clear()
+{
+    map<Key, Entry>::iterator it;
+    for (it = _entries.begin(); it != _entries.end(); it++)
+    {
+        SAFE_RELEASE(it->second.sampler);
+        SAFE_RELEASE(it->second.stateBlock);
+    }
+    _entries.clear();
+    _keys.clear();
+    _nodes.clear();
+    map<string, Texture::Sampler*>::iterator sit;
+    for (sit = _samplers.begin(); sit != _samplers.end(); sit++)
+    {
+        SAFE_RELEASE(sit->second);
+    }
+    _samplers.clear();
+    _hits = 0;
+}
+
+//----------------------------------------------------------------------
+//
+// addTexture()
+//
+//----------------------------------------------------------------------
+void MaterialCache::addTexture(const string &path, Texture *texture)
+{
+    if (_samplers.find(path) != _samplers.end())
+    {
+        return;
+    }
+    Texture::Sampler* sampler = Texture::Sampler::create(texture);
+    if (sampler)
+    {
+        sampler->setFilterMode(Texture::LINEAR_MIPMAP_LINEAR, Texture::LINEAR_MIPMAP_LINEAR);
+        sampler->setWrapMode(Texture::REPEAT, Texture::REPEAT);
+    }
+    _samplers.insert(make_pair(path, sampler));
+}
+
+//----------------------------------------------------------------------
+//
+// getSampler()
+//
+//----------------------------------------------------------------------
+Texture::Sampler *MaterialCache::getSampler(const string &texture)
+{
+    map<string, Texture::Sampler*>::iterator it = _samplers.find(texture);
+    if (it != _samplers.end())
+    {
+        return it->second;
+    }
+    Texture::Sampler* sampler = Texture::Sampler::create(texture.c_str(), true);
+    if (sampler)
+    {
+        sampler->setFilterMode(Texture::LINEAR_MIPMAP_LINEAR, Texture::LINEAR_MIPMAP_LINEAR);
+        sampler->setWrapMode(Texture::REPEAT, Texture::REPEAT);
+    }
+#if DEBUG
+    else
+    {
+        fprintf(stderr, "[ERROR] Texture \"%s\" not loaded\n", texture.c_str());
+    }
+#endif // DEBUG
+    _samplers.insert(make_pair(texture, sampler));
+    return sampler;
+}
@@ -0,0 +1,389 @@
+//
+//  Mechanism.cpp
+//  FrcSim
+//
+//
+
+#include <cstring>
+#include <cmath>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <json/json.h>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "Mechanism.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+const float Mechanism::kDefaultRate = 360.0f;
+
+/**
+ * Axis letters of the "rotationAxis" and "translationAxis" values.
+ */
+static const char kAxisNames[] = "xyz";
+
+//----------------------------------------------------------------------
+//
+// Mechanism()
+//
+//----------------------------------------------------------------------
+Mechanism::Mechanism()
+{
+}
+
+//----------------------------------------------------------------------
+//
+// Mechanism()
+//
+//----------------------------------------------------------------------
+Mechanism::Mechanism(const Mechanism &mechanism) :
+    _joints(mechanism._joints)
+{
+    bind(NULL);
+}
+
+//----------------------------------------------------------------------
+//
+// operator=()
+//
+//----------------------------------------------------------------------
+Mechanism &Mechanism::operator=(const Mechanism &mechanism)
+{
+    if (this != &mechanism)
+    {
+        _joints = mechanism._joints;
+        bind(NULL);
+    }
+    return *this;
+}
+
+//----------------------------------------------------------------------
+//
+// Deserialize()
+//
+//----------------------------------------------------------------------
+void Mechanism::Deserialize(const Json::Value &motionList)
+{
+    _joints.clear();
+    if (!motionList.isArray())
+    {
+        return;
+    }
+    for (Json::Value::ArrayIndex i = 0; i < motionList.size(); i++)
+    {
+        const Json::Value &entry = motionList[i];
+        Joint joint;
+        joint.name = entry.get("name", "").asString();
+        string motion = entry.get("motion", "angular").asString();
+        const char *prefix;
+        string axis;
+        if (motion == "linear")
+        {
+            joint.motion = LINEAR;
+            axis = entry.get("translationAxis", "x").asString();
+            prefix = "Position";
+        }
+        else
+        {
+            joint.motion = ANGULAR;
+            axis = entry.get("rotationAxis", "x").asString();
+            prefix = "Angle";
+        }
+        const char *letter = axis.empty() ? NULL : strchr(kAxisNames, axis[0]);
+        if (joint.name.empty() || !letter || !*letter)
+        {
+#if DEBUG
+            fprintf(stderr, "[ERROR] Motion %u (\"%s\") has no name or axis, ignored\n", (unsigned int)i, joint.name.c_str());
+#endif // DEBUG
+            continue;
+        }
+        joint.axis = (unsigned char)(letter - kAxisNames);
+        joint.minimum = entry.get(string("min") + prefix, 0.0).asFloat();
+        joint.maximum = entry.get(string("max") + prefix, 0.0).asFloat();
+        if (joint.maximum < joint.minimum)
+        {
+            swap(joint.minimum, joint.maximum);
+        }
+        joint.offset = entry.get(string("offset") + prefix, 0.0).asFloat();
+        joint.rate = fabs(entry.get("rate", kDefaultRate).asFloat());
+        joint.reset = entry.get("reset", false).asBool();
+        joint.value = joint.minimum;
+        joint.previous = joint.value;
+        joint.target = joint.minimum;
+        _joints.push_back(joint);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// Serialize()
+//
+//----------------------------------------------------------------------
+void Mechanism::Serialize(Json::Value &motionList) const
+{
+    motionList = Json::Value(Json::arrayValue);
+    for (size_t i = 0; i < _joints.size(); i++)
+    {
+        const Joint &joint = _joints[i];
+        const char *prefix = (joint.motion == LINEAR) ? "Position" : "Angle";
+        Json::Value entry;
+        entry["name"] = joint.name;
+        entry["motion"] = (joint.motion == LINEAR) ? "linear" : "angular";
+        entry[(joint.motion == LINEAR) ? "translationAxis" : "rotationAxis"] = string(1, kAxisNames[joint.axis]);
+        entry[string("min") + prefix] = joint.minimum;
+        entry[string("max") + prefix] = joint.maximum;
+        entry[string("offset") + prefix] = joint.offset;
+        entry["rate"] = joint.rate;
+        entry["reset"] = joint.reset;
+        motionList.append(entry);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// Cook()
+//
+//----------------------------------------------------------------------
+void Mechanism::Cook(CookedCache::Writer &writer) const
+{
+    writer.putUInt((uint32_t)_joints.size());
+    for (size_t i = 0; i < _joints.size(); i++)
+    {
+        const Joint &joint = _joints[i];
+        writer.putString(joint.name.c_str());
+        writer.putUInt(joint.motion);
+        writer.putUInt(joint.axis);
+        writer.putBool(joint.reset);
+        writer.putFloat(joint.minimum);
+        writer.putFloat(joint.maximum);
+        writer.putFloat(joint.offset);
+        writer.putFloat(joint.rate);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// ReadCooked()
+//
+//----------------------------------------------------------------------
+bool Mechanism::ReadCooked(CookedCache::Reader &reader)
+{
+    _joints.clear();
+    unsigned int count = reader.getUInt();
+    for (unsigned int i = 0; i < count && reader.isValid(); i++)
+    {
+        Joint joint;
+        joint.name = reader.getString();
+        joint.motion = (reader.getUInt() == LINEAR) ? LINEAR : ANGULAR;
+        joint.axis = (unsigned char)min(reader.getUInt(), 2u);
+        joint.reset = reader.getBool();
+        joint.minimum = reader.getFloat();
+        joint.maximum = reader.getFloat();
+        joint.offset = reader.getFloat();
+        joint.rate = reader.getFloat();
+        joint.value = joint.minimum;
+        joint.previous = joint.value;
+        joint.target = joint.minimum;
+        _joints.push_back(joint);
+    }
+    return reader.isValid();
+}
+
+//----------------------------------------------------------------------
+//
+// capture()
+//
+//----------------------------------------------------------------------
+void Mechanism::capture(Snapshot &snapshot) const
+{
+    for (size_t i = 0; i < _joints.size(); i++)
+    {
+        snapshot.put(_joints[i].value);
+        snapshot.put(_joints[i].target);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// restore()
+//
+//----------------------------------------------------------------------
+bool Mechanism::restore(Snapshot &snapshot)
+{
+    for (size_t i = 0; i < _joints.size(); i++)
+    {
+        Joint &joint = _joints[i];
+        float value = joint.value;
+        float previous = joint.previous;
+        if (!snapshot.get(joint.value) || !snapshot.get(joint.target))
+        {
+            return false;
+        }
+        joint.previous = joint.value;
+        if (joint.node && (joint.value != value || previous != value))
+        {
+            pose(joint, joint.value);
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// bind()
+//
+//----------------------------------------------------------------------
+void Mechanism::bind(Node *root)
+{
+    for (size_t i = 0; i < _joints.size(); i++)
+    {
+        Joint &joint = _joints[i];
+        joint.node = root ? root->findNode(joint.name.c_str()) : NULL;
+        if (!joint.node)
+        {
+#if DEBUG
+            if (root)
+            {
+                fprintf(stderr, "[ERROR] Motion node \"%s\" not found\n", joint.name.c_str());
+            }
+#endif // DEBUG
+            continue;
+        }
+        joint.origin = joint.node->getTranslation();
+        pose(joint, joint.value);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// update()
+//
+//----------------------------------------------------------------------
+void Mechanism::update(float elapsedTime)
+{
+    for (size_t i = 0; i < _joints.size(); i++)
+    {
+        Joint &joint = _joints[i];
+        if (joint.value == joint.target)
+        {
+            if (joint.previous != joint.value && joint.node)
+            {
+                // Settled, interpolate() left the node short of its value
+                pose(joint, joint.value);
+            }
+            joint.previous = joint.value;
+            continue;
+        }
+        joint.previous = joint.value;
+        float step = joint.rate * elapsedTime;
+        if (joint.target > joint.value)
+        {
+            joint.value = min(joint.value + step, joint.target);
+        }
+        else
+        {
+            joint.value = max(joint.value - step, joint.target);
+        }
+        if (joint.node)
+        {
+            pose(joint, joint.value);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// interpolate()
+//
+//----------------------------------------------------------------------
+void Mechanism::interpolate(float alpha)
+{
+    for (size_t i = 0; i < _joints.size(); i++)
+    {
+        const Joint &joint = _joints[i];
+        if (joint.node && joint.previous != joint.value)
+        {
+            pose(joint, joint.previous + (joint.value - joint.previous) * alpha);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// find()
+//
+//----------------------------------------------------------------------
+int Mechanism::find(const char *name) const
+{
+    for (size_t i = 0; i < _joints.size(); i++)
+    {
+        if (_joints[i].name == name)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+//
+// setTarget()
+//
+//----------------------------------------------------------------------
+void Mechanism::setTarget(unsigned int index, float target)
+{
+    Joint &joint = _joints[index];
+    joint.target = max(joint.minimum, min(target, joint.maximum));
+}
+
+//----------------------------------------------------------------------
+//
+// setEngaged()
+//
+//----------------------------------------------------------------------
+void Mechanism::setEngaged(unsigned int index, bool engaged)
+{
+    Joint &joint = _joints[index];
+    if (engaged)
+    {
+        joint.target = joint.maximum;
+    }
+    else if (joint.reset)
+    {
+        joint.target = joint.minimum;
+    }
+    else
+    {
+        joint.target = joint.value;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// pose()
+//
+//----------------------------------------------------------------------
+void Mechanism::pose(const Joint &joint, float value)
+{
+    Vector3 axis(joint.axis == 0 ? 1.0f : 0.0f, joint.axis == 1 ? 1.0f : 0.0f, joint.axis == 2 ? 1.0f : 0.0f);
+    float amount = value + joint.offset;
+    if (joint.motion == ANGULAR)
+    {
+        joint.node->setRotation(axis, MATH_DEG_TO_RAD(amount));
+    }
+    else
+    {
+        joint.node->setTranslation(joint.origin + axis * amount);
+    }
+}
@@ -0,0 +1,211 @@
+//
+//  NodeRegistry.cpp
+//  FrcSim
+//
+//
+
+#include <cstring>
+
+#include <map>
+#include <vector>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "NodeRegistry.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+//----------------------------------------------------------------------
+//
+// NodeRegistry()
+//
+//----------------------------------------------------------------------
+NodeRegistry::NodeRegistry()
+{
+}
+
+//----------------------------------------------------------------------
+//
+// ~NodeRegistry()
+//
+//----------------------------------------------------------------------
+NodeRegistry::~NodeRegistry()
+{
+    clear();
+}
+
+//----------------------------------------------------------------------
+//
+// build()
+//
+//----------------------------------------------------------------------
+void NodeRegistry::build(Scene *scene)
+{
+    clear();
+    if (scene)
+    {
+        scene->visit(this, &NodeRegistry::visitNode);
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Node registry has %lu nodes\n", (unsigned long)_index.size());
+#endif // DEBUG
+}
+
+//----------------------------------------------------------------------
+//
+// visitNode()
+//
+//----------------------------------------------------------------------
+bool NodeRegistry::visitNode(Node *node)
+{
+    add(node);
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// add()
+//
+//----------------------------------------------------------------------
+NodeRegistry::Handle NodeRegistry::add(Node *node)
+{
+    uint32_t index;
+    if (!_free.empty())
+    {
+        index = _free.back();
+        _free.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)_slots.size();
+        Slot slot;
+        slot.node = NULL;
+        slot.generation = 0;
+        _slots.push_back(slot);
+    }
+    Slot &slot = _slots[index];
+    slot.node = node;
+    node->addRef();
+    // Generation 0 is reserved for invalid handles
+    if (++slot.generation == 0)
+    {
+        slot.generation = 1;
+    }
+    _index.insert(make_pair(hashId(node->getId()), index));
+
+    Handle handle;
+    handle.index = index;
+    handle.generation = slot.generation;
+    return handle;
+}
+
+//----------------------------------------------------------------------
+//
+// remove()
+//
+//----------------------------------------------------------------------
+void NodeRegistry::remove(Node *node)
+{
+    pair<multimap<uint32_t, uint32_t>::iterator, multimap<uint32_t, uint32_t>::iterator> range = _index.equal_range(hashId(node->getId()));
+    for (multimap<uint32_t, uint32_t>::iterator it = range.first; it != range.second; it++)
+    {
+        Slot &slot = _slots[it->second];
+        if (slot.node == node)
+        {
+            SAFE_RELEASE(slot.node);
+            if (++slot.generation == 0)
+            {
+                slot.generation = 1;
+            }
+            _free.push_back(it->second);
+            _index.erase(it);
+            return;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// clear()
+//
+//----------------------------------------------------------------------
+void NodeRegistry::clear()
+{
+    for (size_t i = 0; i < _slots.size(); i++)
+    {
+        if (_slots[i].node)
+        {
+            SAFE_RELEASE(_slots[i].node);
+            if (++_slots[i].generation == 0)
+            {
+                _slots[i].generation = 1;
+            }
+            _free.push_back((uint32_t)i);
+        }
+    }
+    _index.clear();
+}
+
+//----------------------------------------------------------------------
+//
+// find()
+//
+//----------------------------------------------------------------------
+NodeRegistry::Handle NodeRegistry::find(const char *id, const Node *ancestor) const
+{
+    Handle handle;
+    if (!id)
+    {
+        return handle;
+    }
+    pair<multimap<uint32_t, uint32_t>::const_iterator, multimap<uint32_t, uint32_t>::const_iterator> range = _index.equal_range(hashId(id));
+    for (multimap<uint32_t, uint32_t>::const_iterator it = range.first; it != range.second; it++)
+    {
+        const Slot &slot = _slots[it->second];
+        const char *node_id = slot.node->getId();
+        if (!node_id || strcmp(node_id, id) != 0)
+        {
+            // Hash collision
+            continue;
+        }
+        if (ancestor)
+        {
+            const Node *parent = slot.node;
+            while (parent && parent != ancestor)
+            {
+                parent = parent->getParent();
+            }
+            if (!parent)
+            {
+                continue;
+            }
+        }
+        handle.index = it->second;
+        handle.generation = slot.generation;
+        return handle;
+    }
+    return handle;
+}
+
+//----------------------------------------------------------------------
+//
+// hashId()
+//
+//----------------------------------------------------------------------
+uint32_t NodeRegistry::hashId(const char *id)
+{
+    uint32_t value = 2166136261u;
+    for (const char *p = id ? id : ""; *p; p++)
+    {
+        value ^= (unsigned char)*p;
+        value *= 16777619u;
+    }
+    return value;
+}
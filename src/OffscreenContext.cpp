@@ -0,0 +1,212 @@
+//
+//  OffscreenContext.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "OffscreenContext.h"
+
+/**
+ * Most EGL devices tried.
+ */
+static const EGLint kMaxDevices = 16;
+
+//----------------------------------------------------------------------
+//
+// getDeviceDisplay()
+//
+// First EGL device that initializes, EGL_NO_DISPLAY if the extension is
+// missing or no device works.
+//
+//----------------------------------------------------------------------
+static EGLDisplay getDeviceDisplay()
+{
+    PFNEGLQUERYDEVICESEXTPROC queryDevices = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!queryDevices || !getPlatformDisplay)
+    {
+        return EGL_NO_DISPLAY;
+    }
+    EGLDeviceEXT devices[kMaxDevices];
+    EGLint count = 0;
+    if (!queryDevices(kMaxDevices, devices, &count))
+    {
+        return EGL_NO_DISPLAY;
+    }
+    for (EGLint i = 0; i < count; i++)
+    {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], NULL);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+        {
+            return display;
+        }
+    }
+    return EGL_NO_DISPLAY;
+}
+
+//----------------------------------------------------------------------
+//
+// OffscreenContext()
+//
+//----------------------------------------------------------------------
+OffscreenContext::OffscreenContext() :
+    _display(NULL),
+    _surface(NULL),
+    _context(NULL)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// ~OffscreenContext()
+//
+//----------------------------------------------------------------------
+OffscreenContext::~OffscreenContext()
+{
+    destroy();
+}
+
+//----------------------------------------------------------------------
+//
+// create()
+//
+//----------------------------------------------------------------------
+bool OffscreenContext::create(unsigned int width, unsigned int height)
+{
+    destroy();
+    EGLDisplay display = getDeviceDisplay();
+    if (display == EGL_NO_DISPLAY)
+    {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+        {
+#if DEBUG
+            fprintf(stderr, "[ERROR] No EGL display\n");
+#endif // DEBUG
+            return false;
+        }
+    }
+    _display = display;
+
+    const EGLint configAttributes[] =
+    {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint count = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &count) || count == 0)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] No EGL config with a desktop GL pbuffer\n");
+#endif // DEBUG
+        destroy();
+        return false;
+    }
+    const EGLint surfaceAttributes[] =
+    {
+        EGL_WIDTH, (EGLint)width,
+        EGL_HEIGHT, (EGLint)height,
+        EGL_NONE
+    };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (surface == EGL_NO_SURFACE)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] EGL pbuffer not created (0x%x)\n", eglGetError());
+#endif // DEBUG
+        destroy();
+        return false;
+    }
+    _surface = surface;
+
+    // GamePlay's desktop renderer is written against desktop GL
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] EGL context not created (0x%x)\n", eglGetError());
+#endif // DEBUG
+        if (context != EGL_NO_CONTEXT)
+        {
+            eglDestroyContext(display, context);
+        }
+        destroy();
+        return false;
+    }
+    _context = context;
+
+#ifndef OPENGL_ES
+    // Newer GLEW reports the missing GLX display but still loads the GL
+    // entry points, which is all that is needed here
+    glewExperimental = GL_TRUE;
+    glewInit();
+    if (!glGenFramebuffers)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] GL entry points not loaded\n");
+#endif // DEBUG
+        destroy();
+        return false;
+    }
+#endif // OPENGL_ES
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Offscreen context on \"%s\"\n", getRenderer());
+#endif // DEBUG
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// destroy()
+//
+//----------------------------------------------------------------------
+void OffscreenContext::destroy()
+{
+    if (!_display)
+    {
+        return;
+    }
+    eglMakeCurrent((EGLDisplay)_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (_context)
+    {
+        eglDestroyContext((EGLDisplay)_display, (EGLContext)_context);
+        _context = NULL;
+    }
+    if (_surface)
+    {
+        eglDestroySurface((EGLDisplay)_display, (EGLSurface)_surface);
+        _surface = NULL;
+    }
+    eglTerminate((EGLDisplay)_display);
+    _display = NULL;
+}
+
+//----------------------------------------------------------------------
+//
+// getRenderer()
+//
+//----------------------------------------------------------------------
+const char *OffscreenContext::getRenderer() const
+{
+    const GLubyte *renderer = _context ? glGetString(GL_RENDERER) : NULL;
+    return renderer ? (const char*)renderer : "";
+}
@@ -0,0 +1,224 @@
+//
+//  Profiler.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+
+#include <chrono>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include "Profiler.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+thread_local uint32_t ProfileZone::_thread_depth = 0;
+
+/**
+ * Ring of the calling thread, NULL until its first zone.
+ */
+static thread_local void *t_ring = NULL;
+
+//----------------------------------------------------------------------
+//
+// getInstance()
+//
+//----------------------------------------------------------------------
+Profiler &Profiler::getInstance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+//----------------------------------------------------------------------
+//
+// Profiler()
+//
+//----------------------------------------------------------------------
+Profiler::Profiler() :
+    _main_ring(NULL),
+    _capture_frames(0),
+    _dropped(0)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// now()
+//
+//----------------------------------------------------------------------
+uint64_t Profiler::now()
+{
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//----------------------------------------------------------------------
+//
+// getRing()
+//
+//----------------------------------------------------------------------
+Profiler::ThreadRing *Profiler::getRing()
+{
+    if (!t_ring)
+    {
+        ThreadRing *ring = new ThreadRing();
+        lock_guard<mutex> lock(_mutex);
+        ring->thread = (uint32_t)_rings.size();
+        _rings.push_back(ring);
+        t_ring = ring;
+    }
+    return (ThreadRing*)t_ring;
+}
+
+//----------------------------------------------------------------------
+//
+// record()
+//
+//----------------------------------------------------------------------
+void Profiler::record(const Event &event)
+{
+    ThreadRing *ring = getRing();
+    uint32_t head = ring->head.load(memory_order_relaxed);
+    if (head - ring->tail.load(memory_order_acquire) >= kRingSize)
+    {
+        _dropped++;
+        return;
+    }
+    ring->events[head & (kRingSize - 1)] = event;
+    ring->head.store(head + 1, memory_order_release);
+}
+
+//----------------------------------------------------------------------
+//
+// endFrame()
+//
+//----------------------------------------------------------------------
+void Profiler::endFrame()
+{
+    if (!_main_ring)
+    {
+        _main_ring = getRing();
+    }
+    _frame_zones.clear();
+
+    vector<ThreadRing*> rings;
+    {
+        lock_guard<mutex> lock(_mutex);
+        rings = _rings;
+    }
+    for (size_t r = 0; r < rings.size(); r++)
+    {
+        ThreadRing *ring = rings[r];
+        uint32_t tail = ring->tail.load(memory_order_relaxed);
+        uint32_t head = ring->head.load(memory_order_acquire);
+        for (; tail != head; tail++)
+        {
+            const Event &event = ring->events[tail & (kRingSize - 1)];
+            if (ring == _main_ring)
+            {
+                size_t z = 0;
+                while (z < _frame_zones.size() && (_frame_zones[z].name != event.name || _frame_zones[z].depth != event.depth))
+                {
+                    z++;
+                }
+                if (z == _frame_zones.size())
+                {
+                    ZoneTime zone;
+                    zone.name = event.name;
+                    zone.depth = event.depth;
+                    zone.count = 0;
+                    zone.milliseconds = 0.0;
+                    zone.start = event.start;
+                    _frame_zones.push_back(zone);
+                }
+                if (event.start < _frame_zones[z].start)
+                {
+                    _frame_zones[z].start = event.start;
+                }
+                _frame_zones[z].count++;
+                _frame_zones[z].milliseconds += (event.end - event.start) / 1000000.0;
+            }
+            if (_capture_frames > 0)
+            {
+                _capture.push_back(event);
+                _capture_threads.push_back(ring->thread);
+            }
+        }
+        ring->tail.store(tail, memory_order_release);
+    }
+
+    // Zones end (and are recorded) inside out, list them by first entry so
+    // every zone follows its parent
+    for (size_t i = 1; i < _frame_zones.size(); i++)
+    {
+        for (size_t j = i; j > 0 && _frame_zones[j].start < _frame_zones[j - 1].start; j--)
+        {
+            swap(_frame_zones[j], _frame_zones[j - 1]);
+        }
+    }
+
+    if (_capture_frames > 0 && --_capture_frames == 0)
+    {
+        writeTrace();
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// startCapture()
+//
+//----------------------------------------------------------------------
+void Profiler::startCapture(unsigned int frames, const string &path)
+{
+    _capture.clear();
+    _capture_threads.clear();
+    _capture_frames = frames;
+    _capture_path = path;
+}
+
+//----------------------------------------------------------------------
+//
+// writeTrace()
+//
+//----------------------------------------------------------------------
+void Profiler::writeTrace()
+{
+    FILE *file = fopen(_capture_path.c_str(), "w");
+    if (!file)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] Trace \"%s\" not written\n", _capture_path.c_str());
+#endif // DEBUG
+        return;
+    }
+    uint64_t origin = 0;
+    for (size_t i = 0; i < _capture.size(); i++)
+    {
+        if (i == 0 || _capture[i].start < origin)
+        {
+            origin = _capture[i].start;
+        }
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < _capture.size(); i++)
+    {
+        const Event &event = _capture[i];
+        fprintf(file, "{\"name\":\"%s\",\"cat\":\"frcsim\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+                event.name, _capture_threads[i], (event.start - origin) / 1000.0, (event.end - event.start) / 1000.0,
+                (i + 1 < _capture.size()) ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Wrote %lu zones to trace \"%s\"\n", (unsigned long)_capture.size(), _capture_path.c_str());
+#endif // DEBUG
+    _capture.clear();
+    _capture_threads.clear();
+}
@@ -0,0 +1,58 @@
+//
+//  RenderQueue.cpp
+//  FrcSim
+//
+//
+
+#include <cstring>
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "RenderQueue.h"
+
+/**
+ * Orders draws by sort key.
+ */
+struct KeyLess
+{
+    bool operator()(const RenderQueue::Draw &a, const RenderQueue::Draw &b) const
+    {
+        return a.key < b.key;
+    }
+};
+
+//----------------------------------------------------------------------
+//
+// sort()
+//
+//----------------------------------------------------------------------
+void RenderQueue::sort(const Vector3 &eye, const Vector3 &forward, bool backToFront)
+{
+    for (size_t i = 0; i < _draws.size(); i++)
+    {
+        Draw &draw = _draws[i];
+        float depth = Vector3::dot(draw.node->getBoundingSphere().center - eye, forward);
+        if (!(depth > 0.0f))
+        {
+            depth = 0.0f;
+        }
+        unsigned int bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        if (backToFront)
+        {
+            draw.key = (unsigned long long)(~bits);
+        }
+        else
+        {
+            draw.key = ((unsigned long long)draw.state << 32) | bits;
+        }
+    }
+    std::sort(_draws.begin(), _draws.end(), KeyLess());
+}
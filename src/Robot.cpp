@@ -36,6 +36,7 @@ using namespace gameplay;
 
 #include "json/IJsonSerializable.h"
 #include "Robot.h"
+#include "MatchInput.h"
 #include "FrcSim.h"
 
 #ifdef ANDROID
@@ -54,7 +55,8 @@ Robot::Robot() :
     _velocity_setpoint(0.0),
     _max_acceleration(0.0),
     _max_velocity(0.0),
-    _mass(0.0)
+    _mass(0.0),
+    _load_model(true)
 {
 }
 
@@ -72,11 +74,14 @@ Robot::Robot(const Robot &robot) :
     _velocity_setpoint(robot._velocity_setpoint),
     _max_acceleration(robot._max_acceleration),
     _max_velocity(robot._max_velocity),
-    _mass(robot._mass)
+    _mass(robot._mass),
+    _mechanism(robot._mechanism),
+    _load_model(robot._load_model)
 {
     if (robot._robot_node)
     {
         _robot_node = robot._robot_node->clone();
+        _mechanism.bind(_robot_node);
     }
 }
 
@@ -91,11 +96,46 @@ Robot::Robot(const GFileName &configFile) :
     _velocity_setpoint(0.0),
     _max_acceleration(0.0),
     _max_velocity(0.0),
-    _mass(0.0)
+    _mass(0.0),
+    _load_model(true)
 {
     LoadConfig(configFile);
 }
 
+//----------------------------------------------------------------------
+//
+// Robot()
+//
+//----------------------------------------------------------------------
+Robot::Robot(const GFileName &configFile, bool loadModel) :
+    _robot_node(NULL),
+    _velocity(0.0),
+    _velocity_setpoint(0.0),
+    _max_acceleration(0.0),
+    _max_velocity(0.0),
+    _mass(0.0),
+    _load_model(loadModel)
+{
+    LoadConfig(configFile);
+}
+
+//----------------------------------------------------------------------
+//
+// Robot()
+//
+//----------------------------------------------------------------------
+Robot::Robot(Json::Value &root, bool loadModel) :
+    _robot_node(NULL),
+    _velocity(0.0),
+    _velocity_setpoint(0.0),
+    _max_acceleration(0.0),
+    _max_velocity(0.0),
+    _mass(0.0),
+    _load_model(loadModel)
+{
+    Deserialize(root);
+}
+
 //----------------------------------------------------------------------
 //
 // LoadConfig()
@@ -103,29 +143,95 @@ Robot::Robot(const GFileName &configFile) :
 //----------------------------------------------------------------------
 void Robot::LoadConfig(const GFileName &filename)
 {
-    std::string jsonInput;
-    std::ifstream inFile;
-    inFile.open((const char*)(GFileName(FileSystem::getResourcePath()) + filename), std::ios_base::in);
-    if (inFile)
+    GFileName path = GFileName(FileSystem::getResourcePath()) + filename;
+    CookedCache cache((const char*)path, CookedCache::ROBOT_CONFIG);
+    if (!cache.hasSource())
     {
-        inFile.seekg(0, std::ios::end);
-        unsigned long length = inFile.tellg();
-        jsonInput.resize(length);
-        inFile.seekg(0, std::ios::beg);
-        inFile.read(&jsonInput[0], jsonInput.size());
-        inFile.close();
-        
-        Json::Value root;
-        Json::Reader reader;
-        if ( !reader.parse(jsonInput, root) )
-        {
 #if DEBUG
-            fprintf(stderr, "[ERROR] File \"%s\" not parsed\n", (const char*)filename);
+        fprintf(stderr, "[ERROR] File \"%s\" not opened\n", (const char*)filename);
 #endif // DEBUG
+        return;
+    }
+    if (cache.isCooked())
+    {
+        CookedCache::Reader reader = cache.getReader();
+        if (ReadCooked(reader))
+        {
+            if (_load_model)
+            {
+                LoadModel();
+            }
             return;
         }
-        Deserialize(root);
     }
+    
+    Json::Value root;
+    Json::Reader reader;
+    if ( !reader.parse(cache.getSource(), cache.getSource() + cache.getSourceSize(), root) )
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] File \"%s\" not parsed\n", (const char*)filename);
+#endif // DEBUG
+        return;
+    }
+    Deserialize(root);
+    CookedCache::Writer writer;
+    Cook(writer);
+    cache.save(writer);
+}
+
+//----------------------------------------------------------------------
+//
+// Cook()
+//
+//----------------------------------------------------------------------
+void Robot::Cook(CookedCache::Writer &writer) const
+{
+    writer.putString((const char*)_bundle_file);
+    writer.putString((const char*)_texture_map_file);
+    writer.putString((const char*)_top_node_id);
+    writer.putDouble(_origin_offset.x);
+    writer.putDouble(_origin_offset.y);
+    writer.putDouble(_origin_offset.z);
+    writer.putDouble(_position.x);
+    writer.putDouble(_position.y);
+    writer.putDouble(_position.z);
+    writer.putDouble(_rotation.x);
+    writer.putDouble(_rotation.y);
+    writer.putDouble(_rotation.z);
+    writer.putDouble(_velocity);
+    writer.putDouble(_velocity_setpoint);
+    writer.putDouble(_max_acceleration);
+    writer.putDouble(_max_velocity);
+    writer.putDouble(_mass);
+    _mechanism.Cook(writer);
+}
+
+//----------------------------------------------------------------------
+//
+// ReadCooked()
+//
+//----------------------------------------------------------------------
+bool Robot::ReadCooked(CookedCache::Reader &reader)
+{
+    _bundle_file = reader.getString();
+    _texture_map_file = reader.getString();
+    _top_node_id = reader.getString();
+    _origin_offset.x = reader.getDouble();
+    _origin_offset.y = reader.getDouble();
+    _origin_offset.z = reader.getDouble();
+    _position.x = reader.getDouble();
+    _position.y = reader.getDouble();
+    _position.z = reader.getDouble();
+    _rotation.x = reader.getDouble();
+    _rotation.y = reader.getDouble();
+    _rotation.z = reader.getDouble();
+    _velocity = reader.getDouble();
+    _velocity_setpoint = reader.getDouble();
+    _max_acceleration = reader.getDouble();
+    _max_velocity = reader.getDouble();
+    _mass = reader.getDouble();
+    return _mechanism.ReadCooked(reader) && reader.isAtEnd();
 }
 
 //----------------------------------------------------------------------
@@ -135,11 +241,8 @@ void Robot::LoadConfig(const GFileName &filename)
 //----------------------------------------------------------------------
 void Robot::update(float elapsedTime) throw(GNullPointerException)
 {
-    if (!_robot_node)
-    {
-        return;
-    }
-    if (_velocity_setpoint < _velocity)
+    _mechanism.update(elapsedTime);
+    if (_velocity_setpoint > _velocity)
     {
         _velocity += (_max_acceleration * elapsedTime);
         if (_velocity > _velocity_setpoint)
@@ -155,6 +258,14 @@ void Robot::update(float elapsedTime) throw(GNullPointerException)
             _velocity = _velocity_setpoint;
         }
     }
+    if (!_robot_node)
+    {
+        // Headless, no physics to move the robot so drive along the yaw
+        float yaw = MATH_DEG_TO_RAD(getYaw());
+        _position.x += (float)(sin(yaw) * _velocity * elapsedTime);
+        _position.z += (float)(cos(yaw) * _velocity * elapsedTime);
+        return;
+    }
     _position = _robot_node->getTranslationWorld();
     PhysicsCharacter* character = dynamic_cast<PhysicsCharacter*>(_robot_node->getCollisionObject());
     if (character)
@@ -169,10 +280,6 @@ void Robot::update(float elapsedTime) throw(GNullPointerException)
         {
             character->setForwardVelocity(_velocity);
         }
-#ifdef DEBUG
-        Vector3 velocity = character->getCurrentVelocity();
-        fprintf(stderr, "[Debug] %5.2f: Robot facing is %5.2f, distance: %4.2f, velocity: (%f, %f, %f), location: (%5.2f, %5.2f, %5.2f)\n", elapsedTime, getYaw(), _velocity, velocity.x, velocity.y, velocity.z, _position.x, _position.y, _position.z);
-#endif // DEBUG
     }
 }
 
@@ -216,6 +323,82 @@ void Robot::setYaw(float yaw)
     _rotation.z = yaw;
 }
 
+//----------------------------------------------------------------------
+//
+// setPosition()
+//
+//----------------------------------------------------------------------
+void Robot::setPosition(const Vector3 &position)
+{
+    _position = position;
+}
+
+//----------------------------------------------------------------------
+//
+// setVelocityState()
+//
+//----------------------------------------------------------------------
+void Robot::setVelocityState(double velocity, double setpoint)
+{
+    _velocity = velocity;
+    _velocity_setpoint = setpoint;
+}
+
+//----------------------------------------------------------------------
+//
+// getState()
+//
+//----------------------------------------------------------------------
+void Robot::getState(State &state) const
+{
+    state.position = _position;
+    state.rotation = _rotation;
+    state.velocity = _velocity;
+    state.velocitySetpoint = _velocity_setpoint;
+}
+
+//----------------------------------------------------------------------
+//
+// setState()
+//
+//----------------------------------------------------------------------
+void Robot::setState(const State &state)
+{
+    _position = state.position;
+    _rotation = state.rotation;
+    _velocity = state.velocity;
+    _velocity_setpoint = state.velocitySetpoint;
+}
+
+//----------------------------------------------------------------------
+//
+// capture()
+//
+//----------------------------------------------------------------------
+void Robot::capture(Snapshot &snapshot) const
+{
+    State state;
+    getState(state);
+    snapshot.put(state);
+    _mechanism.capture(snapshot);
+}
+
+//----------------------------------------------------------------------
+//
+// restore()
+//
+//----------------------------------------------------------------------
+bool Robot::restore(Snapshot &snapshot)
+{
+    State state;
+    if (!snapshot.get(state))
+    {
+        return false;
+    }
+    setState(state);
+    return _mechanism.restore(snapshot);
+}
+
 //----------------------------------------------------------------------
 //
 // Serialize()
@@ -223,6 +406,24 @@ void Robot::setYaw(float yaw)
 //----------------------------------------------------------------------
 void Robot::Serialize(Json::Value &root) const
 {
+    root["bundle"] = (const char*)_bundle_file;
+    root["textureMap"] = (const char*)_texture_map_file;
+    root["topNodeId"] = (const char*)_top_node_id;
+    root["originOffsetX"] = _origin_offset.x;
+    root["originOffsetY"] = _origin_offset.y;
+    root["originOffsetZ"] = _origin_offset.z;
+    root["positionX"] = _position.x;
+    root["positionY"] = _position.y;
+    root["positionZ"] = _position.z;
+    root["rotationX"] = _rotation.x;
+    root["rotationY"] = _rotation.y;
+    root["rotationZ"] = _rotation.z;
+    root["velocity"] = _velocity;
+    root["velocitySetpoint"] = _velocity_setpoint;
+    root["maxAcceleration"] = _max_acceleration;
+    root["maxVelocity"] = _max_velocity;
+    root["mass"] = _mass;
+    _mechanism.Serialize(root["motionList"]);
 }
 
 //----------------------------------------------------------------------
@@ -249,6 +450,20 @@ void Robot::Deserialize(Json::Value &root)
     _max_acceleration = root.get("maxAcceleration", 0.0).asDouble();
     _max_velocity = root.get("maxVelocity", 0.0).asDouble();
     _mass = root.get("mass", 0.0).asDouble();
+    _mechanism.Deserialize(root.get("motionList", Json::Value::null));
+    if (_load_model)
+    {
+        LoadModel();
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// LoadModel()
+//
+//----------------------------------------------------------------------
+void Robot::LoadModel()
+{
     // load robot
 #ifdef DEBUG
     fprintf(stderr, "[Debug] Loading robot model from GPB \"%s\"\n", (const char*)_bundle_file);
@@ -274,6 +489,7 @@ void Robot::Deserialize(Json::Value &root)
         robot_h->addChild(robot_v);
         robot_v->addChild(robot);
         robot->setTranslation(_origin_offset);
+        _mechanism.bind(robot);
 #ifdef DEBUG
         if (_robot_node)
         {
@@ -327,9 +543,12 @@ Robot &Robot::operator=(const Robot &robot)
         _velocity_setpoint = robot._velocity_setpoint;
         _max_acceleration = robot._max_acceleration;
         _max_velocity = robot._max_velocity;
+        _mechanism = robot._mechanism;
+        _load_model = robot._load_model;
         if (robot._robot_node)
         {
             _robot_node = robot._robot_node->clone();
+            _mechanism.bind(_robot_node);
         }
     }
     return *this;
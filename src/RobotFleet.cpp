@@ -0,0 +1,225 @@
+//
+//  RobotFleet.cpp
+//  FrcSim
+//
+//
+
+#include <cmath>
+
+#include <map>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRCSIM_SSE2 1
+#endif
+
+#include <json/json.h>
+
+#include <ghoul/GString.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "Robot.h"
+#include "RobotFleet.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+//----------------------------------------------------------------------
+//
+// RobotFleet()
+//
+//----------------------------------------------------------------------
+RobotFleet::RobotFleet()
+{
+}
+
+//----------------------------------------------------------------------
+//
+// add()
+//
+//----------------------------------------------------------------------
+unsigned int RobotFleet::add(Robot *robot)
+{
+    unsigned int index = (unsigned int)_robots.size();
+    _robots.push_back(robot);
+    Node *node = robot->_robot_node;
+    _nodes.push_back(node);
+    _characters.push_back(node ? dynamic_cast<PhysicsCharacter*>(node->getCollisionObject()) : NULL);
+    _velocity.push_back(robot->_velocity);
+    _setpoint.push_back(robot->_velocity_setpoint);
+    _max_acceleration.push_back(robot->_max_acceleration);
+    _max_velocity.push_back(robot->_max_velocity);
+    _position_x.push_back(robot->_position.x);
+    _position_y.push_back(robot->_position.y);
+    _position_z.push_back(robot->_position.z);
+    _yaw.push_back(0.0f);
+    _heading_x.push_back(0.0f);
+    _heading_z.push_back(1.0f);
+    setYaw(index, robot->getYaw());
+    return index;
+}
+
+//----------------------------------------------------------------------
+//
+// clear()
+//
+//----------------------------------------------------------------------
+void RobotFleet::clear()
+{
+    _robots.clear();
+    _nodes.clear();
+    _characters.clear();
+    _velocity.clear();
+    _setpoint.clear();
+    _max_acceleration.clear();
+    _max_velocity.clear();
+    _position_x.clear();
+    _position_y.clear();
+    _position_z.clear();
+    _yaw.clear();
+    _heading_x.clear();
+    _heading_z.clear();
+}
+
+//----------------------------------------------------------------------
+//
+// setVelocity()
+//
+//----------------------------------------------------------------------
+void RobotFleet::setVelocity(unsigned int index, float velocityPercent)
+{
+    _setpoint[index] = velocityPercent * _max_velocity[index];
+    _robots[index]->_velocity_setpoint = _setpoint[index];
+}
+
+//----------------------------------------------------------------------
+//
+// setYaw()
+//
+//----------------------------------------------------------------------
+void RobotFleet::setYaw(unsigned int index, float yaw)
+{
+    _yaw[index] = yaw;
+    float radians = MATH_DEG_TO_RAD(yaw);
+    _heading_x[index] = sin(radians);
+    _heading_z[index] = cos(radians);
+    _robots[index]->setYaw(yaw);
+}
+
+//----------------------------------------------------------------------
+//
+// rampVelocities()
+//
+// Same result as the branches of Robot::update():
+//
+//     v' = (setpoint > v) ? min(v + a * dt, setpoint) : max(v - a * dt, setpoint)
+//
+// computed for both sides and blended with a comparison mask.
+//
+//----------------------------------------------------------------------
+void RobotFleet::rampVelocities(double elapsedTime)
+{
+    size_t count = _velocity.size();
+    double *velocity = count ? &_velocity[0] : NULL;
+    const double *setpoint = count ? &_setpoint[0] : NULL;
+    const double *acceleration = count ? &_max_acceleration[0] : NULL;
+    size_t i = 0;
+#ifdef FRCSIM_SSE2
+    __m128d dt = _mm_set1_pd(elapsedTime);
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d v = _mm_loadu_pd(velocity + i);
+        __m128d sp = _mm_loadu_pd(setpoint + i);
+        __m128d step = _mm_mul_pd(_mm_loadu_pd(acceleration + i), dt);
+        __m128d above = _mm_min_pd(_mm_add_pd(v, step), sp);
+        __m128d below = _mm_max_pd(_mm_sub_pd(v, step), sp);
+        __m128d mask = _mm_cmpgt_pd(sp, v);
+        _mm_storeu_pd(velocity + i, _mm_or_pd(_mm_and_pd(mask, above), _mm_andnot_pd(mask, below)));
+    }
+#endif // FRCSIM_SSE2
+    for (; i < count; i++)
+    {
+        double step = acceleration[i] * elapsedTime;
+        double above = min(velocity[i] + step, setpoint[i]);
+        double below = max(velocity[i] - step, setpoint[i]);
+        velocity[i] = (setpoint[i] > velocity[i]) ? above : below;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// update()
+//
+//----------------------------------------------------------------------
+void RobotFleet::update(float elapsedTime)
+{
+    rampVelocities(elapsedTime);
+
+    size_t count = _robots.size();
+
+    // Bullet and the scene graph, on this thread: getTranslationWorld()
+    // may rebuild cached world matrices
+    for (size_t i = 0; i < count; i++)
+    {
+        Node *node = _nodes[i];
+        if (!node)
+        {
+            continue;
+        }
+        PhysicsCharacter *character = _characters[i];
+        if (character)
+        {
+            if (_velocity[i] == 0.0)
+            {
+                character->setVelocity(Vector3::zero());
+                character->setForwardVelocity(0.0);
+                character->setRightVelocity(0.0);
+            }
+            else
+            {
+                character->setForwardVelocity(_velocity[i]);
+            }
+        }
+        const Vector3 &translation = node->getTranslationWorld();
+        _position_x[i] = translation.x;
+        _position_y[i] = translation.y;
+        _position_z[i] = translation.z;
+    }
+
+    // Headless robots drive along their yaw, plain arrays only
+    JobSystem::getInstance().parallelFor(0, count, kRobotsPerJob, [this, elapsedTime](size_t begin, size_t end)
+    {
+        PROFILE_ZONE("RobotFleet::update");
+        for (size_t i = begin; i < end; i++)
+        {
+            if (!_nodes[i])
+            {
+                float distance = (float)(_velocity[i] * elapsedTime);
+                _position_x[i] += _heading_x[i] * distance;
+                _position_z[i] += _heading_z[i] * distance;
+            }
+        }
+    });
+
+    // Write back so the Robot getters stay current; mechanisms move nodes
+    for (size_t i = 0; i < count; i++)
+    {
+        Robot *robot = _robots[i];
+        robot->_velocity = _velocity[i];
+        robot->_position.set(_position_x[i], _position_y[i], _position_z[i]);
+        robot->_mechanism.update(elapsedTime);
+    }
+}
@@ -0,0 +1,406 @@
+//
+//  SceneBVH.cpp
+//  FrcSim
+//
+//
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "SceneBVH.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+/**
+ * Orders items by their center along one axis.
+ */
+struct CenterLess
+{
+    CenterLess(int a) : axis(a) {}
+
+    bool operator()(const SceneBVH::Item &a, const SceneBVH::Item &b) const
+    {
+        const Vector3 &ca = a.bounds.center;
+        const Vector3 &cb = b.bounds.center;
+        return (axis == 0 ? ca.x < cb.x : (axis == 1 ? ca.y < cb.y : ca.z < cb.z));
+    }
+
+    int axis;
+};
+
+//----------------------------------------------------------------------
+//
+// SceneBVH()
+//
+//----------------------------------------------------------------------
+SceneBVH::SceneBVH() :
+    _built(false)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// build()
+//
+//----------------------------------------------------------------------
+void SceneBVH::build(const vector<Item> &staticItems, const vector<Item> &dynamicItems)
+{
+    clear();
+    _items = staticItems;
+    _dynamic = dynamicItems;
+    if (!_items.empty())
+    {
+        _nodes.reserve(2 * (_items.size() / kLeafSize + 1));
+        buildNode(0, (unsigned int)_items.size());
+    }
+    _built = true;
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Scene BVH with %lu static nodes in %lu hierarchy nodes, %lu dynamic nodes\n", (unsigned long)_items.size(), (unsigned long)_nodes.size(), (unsigned long)_dynamic.size());
+#endif // DEBUG
+}
+
+//----------------------------------------------------------------------
+//
+// clear()
+//
+//----------------------------------------------------------------------
+void SceneBVH::clear()
+{
+    _items.clear();
+    _dynamic.clear();
+    _nodes.clear();
+    _built = false;
+}
+
+//----------------------------------------------------------------------
+//
+// buildNode()
+//
+//----------------------------------------------------------------------
+unsigned int SceneBVH::buildNode(unsigned int first, unsigned int count)
+{
+    unsigned int index = (unsigned int)_nodes.size();
+    _nodes.push_back(BVHNode());
+
+    BoundingSphere bounds = _items[first].bounds;
+    Vector3 low = bounds.center;
+    Vector3 high = bounds.center;
+    for (unsigned int i = first + 1; i < first + count; i++)
+    {
+        const BoundingSphere &sphere = _items[i].bounds;
+        bounds = merge(bounds, sphere);
+        low.set(min(low.x, sphere.center.x), min(low.y, sphere.center.y), min(low.z, sphere.center.z));
+        high.set(max(high.x, sphere.center.x), max(high.y, sphere.center.y), max(high.z, sphere.center.z));
+    }
+    _nodes[index].bounds = bounds;
+
+    if (count <= kLeafSize)
+    {
+        _nodes[index].first = first;
+        _nodes[index].count = count;
+        _nodes[index].right = 0;
+        return index;
+    }
+
+    // Median split along the longest extent of the centers
+    Vector3 extent = high - low;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    unsigned int half = count / 2;
+    nth_element(_items.begin() + first, _items.begin() + first + half, _items.begin() + first + count, CenterLess(axis));
+
+    buildNode(first, half);
+    unsigned int right = buildNode(first + half, count - half);
+    _nodes[index].first = 0;
+    _nodes[index].count = 0;
+    _nodes[index].right = right;
+    return index;
+}
+
+//----------------------------------------------------------------------
+//
+// merge()
+//
+//----------------------------------------------------------------------
+BoundingSphere SceneBVH::merge(const BoundingSphere &a, const BoundingSphere &b)
+{
+    Vector3 offset = b.center - a.center;
+    float distance = offset.length();
+    if (distance + b.radius <= a.radius)
+    {
+        return a;
+    }
+    if (distance + a.radius <= b.radius)
+    {
+        return b;
+    }
+    float radius = (distance + a.radius + b.radius) * 0.5f;
+    Vector3 center = a.center + offset * ((radius - a.radius) / distance);
+    return BoundingSphere(center, radius);
+}
+
+//----------------------------------------------------------------------
+//
+// classify()
+//
+//----------------------------------------------------------------------
+SceneBVH::Containment SceneBVH::classify(const BoundingSphere &sphere, const Frustum &frustum)
+{
+    const Plane *planes[6] = { &frustum.getNear(), &frustum.getFar(), &frustum.getLeft(),
+                               &frustum.getRight(), &frustum.getTop(), &frustum.getBottom() };
+    Containment result = INSIDE;
+    for (int i = 0; i < 6; i++)
+    {
+        // Frustum plane normals point inside
+        float distance = planes[i]->distance(sphere.center);
+        if (distance < -sphere.radius)
+        {
+            return OUTSIDE;
+        }
+        if (distance < sphere.radius)
+        {
+            result = PARTIAL;
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------
+//
+// classify()
+//
+//----------------------------------------------------------------------
+void SceneBVH::classify(const BoundingSphere &sphere, const View *views, unsigned int &visible, unsigned int &check)
+{
+    unsigned int pending = check;
+    for (unsigned int v = 0; v < kMaxViews && (pending >> v); v++)
+    {
+        unsigned int bit = 1u << v;
+        if (!(pending & bit))
+        {
+            continue;
+        }
+        Containment containment = classify(sphere, *views[v].frustum);
+        if (containment == OUTSIDE)
+        {
+            visible &= ~bit;
+            check &= ~bit;
+        }
+        else if (containment == INSIDE)
+        {
+            check &= ~bit;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// emit()
+//
+//----------------------------------------------------------------------
+void SceneBVH::emit(const Item &item, const View *views, unsigned int mask)
+{
+    if (!mask)
+    {
+        return;
+    }
+    for (unsigned int v = 0; v < kMaxViews && (mask >> v); v++)
+    {
+        if (mask & (1u << v))
+        {
+            (item.transparent ? views[v].transparent : views[v].opaque)->push(item.node, item.state, item.binding);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// cull()
+//
+//----------------------------------------------------------------------
+void SceneBVH::cull(const Frustum &frustum, bool test, RenderQueue &opaque, RenderQueue &transparent) const
+{
+    View view(&frustum, &opaque, &transparent);
+    cull(&view, 1, test);
+}
+
+//----------------------------------------------------------------------
+//
+// cull()
+//
+//----------------------------------------------------------------------
+void SceneBVH::cull(const View *views, unsigned int count, bool test) const
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (count > kMaxViews)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] %u views culled, only the first %u are used\n", count, kMaxViews);
+#endif // DEBUG
+        count = kMaxViews;
+    }
+    unsigned int all = (count == kMaxViews) ? ~0u : ((1u << count) - 1);
+
+    if (!_nodes.empty())
+    {
+        _subtrees.clear();
+        _subtrees.push_back(Subtree(0, all, test ? all : 0));
+        if (_items.size() >= kParallelItems)
+        {
+            JobSystem &jobs = JobSystem::getInstance();
+            open(_subtrees, jobs.getThreadCount() * 4, views);
+            if (_hits.size() < _subtrees.size())
+            {
+                _hits.resize(_subtrees.size());
+            }
+            jobs.parallelFor(0, _subtrees.size(), 1, [this, views](size_t begin, size_t end)
+            {
+                PROFILE_ZONE("SceneBVH::walk");
+                for (size_t i = begin; i < end; i++)
+                {
+                    _hits[i].clear();
+                    walk(_subtrees[i], views, _hits[i]);
+                }
+            });
+        }
+        else
+        {
+            if (_hits.empty())
+            {
+                _hits.resize(1);
+            }
+            _hits[0].clear();
+            walk(_subtrees[0], views, _hits[0]);
+        }
+
+        // Subtrees are in leaf order, so the lists are too
+        for (size_t i = 0; i < _subtrees.size(); i++)
+        {
+            const vector<Hit> &hits = _hits[i];
+            for (size_t h = 0; h < hits.size(); h++)
+            {
+                emit(_items[hits[h].item], views, hits[h].mask);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < _dynamic.size(); i++)
+    {
+        // Read even when not tested, it brings the node's world matrix up
+        // to date before jobs read it (see DrawList)
+        const BoundingSphere &bounds = _dynamic[i].node->getBoundingSphere();
+        unsigned int visible = all;
+        unsigned int check = test ? all : 0;
+        if (check)
+        {
+            classify(bounds, views, visible, check);
+        }
+        emit(_dynamic[i], views, visible);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// open()
+//
+//----------------------------------------------------------------------
+void SceneBVH::open(vector<Subtree> &subtrees, size_t count, const View *views) const
+{
+    vector<Subtree> children;
+    bool opened = true;
+    while (opened && subtrees.size() < count)
+    {
+        opened = false;
+        children.clear();
+        for (size_t i = 0; i < subtrees.size(); i++)
+        {
+            const Subtree &subtree = subtrees[i];
+            const BVHNode &node = _nodes[subtree.node];
+            if (node.count > 0)
+            {
+                children.push_back(subtree);
+                continue;
+            }
+            opened = true;
+            unsigned int visible = subtree.visible;
+            unsigned int check = subtree.check;
+            classify(node.bounds, views, visible, check);
+            if (visible)
+            {
+                children.push_back(Subtree(subtree.node + 1, visible, check));
+                children.push_back(Subtree(node.right, visible, check));
+            }
+        }
+        subtrees.swap(children);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// walk()
+//
+//----------------------------------------------------------------------
+void SceneBVH::walk(const Subtree &root, const View *views, vector<Hit> &hits) const
+{
+    // Each stack entry is a hierarchy node, the views that may still see
+    // it and the views it still has to be tested against
+    unsigned int stack[64];
+    unsigned int visibleStack[64];
+    unsigned int checkStack[64];
+    int top = 0;
+    stack[top] = root.node;
+    visibleStack[top] = root.visible;
+    checkStack[top++] = root.check;
+    while (top > 0)
+    {
+        top--;
+        unsigned int index = stack[top];
+        unsigned int visible = visibleStack[top];
+        unsigned int check = checkStack[top];
+        const BVHNode &node = _nodes[index];
+        classify(node.bounds, views, visible, check);
+        if (!visible)
+        {
+            continue;
+        }
+        if (node.count > 0)
+        {
+            for (unsigned int i = node.first; i < node.first + node.count; i++)
+            {
+                Hit hit;
+                hit.item = i;
+                hit.mask = visible;
+                unsigned int itemCheck = check;
+                classify(_items[i].bounds, views, hit.mask, itemCheck);
+                if (hit.mask)
+                {
+                    hits.push_back(hit);
+                }
+            }
+        }
+        else
+        {
+            // Depth is bounded by the median split (log2 of the node count)
+            stack[top] = node.right;
+            visibleStack[top] = visible;
+            checkStack[top++] = check;
+            stack[top] = index + 1;
+            visibleStack[top] = visible;
+            checkStack[top++] = check;
+        }
+    }
+}
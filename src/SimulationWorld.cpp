@@ -0,0 +1,530 @@
+//
+//  SimulationWorld.cpp
+//  FrcSim
+//
+//
+
+#include <iostream>
+#include <fstream>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+#include <btBulletDynamicsCommon.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Robot.h"
+#include "MatchInput.h"
+#include "FrcSim.h"
+#include "SimulationWorld.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+const float SimulationWorld::kDefaultTimestep = 0.005f;
+
+/**
+ * Bullet state of one rigid body in a snapshot.
+ */
+struct BodyState
+{
+    btTransform transform;
+
+    btTransform interpolationTransform;
+
+    btVector3 linearVelocity;
+
+    btVector3 angularVelocity;
+
+    btVector3 interpolationLinearVelocity;
+
+    btVector3 interpolationAngularVelocity;
+
+    btScalar deactivationTime;
+
+    int activationState;
+};
+
+//----------------------------------------------------------------------
+//
+// getBodyState()
+//
+//----------------------------------------------------------------------
+static void getBodyState(const btRigidBody *body, BodyState &state)
+{
+    state.transform = body->getWorldTransform();
+    state.interpolationTransform = body->getInterpolationWorldTransform();
+    state.linearVelocity = body->getLinearVelocity();
+    state.angularVelocity = body->getAngularVelocity();
+    state.interpolationLinearVelocity = body->getInterpolationLinearVelocity();
+    state.interpolationAngularVelocity = body->getInterpolationAngularVelocity();
+    state.deactivationTime = body->getDeactivationTime();
+    state.activationState = body->getActivationState();
+}
+
+//----------------------------------------------------------------------
+//
+// setBodyState()
+//
+//----------------------------------------------------------------------
+static void setBodyState(btRigidBody *body, const BodyState &state)
+{
+    body->setWorldTransform(state.transform);
+    body->getMotionState()->setWorldTransform(state.transform);
+    body->setInterpolationWorldTransform(state.interpolationTransform);
+    body->setLinearVelocity(state.linearVelocity);
+    body->setAngularVelocity(state.angularVelocity);
+    body->setInterpolationLinearVelocity(state.interpolationLinearVelocity);
+    body->setInterpolationAngularVelocity(state.interpolationAngularVelocity);
+    body->setDeactivationTime(state.deactivationTime);
+    body->forceActivationState(state.activationState);
+    body->clearForces();
+}
+
+//----------------------------------------------------------------------
+//
+// Parameters()
+//
+//----------------------------------------------------------------------
+SimulationWorld::Parameters::Parameters() :
+    gravity(0.0f, -386.09f, 0.0f),
+    ballRadius(12.0f),
+    ballMass(4.5f),
+    ballFriction(0.5f),
+    ballRestitution(1.0f),
+    ballLinearDamping(0.1f),
+    ballAngularDamping(0.5f),
+    ballLaunch(126.0f, 0.0f, 156.0f),
+    robotExtents(26.75f, 12.0f, 30.0f),
+    robotCenter(0.0f, 17.0f, -7.0f),
+    floorFriction(0.5f),
+    floorRestitution(0.75f)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// load()
+//
+//----------------------------------------------------------------------
+bool SimulationWorld::Parameters::load(const char* sceneFile, const char* physicsFile)
+{
+    bool rc = true;
+    Properties* scene_props = Properties::create(sceneFile);
+    if (scene_props)
+    {
+        Properties* scene_ns = (strlen(scene_props->getNamespace()) > 0) ? scene_props : scene_props->getNextNamespace();
+        Properties* physics_ns = scene_ns ? scene_ns->getNamespace("physics", true) : NULL;
+        if (physics_ns)
+        {
+            physics_ns->getVector3("gravity", &gravity);
+        }
+        SAFE_DELETE(scene_props);
+    }
+    else
+    {
+        rc = false;
+    }
+
+    GString ball_url = GString(physicsFile) + "#ball";
+    Properties* ball = Properties::create(ball_url);
+    if (ball)
+    {
+        if (ball->exists("radius"))
+        {
+            ballRadius = ball->getFloat("radius");
+        }
+        if (ball->exists("mass"))
+        {
+            ballMass = ball->getFloat("mass");
+        }
+        if (ball->exists("friction"))
+        {
+            ballFriction = ball->getFloat("friction");
+        }
+        if (ball->exists("restitution"))
+        {
+            ballRestitution = ball->getFloat("restitution");
+        }
+        if (ball->exists("linearDamping"))
+        {
+            ballLinearDamping = ball->getFloat("linearDamping");
+        }
+        if (ball->exists("angularDamping"))
+        {
+            ballAngularDamping = ball->getFloat("angularDamping");
+        }
+        SAFE_DELETE(ball);
+    }
+    else
+    {
+        rc = false;
+    }
+
+    GString robot_url = GString(physicsFile) + "#robot";
+    Properties* robot = Properties::create(robot_url);
+    if (robot)
+    {
+        robot->getVector3("extents", &robotExtents);
+        robot->getVector3("center", &robotCenter);
+        SAFE_DELETE(robot);
+    }
+    else
+    {
+        rc = false;
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Simulation parameters: gravity %5.2f, ball radius %5.2f, mass %5.2f\n", gravity.y, ballRadius, ballMass);
+#endif // DEBUG
+    return rc;
+}
+
+//----------------------------------------------------------------------
+//
+// SimulationWorld()
+//
+//----------------------------------------------------------------------
+SimulationWorld::SimulationWorld(const Parameters &parameters, Robot *robot) :
+    _parameters(parameters),
+    _robot(robot),
+    _simulated_time(0.0),
+    _tick_count(0),
+    _ball_in_play(false),
+    _collision_configuration(NULL),
+    _dispatcher(NULL),
+    _broadphase(NULL),
+    _solver(NULL),
+    _world(NULL),
+    _floor_shape(NULL),
+    _robot_shape(NULL),
+    _ball_shape(NULL),
+    _floor_body(NULL),
+    _robot_body(NULL),
+    _ball_body(NULL)
+{
+    _collision_configuration = new btDefaultCollisionConfiguration();
+    _dispatcher = new btCollisionDispatcher(_collision_configuration);
+    _broadphase = new btDbvtBroadphase();
+    _solver = new btSequentialImpulseConstraintSolver();
+    _world = new btDiscreteDynamicsWorld(_dispatcher, _broadphase, _solver, _collision_configuration);
+    _world->setGravity(btVector3(_parameters.gravity.x, _parameters.gravity.y, _parameters.gravity.z));
+
+    // Floor (same material as createFloorModel())
+    _floor_shape = new btStaticPlaneShape(btVector3(0.0f, 1.0f, 0.0f), 0.0f);
+    btRigidBody::btRigidBodyConstructionInfo floor_info(0.0f, new btDefaultMotionState(), _floor_shape);
+    floor_info.m_friction = _parameters.floorFriction;
+    floor_info.m_restitution = _parameters.floorRestitution;
+    _floor_body = new btRigidBody(floor_info);
+    _world->addRigidBody(_floor_body);
+
+    // Robot is a kinematic box driven by Robot::update()
+    _robot_shape = new btBoxShape(btVector3(_parameters.robotExtents.x * 0.5f, _parameters.robotExtents.y * 0.5f, _parameters.robotExtents.z * 0.5f));
+    btRigidBody::btRigidBodyConstructionInfo robot_info(0.0f, new btDefaultMotionState(), _robot_shape);
+    _robot_body = new btRigidBody(robot_info);
+    _robot_body->setCollisionFlags(_robot_body->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+    _robot_body->setActivationState(DISABLE_DEACTIVATION);
+    syncRobotBody();
+    _world->addRigidBody(_robot_body);
+
+    // Game ball, added to the world when put in play
+    _ball_shape = new btSphereShape(_parameters.ballRadius);
+    btVector3 inertia(0.0f, 0.0f, 0.0f);
+    _ball_shape->calculateLocalInertia(_parameters.ballMass, inertia);
+    btRigidBody::btRigidBodyConstructionInfo ball_info(_parameters.ballMass, new btDefaultMotionState(), _ball_shape, inertia);
+    ball_info.m_friction = _parameters.ballFriction;
+    ball_info.m_restitution = _parameters.ballRestitution;
+    ball_info.m_linearDamping = _parameters.ballLinearDamping;
+    ball_info.m_angularDamping = _parameters.ballAngularDamping;
+    _ball_body = new btRigidBody(ball_info);
+}
+
+//----------------------------------------------------------------------
+//
+// ~SimulationWorld()
+//
+//----------------------------------------------------------------------
+SimulationWorld::~SimulationWorld()
+{
+    if (_ball_in_play)
+    {
+        _world->removeRigidBody(_ball_body);
+    }
+    _world->removeRigidBody(_robot_body);
+    _world->removeRigidBody(_floor_body);
+    btRigidBody* bodies[] = { _floor_body, _robot_body, _ball_body };
+    for (unsigned int i = 0; i < sizeof(bodies) / sizeof(bodies[0]); i++)
+    {
+        delete bodies[i]->getMotionState();
+        delete bodies[i];
+    }
+    SAFE_DELETE(_ball_shape);
+    SAFE_DELETE(_robot_shape);
+    SAFE_DELETE(_floor_shape);
+    SAFE_DELETE(_world);
+    SAFE_DELETE(_solver);
+    SAFE_DELETE(_broadphase);
+    SAFE_DELETE(_dispatcher);
+    SAFE_DELETE(_collision_configuration);
+    SAFE_DELETE(_robot);
+}
+
+//----------------------------------------------------------------------
+//
+// setInput()
+//
+//----------------------------------------------------------------------
+void SimulationWorld::setInput(const MatchInput &input)
+{
+    _input = input;
+}
+
+//----------------------------------------------------------------------
+//
+// step()
+//
+//----------------------------------------------------------------------
+void SimulationWorld::step(float timestep)
+{
+    PROFILE_ZONE("SimulationWorld::step");
+    if (_input.launchBall && !_ball_in_play)
+    {
+        launchBall();
+    }
+    if (_robot)
+    {
+        PROFILE_ZONE("Robot::update");
+        _robot->setVelocity(_input.getThrottle(AerialAssist::_joystickDeadband));
+        _robot->update(timestep);
+        syncRobotBody();
+    }
+
+    // A single step of exactly the given length, no interpolation
+    {
+        PROFILE_ZONE("stepSimulation");
+        _world->stepSimulation(timestep, 0);
+    }
+    _simulated_time += timestep;
+    _tick_count++;
+}
+
+//----------------------------------------------------------------------
+//
+// run()
+//
+//----------------------------------------------------------------------
+void SimulationWorld::run(double duration, float timestep)
+{
+    while (_simulated_time + (timestep * 0.5) < duration)
+    {
+        step(timestep);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// getBallPosition()
+//
+//----------------------------------------------------------------------
+Vector3 SimulationWorld::getBallPosition() const
+{
+    const btVector3 &origin = _ball_body->getWorldTransform().getOrigin();
+    return Vector3(origin.x(), origin.y(), origin.z());
+}
+
+//----------------------------------------------------------------------
+//
+// getFrame()
+//
+//----------------------------------------------------------------------
+void SimulationWorld::getFrame(MatchFrame &frame) const
+{
+    frame.tick = _tick_count;
+    frame.time = _simulated_time;
+    if (_robot)
+    {
+        frame.robotPosition = _robot->getPosition();
+        frame.robotYaw = _robot->getYaw();
+        frame.robotVelocity = _robot->getVelocity();
+        frame.robotSetpoint = _robot->getVelocitySetpoint();
+    }
+    frame.ballInPlay = _ball_in_play;
+    frame.ballPosition = getBallPosition();
+    const btVector3 &linear = _ball_body->getLinearVelocity();
+    const btVector3 &angular = _ball_body->getAngularVelocity();
+    frame.ballLinearVelocity.set(linear.x(), linear.y(), linear.z());
+    frame.ballAngularVelocity.set(angular.x(), angular.y(), angular.z());
+}
+
+//----------------------------------------------------------------------
+//
+// applyFrame()
+//
+//----------------------------------------------------------------------
+void SimulationWorld::applyFrame(const MatchFrame &frame)
+{
+    _tick_count = frame.tick;
+    _simulated_time = frame.time;
+    if (_robot)
+    {
+        _robot->setPosition(frame.robotPosition);
+        _robot->setYaw(frame.robotYaw);
+        _robot->setVelocityState(frame.robotVelocity, frame.robotSetpoint);
+        syncRobotBody();
+    }
+    if (frame.ballInPlay && !_ball_in_play)
+    {
+        launchBall();
+    }
+    else if (!frame.ballInPlay && _ball_in_play)
+    {
+        _world->removeRigidBody(_ball_body);
+        _ball_in_play = false;
+    }
+    const Vector3 &position = frame.ballPosition;
+    btTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(btVector3(position.x, position.y, position.z));
+    _ball_body->getMotionState()->setWorldTransform(transform);
+    _ball_body->setWorldTransform(transform);
+    _ball_body->setLinearVelocity(btVector3(frame.ballLinearVelocity.x, frame.ballLinearVelocity.y, frame.ballLinearVelocity.z));
+    _ball_body->setAngularVelocity(btVector3(frame.ballAngularVelocity.x, frame.ballAngularVelocity.y, frame.ballAngularVelocity.z));
+}
+
+//----------------------------------------------------------------------
+//
+// getSnapshotSize()
+//
+//----------------------------------------------------------------------
+size_t SimulationWorld::getSnapshotSize() const
+{
+    return sizeof(_tick_count) + sizeof(_simulated_time) + sizeof(_ball_in_play) + sizeof(_input) +
+           (_robot ? _robot->getSnapshotSize() : 0) + 2 * sizeof(BodyState);
+}
+
+//----------------------------------------------------------------------
+//
+// capture()
+//
+//----------------------------------------------------------------------
+void SimulationWorld::capture(Snapshot &snapshot) const
+{
+    snapshot.clear();
+    snapshot.put(_tick_count);
+    snapshot.put(_simulated_time);
+    snapshot.put(_ball_in_play);
+    snapshot.put(_input);
+    if (_robot)
+    {
+        _robot->capture(snapshot);
+    }
+    BodyState state;
+    getBodyState(_robot_body, state);
+    snapshot.put(state);
+    getBodyState(_ball_body, state);
+    snapshot.put(state);
+}
+
+//----------------------------------------------------------------------
+//
+// restore()
+//
+//----------------------------------------------------------------------
+bool SimulationWorld::restore(Snapshot &snapshot)
+{
+    snapshot.rewind();
+    bool ball_in_play = false;
+    if (!snapshot.get(_tick_count) || !snapshot.get(_simulated_time) || !snapshot.get(ball_in_play) || !snapshot.get(_input))
+    {
+        return false;
+    }
+    if (_robot && !_robot->restore(snapshot))
+    {
+        return false;
+    }
+    BodyState robot_state;
+    BodyState ball_state;
+    if (!snapshot.get(robot_state) || !snapshot.get(ball_state))
+    {
+        return false;
+    }
+    setBodyState(_robot_body, robot_state);
+
+    if (_ball_in_play && !ball_in_play)
+    {
+        _world->removeRigidBody(_ball_body);
+    }
+    else if (!_ball_in_play && ball_in_play)
+    {
+        _world->addRigidBody(_ball_body);
+    }
+    else if (_ball_in_play)
+    {
+        // Contact points and their warm start impulses belong to the
+        // branch being left
+        _broadphase->getOverlappingPairCache()->cleanProxyFromPairs(_ball_body->getBroadphaseHandle(), _dispatcher);
+    }
+    _ball_in_play = ball_in_play;
+    setBodyState(_ball_body, ball_state);
+    return snapshot.isAtEnd();
+}
+
+//----------------------------------------------------------------------
+//
+// syncRobotBody()
+//
+//----------------------------------------------------------------------
+void SimulationWorld::syncRobotBody()
+{
+    if (!_robot)
+    {
+        return;
+    }
+    float yaw = MATH_DEG_TO_RAD(_robot->getYaw());
+    float c = cos(yaw);
+    float s = sin(yaw);
+    const Vector3 &center = _parameters.robotCenter;
+    Vector3 position = _robot->getPosition();
+    btTransform transform;
+    transform.setIdentity();
+    transform.setRotation(btQuaternion(btVector3(0.0f, 1.0f, 0.0f), yaw));
+    transform.setOrigin(btVector3(position.x + (center.x * c) + (center.z * s),
+                                  position.y + center.y,
+                                  position.z - (center.x * s) + (center.z * c)));
+    _robot_body->getMotionState()->setWorldTransform(transform);
+    _robot_body->setWorldTransform(transform);
+}
+
+//----------------------------------------------------------------------
+//
+// launchBall()
+//
+//----------------------------------------------------------------------
+void SimulationWorld::launchBall()
+{
+    const Vector3 &launch = _parameters.ballLaunch;
+    btTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(btVector3(launch.x, launch.y, launch.z));
+    _ball_body->getMotionState()->setWorldTransform(transform);
+    _ball_body->setWorldTransform(transform);
+    _ball_body->setLinearVelocity(btVector3(0.0f, 0.0f, 0.0f));
+    _ball_body->setAngularVelocity(btVector3(0.0f, 0.0f, 0.0f));
+    _world->addRigidBody(_ball_body);
+    _ball_in_play = true;
+}
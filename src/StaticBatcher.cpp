@@ -0,0 +1,369 @@
+//
+//  StaticBatcher.cpp
+//  FrcSim
+//
+//
+
+#include <cstring>
+#include <cfloat>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "StaticBatcher.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+/**
+ * Orders candidates along their group's sort axis.
+ */
+struct CandidateLess
+{
+    template <class T> bool operator()(const T &a, const T &b) const
+    {
+        return a.center < b.center;
+    }
+};
+
+//----------------------------------------------------------------------
+//
+// StaticBatcher()
+//
+//----------------------------------------------------------------------
+StaticBatcher::StaticBatcher()
+{
+}
+
+//----------------------------------------------------------------------
+//
+// add()
+//
+//----------------------------------------------------------------------
+void StaticBatcher::add(Node *node, unsigned int material)
+{
+    Model *model = node->getModel();
+    if (!model || model->getSkin() || !model->getMesh())
+    {
+        return;
+    }
+    Candidate candidate;
+    candidate.node = node;
+    candidate.material = material;
+    candidate.center = 0.0f;
+    _candidates.push_back(candidate);
+}
+
+//----------------------------------------------------------------------
+//
+// build()
+//
+//----------------------------------------------------------------------
+unsigned int StaticBatcher::build(Scene *scene, vector<Node*> &batches, vector<unsigned int> &materials)
+{
+#ifdef OPENGL_ES
+    // No glGetBufferSubData(), keep one draw per node
+    return 0;
+#else
+    // Group by material, then by vertex format within a material
+    map<unsigned int, vector<Candidate> > groups;
+    for (size_t i = 0; i < _candidates.size(); i++)
+    {
+        groups[_candidates[i].material].push_back(_candidates[i]);
+    }
+
+    unsigned int merged = 0;
+    unsigned int number = 0;
+    map<unsigned int, vector<Candidate> >::iterator it;
+    for (it = groups.begin(); it != groups.end(); it++)
+    {
+        vector<Candidate> &remaining = it->second;
+        while (!remaining.empty())
+        {
+            const VertexFormat &format = remaining.front().node->getModel()->getMesh()->getVertexFormat();
+            vector<Candidate> group;
+            vector<Candidate> other;
+            for (size_t i = 0; i < remaining.size(); i++)
+            {
+                if (remaining[i].node->getModel()->getMesh()->getVertexFormat() == format)
+                {
+                    group.push_back(remaining[i]);
+                }
+                else
+                {
+                    other.push_back(remaining[i]);
+                }
+            }
+            remaining.swap(other);
+            if (group.size() < 2)
+            {
+                continue;
+            }
+
+            // Find the position and normal in the vertex
+            const VertexFormat &group_format = group.front().node->getModel()->getMesh()->getVertexFormat();
+            unsigned int stride = group_format.getVertexSize() / sizeof(float);
+            int position_offset = -1;
+            int normal_offset = -1;
+            unsigned int offset = 0;
+            for (unsigned int e = 0; e < group_format.getElementCount(); e++)
+            {
+                const VertexFormat::Element &element = group_format.getElement(e);
+                if (element.usage == VertexFormat::POSITION && element.size == 3)
+                {
+                    position_offset = offset;
+                }
+                else if (element.usage == VertexFormat::NORMAL && element.size == 3)
+                {
+                    normal_offset = offset;
+                }
+                offset += element.size;
+            }
+            if (position_offset < 0)
+            {
+                continue;
+            }
+
+            // Sort along the longest axis so batches are spatially compact
+            Vector3 low(FLT_MAX, FLT_MAX, FLT_MAX);
+            Vector3 high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            for (size_t i = 0; i < group.size(); i++)
+            {
+                const Vector3 &c = group[i].node->getBoundingSphere().center;
+                low.set(min(low.x, c.x), min(low.y, c.y), min(low.z, c.z));
+                high.set(max(high.x, c.x), max(high.y, c.y), max(high.z, c.z));
+            }
+            Vector3 extent = high - low;
+            int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+            for (size_t i = 0; i < group.size(); i++)
+            {
+                const Vector3 &c = group[i].node->getBoundingSphere().center;
+                group[i].center = (axis == 0 ? c.x : (axis == 1 ? c.y : c.z));
+            }
+            std::sort(group.begin(), group.end(), CandidateLess());
+
+            // Pack nodes into batches of at most kMaxVertices
+            vector<float> batch_vertices;
+            vector<unsigned short> batch_indices;
+            vector<Node*> batch_nodes;
+            vector<float> vertices;
+            vector<unsigned int> indices;
+            for (size_t i = 0; i <= group.size(); i++)
+            {
+                unsigned int count = 0;
+                if (i < group.size())
+                {
+                    Mesh *mesh = group[i].node->getModel()->getMesh();
+                    if (!readMesh(mesh, vertices, indices) || mesh->getVertexCount() > kMaxVertices)
+                    {
+                        continue;
+                    }
+                    count = mesh->getVertexCount();
+                }
+                unsigned int base = (unsigned int)(batch_vertices.size() / stride);
+                if (i == group.size() || base + count > kMaxVertices)
+                {
+                    if (batch_nodes.size() > 1)
+                    {
+                        Node *batch = createBatch(group_format, batch_vertices, batch_indices, number++);
+                        scene->addNode(batch);
+                        batch->release();
+                        batches.push_back(batch);
+                        materials.push_back(it->first);
+                        for (size_t n = 0; n < batch_nodes.size(); n++)
+                        {
+                            batch_nodes[n]->setModel(NULL);
+                        }
+                        merged += (unsigned int)batch_nodes.size();
+                    }
+                    batch_vertices.clear();
+                    batch_indices.clear();
+                    batch_nodes.clear();
+                    base = 0;
+                    if (i == group.size())
+                    {
+                        break;
+                    }
+                }
+
+                // World space positions and normals
+                Node *node = group[i].node;
+                const Matrix &world = node->getWorldMatrix();
+                Matrix normal_matrix;
+                world.invert(&normal_matrix);
+                normal_matrix.transpose();
+                for (unsigned int v = 0; v < count; v++)
+                {
+                    float *vertex = &vertices[v * stride];
+                    Vector3 p(vertex[position_offset], vertex[position_offset + 1], vertex[position_offset + 2]);
+                    world.transformPoint(&p);
+                    vertex[position_offset] = p.x;
+                    vertex[position_offset + 1] = p.y;
+                    vertex[position_offset + 2] = p.z;
+                    if (normal_offset >= 0)
+                    {
+                        Vector3 n(vertex[normal_offset], vertex[normal_offset + 1], vertex[normal_offset + 2]);
+                        normal_matrix.transformVector(&n);
+                        n.normalize();
+                        vertex[normal_offset] = n.x;
+                        vertex[normal_offset + 1] = n.y;
+                        vertex[normal_offset + 2] = n.z;
+                    }
+                }
+                batch_vertices.insert(batch_vertices.end(), vertices.begin(), vertices.begin() + count * stride);
+                for (size_t n = 0; n < indices.size(); n++)
+                {
+                    batch_indices.push_back((unsigned short)(base + indices[n]));
+                }
+                batch_nodes.push_back(node);
+            }
+        }
+    }
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Merged %u of %lu static nodes into %lu batches\n", merged, (unsigned long)_candidates.size(), (unsigned long)batches.size());
+#endif // DEBUG
+    return merged;
+#endif // OPENGL_ES
+}
+
+//----------------------------------------------------------------------
+//
+// readMesh()
+//
+//----------------------------------------------------------------------
+bool StaticBatcher::readMesh(Mesh *mesh, vector<float> &vertices, vector<unsigned int> &indices)
+{
+#ifdef OPENGL_ES
+    return false;
+#else
+    unsigned int vertex_count = mesh->getVertexCount();
+    unsigned int vertex_size = mesh->getVertexFormat().getVertexSize();
+    vertices.resize(vertex_count * vertex_size / sizeof(float));
+    indices.clear();
+    if (vertex_count == 0)
+    {
+        return false;
+    }
+
+    unsigned int part_count = mesh->getPartCount();
+    if (part_count == 0)
+    {
+        if (mesh->getPrimitiveType() != Mesh::TRIANGLES)
+        {
+            return false;
+        }
+        for (unsigned int i = 0; i < vertex_count; i++)
+        {
+            indices.push_back(i);
+        }
+    }
+    for (unsigned int p = 0; p < part_count; p++)
+    {
+        MeshPart *part = mesh->getPart(p);
+        if (part->getPrimitiveType() != Mesh::TRIANGLES)
+        {
+            return false;
+        }
+        unsigned int index_count = part->getIndexCount();
+        unsigned int index_size = (part->getIndexFormat() == Mesh::INDEX8 ? 1 : (part->getIndexFormat() == Mesh::INDEX16 ? 2 : 4));
+        vector<unsigned char> data(index_count * index_size);
+        if (index_count > 0)
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, part->getIndexBuffer());
+            glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, data.size(), &data[0]);
+        }
+        for (unsigned int i = 0; i < index_count; i++)
+        {
+            unsigned int index;
+            if (index_size == 1)
+            {
+                index = data[i];
+            }
+            else if (index_size == 2)
+            {
+                unsigned short value;
+                memcpy(&value, &data[i * 2], 2);
+                index = value;
+            }
+            else
+            {
+                memcpy(&index, &data[i * 4], 4);
+            }
+            if (index >= vertex_count)
+            {
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+                return false;
+            }
+            indices.push_back(index);
+        }
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->getVertexBuffer());
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertex_count * vertex_size, &vertices[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return !indices.empty();
+#endif // OPENGL_ES
+}
+
+//----------------------------------------------------------------------
+//
+// createBatch()
+//
+//----------------------------------------------------------------------
+Node *StaticBatcher::createBatch(const VertexFormat &format, const vector<float> &vertices, const vector<unsigned short> &indices, unsigned int number)
+{
+    unsigned int stride = format.getVertexSize() / sizeof(float);
+    unsigned int vertex_count = (unsigned int)(vertices.size() / stride);
+    Mesh *mesh = Mesh::createMesh(format, vertex_count, false);
+    mesh->setPrimitiveType(Mesh::TRIANGLES);
+    mesh->setVertexData(&vertices[0], 0, vertex_count);
+    MeshPart *part = mesh->addPart(Mesh::TRIANGLES, Mesh::INDEX16, (unsigned int)indices.size(), false);
+    part->setIndexData(&indices[0], 0, (unsigned int)indices.size());
+
+    // Bounds of the merged (world space) positions
+    int position_offset = 0;
+    for (unsigned int e = 0, offset = 0; e < format.getElementCount(); e++)
+    {
+        if (format.getElement(e).usage == VertexFormat::POSITION)
+        {
+            position_offset = offset;
+        }
+        offset += format.getElement(e).size;
+    }
+    Vector3 low(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vector3 high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (unsigned int v = 0; v < vertex_count; v++)
+    {
+        const float *p = &vertices[v * stride + position_offset];
+        low.set(min(low.x, p[0]), min(low.y, p[1]), min(low.z, p[2]));
+        high.set(max(high.x, p[0]), max(high.y, p[1]), max(high.z, p[2]));
+    }
+    Vector3 center = (low + high) * 0.5f;
+    float radius = 0.0f;
+    for (unsigned int v = 0; v < vertex_count; v++)
+    {
+        const float *p = &vertices[v * stride + position_offset];
+        radius = max(radius, center.distanceSquared(Vector3(p[0], p[1], p[2])));
+    }
+    mesh->setBoundingBox(BoundingBox(low, high));
+    mesh->setBoundingSphere(BoundingSphere(center, sqrtf(radius)));
+
+    char id[32];
+    sprintf(id, "STATIC_BATCH_%u", number);
+    Node *node = Node::create(id);
+    Model *model = Model::create(mesh);
+    node->setModel(model);
+    SAFE_RELEASE(model);
+    SAFE_RELEASE(mesh);
+    return node;
+}
@@ -0,0 +1,226 @@
+//
+//  Telemetry.cpp
+//  FrcSim
+//
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include <string>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#ifndef ANDROID
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // ANDROID
+
+#include "MatchInput.h"
+#include "MatchLog.h"
+#include "Telemetry.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+const char *Telemetry::kDefaultName = "/frcsim-telemetry";
+
+//----------------------------------------------------------------------
+//
+// set()
+//
+//----------------------------------------------------------------------
+void TelemetrySample::set(const MatchFrame &frame)
+{
+    tick = frame.tick;
+    time = frame.time;
+    robotVelocity = frame.robotVelocity;
+    robotSetpoint = frame.robotSetpoint;
+    robotPosition[0] = frame.robotPosition.x;
+    robotPosition[1] = frame.robotPosition.y;
+    robotPosition[2] = frame.robotPosition.z;
+    robotYaw = frame.robotYaw;
+    ballPosition[0] = frame.ballPosition.x;
+    ballPosition[1] = frame.ballPosition.y;
+    ballPosition[2] = frame.ballPosition.z;
+    ballVelocity[0] = frame.ballLinearVelocity.x;
+    ballVelocity[1] = frame.ballLinearVelocity.y;
+    ballVelocity[2] = frame.ballLinearVelocity.z;
+    ballInPlay = frame.ballInPlay ? 1 : 0;
+    reserved = 0;
+}
+
+//----------------------------------------------------------------------
+//
+// Telemetry()
+//
+//----------------------------------------------------------------------
+Telemetry::Telemetry() :
+    _header(NULL),
+    _slots(NULL),
+    _size(0)
+{
+}
+
+//----------------------------------------------------------------------
+//
+// ~Telemetry()
+//
+//----------------------------------------------------------------------
+Telemetry::~Telemetry()
+{
+    close();
+}
+
+//----------------------------------------------------------------------
+//
+// getSegmentSize()
+//
+//----------------------------------------------------------------------
+size_t Telemetry::getSegmentSize(uint32_t capacity)
+{
+    static_assert(sizeof(Header) <= 64, "Telemetry header does not fit its cache line");
+    // Slots start on their own cache line so the header's head counter and
+    // the slot being written do not share one
+    return 64 + capacity * sizeof(Slot);
+}
+
+//----------------------------------------------------------------------
+//
+// create()
+//
+//----------------------------------------------------------------------
+bool Telemetry::create(const char *name, uint32_t capacity)
+{
+    close();
+#ifndef ANDROID
+    uint32_t slots = 1;
+    while (slots < capacity)
+    {
+        slots <<= 1;
+    }
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] Telemetry: cannot create %s\n", name);
+#endif // DEBUG
+        return false;
+    }
+    size_t size = getSegmentSize(slots);
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0)
+    {
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] Telemetry: cannot map %s\n", name);
+#endif // DEBUG
+        shm_unlink(name);
+        return false;
+    }
+
+    // The segment is zero filled, so every slot reads as not yet written
+    _header = (Header *)memory;
+    _slots = (Slot *)((uint8_t *)memory + 64);
+    _size = size;
+    _name = name;
+    _header->capacity = slots;
+    _header->sampleSize = sizeof(TelemetrySample);
+    _header->version = kVersion;
+    _header->head.store(0, std::memory_order_relaxed);
+    // Readers check the magic last, publish it after the rest of the header
+    std::atomic_thread_fence(std::memory_order_release);
+    _header->magic = kMagic;
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Telemetry: publishing %u samples to %s\n", slots, name);
+#endif // DEBUG
+    return true;
+#else
+    return false;
+#endif // ANDROID
+}
+
+//----------------------------------------------------------------------
+//
+// open()
+//
+//----------------------------------------------------------------------
+bool Telemetry::open(const char *name)
+{
+    close();
+#ifndef ANDROID
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= getSegmentSize(0))
+    {
+        memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+    Header *header = (Header *)memory;
+    bool valid = header->magic == kMagic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->version == kVersion && header->sampleSize == sizeof(TelemetrySample) &&
+        header->capacity != 0 && (header->capacity & (header->capacity - 1)) == 0 &&
+        getSegmentSize(header->capacity) <= (size_t)info.st_size;
+    if (!valid)
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] Telemetry: %s is not a telemetry segment\n", name);
+#endif // DEBUG
+        munmap(memory, (size_t)info.st_size);
+        return false;
+    }
+    _header = header;
+    _slots = (Slot *)((uint8_t *)memory + 64);
+    _size = (size_t)info.st_size;
+    return true;
+#else
+    return false;
+#endif // ANDROID
+}
+
+//----------------------------------------------------------------------
+//
+// close()
+//
+//----------------------------------------------------------------------
+void Telemetry::close()
+{
+#ifndef ANDROID
+    if (_header)
+    {
+        munmap(_header, _size);
+    }
+    if (!_name.empty())
+    {
+        // Readers keep their mapping, new ones will not find the segment
+        shm_unlink(_name.c_str());
+    }
+#endif // ANDROID
+    _header = NULL;
+    _slots = NULL;
+    _size = 0;
+    _name.clear();
+}
@@ -0,0 +1,445 @@
+//
+//  TextureMap.cpp
+//  FrcSim
+//
+//
+
+#include <iostream>
+#include <fstream>
+#include <cctype>
+
+#include <map>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+#include <ghoul/GRegEx.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "CookedCache.h"
+#include "TextureMap.h"
+
+#ifdef ANDROID
+#include <android/log.h>
+#define fprintf(a, ...) ((void)__android_log_print(ANDROID_LOG_INFO, "FrcSim", __VA_ARGS__))
+#endif // ANDROID
+
+//----------------------------------------------------------------------
+//
+// TextureMap()
+//
+//----------------------------------------------------------------------
+TextureMap::TextureMap() :
+    _class_count(1),
+    _compiled(false)
+{
+    memset(_classes, 0, sizeof(_classes));
+}
+
+//----------------------------------------------------------------------
+//
+// load()
+//
+//----------------------------------------------------------------------
+bool TextureMap::load(const string &filename)
+{
+    CookedCache cache(filename, CookedCache::TEXTURE_MAP);
+    if (!cache.hasSource())
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] File \"%s\" not opened\n", filename.c_str());
+#endif // DEBUG
+        return false;
+    }
+    if (cache.isCooked())
+    {
+        // Read every rule first so a damaged payload adds nothing
+        CookedCache::Reader reader = cache.getReader();
+        vector< pair<string, Entry> > rules;
+        unsigned int count = reader.getUInt();
+        for (unsigned int i = 0; i < count && reader.isValid(); i++)
+        {
+            string pattern = reader.getString();
+            string texture = reader.getString();
+            bool transparent = reader.getBool();
+            rules.push_back(make_pair(pattern, Entry(texture, transparent)));
+        }
+        if (reader.isValid() && reader.isAtEnd())
+        {
+            for (size_t i = 0; i < rules.size(); i++)
+            {
+                add(rules[i].first, rules[i].second.texture, rules[i].second.transparent);
+            }
+            return true;
+        }
+    }
+
+    Json::Value root;
+    Json::Reader reader;
+    if ( !reader.parse(cache.getSource(), cache.getSource() + cache.getSourceSize(), root) )
+    {
+#if DEBUG
+        fprintf(stderr, "[ERROR] File \"%s\" not parsed\n", filename.c_str());
+#endif // DEBUG
+        return false;
+    }
+    CookedCache::Writer writer;
+    Json::Value textureListArray = root["textureMapList"];
+    writer.putUInt(textureListArray.isArray() ? textureListArray.size() : 0);
+    if (textureListArray.isArray())
+    {
+        for (int i = 0; i < textureListArray.size(); i++)
+        {
+            Json::Value node = textureListArray[i];
+            string id = node.get("node", "").asCString();
+            string texture = node.get("texture", "").asCString();
+            bool transparent = node.get("transparent", false).asBool();
+#ifdef DEBUG
+            fprintf(stderr, "[Debug]\t\tReading texture \"%s\" for node \"%s\" (alpha %s)\n", texture.c_str(), id.c_str(), transparent?"true":"false");
+#endif // DEBUG
+            add(id, texture, transparent);
+            writer.putString(id.c_str());
+            writer.putString(texture.c_str());
+            writer.putBool(transparent);
+        }
+    }
+    cache.save(writer);
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// add()
+//
+//----------------------------------------------------------------------
+void TextureMap::add(const string &pattern, const string &texture, bool transparent)
+{
+    if (_entries.insert(make_pair(pattern, Entry(texture, transparent))).second)
+    {
+        _compiled = false;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// clear()
+//
+//----------------------------------------------------------------------
+void TextureMap::clear()
+{
+    _entries.clear();
+    _rules.clear();
+    _delta.clear();
+    _outputs.clear();
+    memset(_classes, 0, sizeof(_classes));
+    _class_count = 1;
+    _compiled = false;
+}
+
+//----------------------------------------------------------------------
+//
+// swap()
+//
+//----------------------------------------------------------------------
+void TextureMap::swap(TextureMap &other)
+{
+    // Rules point into _entries, whose nodes move with the map
+    _entries.swap(other._entries);
+    _rules.swap(other._rules);
+    _always.swap(other._always);
+    unsigned char classes[256];
+    memcpy(classes, _classes, sizeof(classes));
+    memcpy(_classes, other._classes, sizeof(_classes));
+    memcpy(other._classes, classes, sizeof(classes));
+    std::swap(_class_count, other._class_count);
+    _delta.swap(other._delta);
+    _outputs.swap(other._outputs);
+    std::swap(_compiled, other._compiled);
+}
+
+//----------------------------------------------------------------------
+//
+// getTextures()
+//
+//----------------------------------------------------------------------
+void TextureMap::getTextures(vector<string> &textures) const
+{
+    map<string, Entry>::const_iterator it;
+    for (it = _entries.begin(); it != _entries.end(); it++)
+    {
+        if (find(textures.begin(), textures.end(), it->second.texture) == textures.end())
+        {
+            textures.push_back(it->second.texture);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// requiredLiteral()
+//
+//----------------------------------------------------------------------
+string TextureMap::requiredLiteral(const string &pattern)
+{
+    string best;
+    string run;
+    size_t n = pattern.size();
+    size_t i = 0;
+    while (i < n)
+    {
+        char c = pattern[i];
+        if (c == '|')
+        {
+            // Alternation, no single literal is required
+            return "";
+        }
+        else if (c == '\\' && i + 1 < n)
+        {
+            char escaped = pattern[i + 1];
+            if (isalnum((unsigned char)escaped))
+            {
+                // Character class such as \d or \w
+                if (run.size() > best.size()) best = run;
+                run.clear();
+            }
+            else
+            {
+                run += (char)tolower((unsigned char)escaped);
+            }
+            i += 2;
+        }
+        else if (c == '[')
+        {
+            if (run.size() > best.size()) best = run;
+            run.clear();
+            i++;
+            if (i < n && pattern[i] == '^') i++;
+            if (i < n && pattern[i] == ']') i++;
+            while (i < n && pattern[i] != ']')
+            {
+                i += (pattern[i] == '\\') ? 2 : 1;
+            }
+            i++;
+        }
+        else if (c == '(')
+        {
+            // Groups may be optional or contain alternation, skip them
+            if (run.size() > best.size()) best = run;
+            run.clear();
+            int depth = 0;
+            while (i < n)
+            {
+                if (pattern[i] == '\\')
+                {
+                    i++;
+                }
+                else if (pattern[i] == '(')
+                {
+                    depth++;
+                }
+                else if (pattern[i] == ')' && --depth == 0)
+                {
+                    break;
+                }
+                i++;
+            }
+            i++;
+        }
+        else if (c == '*' || c == '?' || c == '{')
+        {
+            // The previous character is optional
+            if (!run.empty())
+            {
+                run.erase(run.size() - 1);
+            }
+            if (run.size() > best.size()) best = run;
+            run.clear();
+            if (c == '{')
+            {
+                while (i < n && pattern[i] != '}') i++;
+            }
+            i++;
+        }
+        else if (c == '+' || c == '.' || c == '^' || c == '$' || c == ')')
+        {
+            if (run.size() > best.size()) best = run;
+            run.clear();
+            i++;
+        }
+        else
+        {
+            run += (char)tolower((unsigned char)c);
+            i++;
+        }
+    }
+    if (run.size() > best.size()) best = run;
+    return best;
+}
+
+//----------------------------------------------------------------------
+//
+// compile()
+//
+//----------------------------------------------------------------------
+void TextureMap::compile()
+{
+    _rules.clear();
+    _delta.clear();
+    _outputs.clear();
+    memset(_classes, 0, sizeof(_classes));
+    _class_count = 1;
+
+    // Rules in first-match order with their required literal
+    map<string, Entry>::const_iterator it;
+    for (it = _entries.begin(); it != _entries.end(); it++)
+    {
+        Rule rule;
+        rule.pattern = it->first.c_str();
+        rule.literal = requiredLiteral(it->first);
+        rule.entry = &it->second;
+        for (size_t i = 0; i < rule.literal.size(); i++)
+        {
+            unsigned char c = (unsigned char)rule.literal[i];
+            if (_classes[c] == 0)
+            {
+                _classes[c] = (unsigned char)_class_count++;
+            }
+        }
+        _rules.push_back(rule);
+    }
+
+    // Trie of the literals, state 0 is the root and -1 marks no edge
+    _delta.assign(_class_count, -1);
+    _outputs.push_back(vector<unsigned int>());
+    for (unsigned int r = 0; r < _rules.size(); r++)
+    {
+        const string &literal = _rules[r].literal;
+        if (literal.empty())
+        {
+            continue;
+        }
+        int state = 0;
+        for (size_t i = 0; i < literal.size(); i++)
+        {
+            unsigned int a = _classes[(unsigned char)literal[i]];
+            if (_delta[state * _class_count + a] < 0)
+            {
+                _delta[state * _class_count + a] = (int)_outputs.size();
+                _delta.resize(_delta.size() + _class_count, -1);
+                _outputs.push_back(vector<unsigned int>());
+            }
+            state = _delta[state * _class_count + a];
+        }
+        _outputs[state].push_back(r);
+    }
+
+    // Breadth first, turn failure links into transitions
+    vector<int> fail(_outputs.size(), 0);
+    deque<int> queue;
+    for (unsigned int a = 0; a < _class_count; a++)
+    {
+        int next = _delta[a];
+        if (next < 0)
+        {
+            _delta[a] = 0;
+        }
+        else
+        {
+            fail[next] = 0;
+            queue.push_back(next);
+        }
+    }
+    while (!queue.empty())
+    {
+        int state = queue.front();
+        queue.pop_front();
+        for (unsigned int a = 0; a < _class_count; a++)
+        {
+            int next = _delta[state * _class_count + a];
+            int fallback = _delta[fail[state] * _class_count + a];
+            if (next < 0)
+            {
+                _delta[state * _class_count + a] = fallback;
+            }
+            else
+            {
+                fail[next] = fallback;
+                _outputs[next].insert(_outputs[next].end(), _outputs[fallback].begin(), _outputs[fallback].end());
+                queue.push_back(next);
+            }
+        }
+    }
+    _compiled = true;
+#ifdef DEBUG
+    fprintf(stderr, "[Debug] Compiled %lu texture rules into %lu states\n", (unsigned long)_rules.size(), (unsigned long)_outputs.size());
+#endif // DEBUG
+}
+
+//----------------------------------------------------------------------
+//
+// match()
+//
+//----------------------------------------------------------------------
+const TextureMap::Entry *TextureMap::match(const char *id)
+{
+    if (!_compiled)
+    {
+        compile();
+    }
+    return static_cast<const TextureMap*>(this)->match(id);
+}
+
+//----------------------------------------------------------------------
+//
+// match()
+//
+//----------------------------------------------------------------------
+const TextureMap::Entry *TextureMap::match(const char *id) const
+{
+    if (!id || _rules.empty())
+    {
+        return NULL;
+    }
+
+    // One pass over the ID marks every rule whose literal it contains
+    vector<unsigned char> candidate(_rules.size(), 0);
+    int state = 0;
+    for (const char *p = id; *p; p++)
+    {
+        state = _delta[state * _class_count + _classes[(unsigned char)tolower((unsigned char)*p)]];
+        const vector<unsigned int> &output = _outputs[state];
+        for (size_t i = 0; i < output.size(); i++)
+        {
+            candidate[output[i]] = 1;
+        }
+    }
+
+    // First match wins, only candidates pay for the regular expression
+    for (size_t r = 0; r < _rules.size(); r++)
+    {
+        if (!_rules[r].literal.empty() && !candidate[r])
+        {
+            continue;
+        }
+        if (RegExp(id, _rules[r].pattern))
+        {
+#ifdef DEBUG
+            fprintf(stderr, "[Debug]\t\tRegEx match for \"%s\" on \"%s\"\n", (const char*)_rules[r].pattern, id);
+#endif // DEBUG
+            return _rules[r].entry;
+        }
+    }
+    return NULL;
+}
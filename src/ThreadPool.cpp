@@ -0,0 +1,125 @@
+//
+//  ThreadPool.cpp
+//  FrcSim
+//
+//
+
+#include <vector>
+
+using namespace std;
+
+#include "ThreadPool.h"
+
+//----------------------------------------------------------------------
+//
+// ThreadPool()
+//
+//----------------------------------------------------------------------
+ThreadPool::ThreadPool(unsigned int threadCount) :
+    _busy(0),
+    _stopping(false)
+{
+    if (threadCount == 0)
+    {
+        threadCount = thread::hardware_concurrency();
+        if (threadCount == 0)
+        {
+            threadCount = 1;
+        }
+    }
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+        _workers.push_back(thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// ~ThreadPool()
+//
+//----------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _task_ready.notify_all();
+    for (size_t i = 0; i < _workers.size(); i++)
+    {
+        _workers[i].join();
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// enqueue()
+//
+//----------------------------------------------------------------------
+void ThreadPool::enqueue(const Task &task)
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _tasks.push_back(task);
+    }
+    _task_ready.notify_one();
+}
+
+//----------------------------------------------------------------------
+//
+// wait()
+//
+//----------------------------------------------------------------------
+void ThreadPool::wait()
+{
+    unique_lock<mutex> lock(_mutex);
+    while (!_tasks.empty() || _busy > 0)
+    {
+        _tasks_done.wait(lock);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+// isIdle()
+//
+//----------------------------------------------------------------------
+bool ThreadPool::isIdle() const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _tasks.empty() && _busy == 0;
+}
+
+//----------------------------------------------------------------------
+//
+// workerLoop()
+//
+//----------------------------------------------------------------------
+void ThreadPool::workerLoop()
+{
+    unique_lock<mutex> lock(_mutex);
+    while (true)
+    {
+        while (!_stopping && _tasks.empty())
+        {
+            _task_ready.wait(lock);
+        }
+        if (_tasks.empty())
+        {
+            // Stopping and nothing left to do
+            return;
+        }
+        Task task = _tasks.front();
+        _tasks.pop_front();
+        _busy++;
+        lock.unlock();
+        task();
+        lock.lock();
+        _busy--;
+        if (_tasks.empty() && _busy == 0)
+        {
+            _tasks_done.notify_all();
+        }
+    }
+}
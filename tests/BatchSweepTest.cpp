@@ -0,0 +1,100 @@
+//
+//  BatchSweepTest.cpp
+//  FrcSim
+//
+//  Runs the sample sweep and fails if two different sweep points end the
+//  match in the same state, or if a sweep of a key the headless world
+//  ignores is accepted.  Run from the directory containing res/, or pass it
+//  as the first argument.
+//
+
+#include <cmath>
+#include <fstream>
+
+#include <map>
+#include <vector>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Robot.h"
+#include "MatchInput.h"
+#include "FrcSim.h"
+#include "SimulationWorld.h"
+#include "BatchRunner.h"
+
+/**
+ * Sweep written by the test, in the working directory.
+ */
+static const char* kIgnoredKeySweep = "frcsim-sweep-test.json";
+
+//----------------------------------------------------------------------
+//
+// sameOutcome()
+//
+//----------------------------------------------------------------------
+static bool sameOutcome(const BatchRunner::Result &a, const BatchRunner::Result &b)
+{
+    return a.position == b.position && a.velocity == b.velocity && a.ball == b.ball && a.ballInPlay == b.ballInPlay;
+}
+
+//----------------------------------------------------------------------
+//
+// main()
+//
+//----------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    string resources = (argc > 1) ? argv[1] : "./";
+    FileSystem::setResourcePath(resources.c_str());
+    SimulationWorld::Parameters parameters;
+    parameters.load(AerialAssist::_kSceneFile, "res/frcsim.physics");
+    bool passed = true;
+
+    BatchRunner runner(parameters);
+    if (!runner.loadSweep(resources + "/res/data/AerialAssist2028Sweep.json") || runner.getRunCount() < 2)
+    {
+        fprintf(stderr, "[ERROR] Sample sweep not loaded\n");
+        return 1;
+    }
+    vector<BatchRunner::Result> results;
+    runner.run(0, results);
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        for (size_t j = i + 1; j < results.size(); j++)
+        {
+            if (sameOutcome(results[i], results[j]))
+            {
+                fprintf(stderr, "[ERROR] Runs %lu and %lu ended in the same state\n", (unsigned long)i, (unsigned long)j);
+                passed = false;
+            }
+        }
+    }
+
+    {
+        ofstream sweep(kIgnoredKeySweep);
+        sweep << "{ \"duration\" : 1.0, \"sweep\" : { \"mass\" : [ 100.0, 150.0 ] } }\n";
+    }
+    BatchRunner ignored(parameters);
+    if (ignored.loadSweep(kIgnoredKeySweep))
+    {
+        fprintf(stderr, "[ERROR] Sweep of \"mass\" accepted\n");
+        passed = false;
+    }
+    remove(kIgnoredKeySweep);
+
+    printf("%s\n", passed ? "passed" : "FAILED");
+    return passed ? 0 : 1;
+}
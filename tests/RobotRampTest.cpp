@@ -0,0 +1,158 @@
+//
+//  RobotRampTest.cpp
+//  FrcSim
+//
+//  Ramps headless robots to full speed both ways, one at a time and as a
+//  RobotFleet, and fails if any tick changes the velocity by more than
+//  maxAcceleration * dt or the robots never reach their setpoint.  Run from
+//  the directory containing res/, or pass it as the first argument.
+//
+
+#include <cmath>
+
+#include <map>
+#include <vector>
+
+#include <json/json.h>
+
+#include <ghoul/GPtr.H>
+#include <ghoul/GString.H>
+#include <ghoul/GPair.H>
+#include <ghoul/GFileName.H>
+#include <ghoul/GException.H>
+
+using namespace std;
+
+#include <gameplay.h>
+
+using namespace gameplay;
+
+#include "json/IJsonSerializable.h"
+#include "Robot.h"
+#include "RobotFleet.h"
+
+/**
+ * Tick of the in-game fixed timestep.
+ */
+static const float kTimestep = 1.0f / 60.0f;
+
+/**
+ * Ticks per ramp, long enough to reach full speed from full reverse.
+ */
+static const unsigned int kTicks = 1200;
+
+/**
+ * Robots in the fleet, odd so the SSE2 pairs and the scalar tail both run.
+ */
+static const unsigned int kFleetSize = 5;
+
+//----------------------------------------------------------------------
+//
+// checkTick()
+//
+// False if the velocity moved by more than one tick of acceleration, or
+// past the setpoint.
+//
+//----------------------------------------------------------------------
+static bool checkTick(const char* name, unsigned int tick, double before, const Robot &robot)
+{
+    double limit = robot.getMaxAcceleration() * kTimestep * (1.0 + 1.0e-6);
+    double after = robot.getVelocity();
+    double setpoint = robot.getVelocitySetpoint();
+    if (fabs(after - before) > limit)
+    {
+        fprintf(stderr, "[ERROR] %s tick %u: velocity %g -> %g exceeds %g per tick\n", name, tick, before, after, limit);
+        return false;
+    }
+    if ((before <= setpoint && after > setpoint) || (before >= setpoint && after < setpoint))
+    {
+        fprintf(stderr, "[ERROR] %s tick %u: velocity %g -> %g overshoots setpoint %g\n", name, tick, before, after, setpoint);
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// checkSetpoint()
+//
+//----------------------------------------------------------------------
+static bool checkSetpoint(const char* name, const Robot &robot)
+{
+    if (robot.getVelocity() != robot.getVelocitySetpoint())
+    {
+        fprintf(stderr, "[ERROR] %s: velocity %g never reached setpoint %g\n", name, robot.getVelocity(), robot.getVelocitySetpoint());
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+//
+// main()
+//
+//----------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    FileSystem::setResourcePath((argc > 1) ? argv[1] : "./");
+    Robot prototype("/res/data/AerialAssist2028.json", false);
+    if (prototype.getMaxAcceleration() <= 0.0)
+    {
+        fprintf(stderr, "[ERROR] Robot configuration not loaded\n");
+        return 1;
+    }
+    bool passed = true;
+    const float throttles[] = { 1.0f, -1.0f, 0.25f };
+
+    Robot robot(prototype);
+    for (unsigned int t = 0; t < sizeof(throttles) / sizeof(throttles[0]); t++)
+    {
+        robot.setVelocity(throttles[t]);
+        for (unsigned int tick = 0; tick < kTicks; tick++)
+        {
+            double before = robot.getVelocity();
+            robot.update(kTimestep);
+            passed = checkTick("Robot", tick, before, robot) && passed;
+        }
+        passed = checkSetpoint("Robot", robot) && passed;
+    }
+
+    vector<Robot*> robots;
+    RobotFleet fleet;
+    for (unsigned int i = 0; i < kFleetSize; i++)
+    {
+        robots.push_back(new Robot(prototype));
+        fleet.add(robots.back());
+    }
+    vector<double> before(kFleetSize);
+    for (unsigned int t = 0; t < sizeof(throttles) / sizeof(throttles[0]); t++)
+    {
+        for (unsigned int i = 0; i < kFleetSize; i++)
+        {
+            fleet.setVelocity(i, throttles[t]);
+        }
+        for (unsigned int tick = 0; tick < kTicks; tick++)
+        {
+            for (unsigned int i = 0; i < kFleetSize; i++)
+            {
+                before[i] = robots[i]->getVelocity();
+            }
+            fleet.update(kTimestep);
+            for (unsigned int i = 0; i < kFleetSize; i++)
+            {
+                passed = checkTick("RobotFleet", tick, before[i], *robots[i]) && passed;
+            }
+        }
+        for (unsigned int i = 0; i < kFleetSize; i++)
+        {
+            passed = checkSetpoint("RobotFleet", *robots[i]) && passed;
+        }
+    }
+    fleet.clear();
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        delete robots[i];
+    }
+    printf("%s\n", passed ? "passed" : "FAILED");
+    return passed ? 0 : 1;
+}